@@ -0,0 +1,183 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+use work.acc_bilinear_scaling_PK.all;
+use work.acc_bilinear_scaling_cosim_PK.all;
+
+-- Accelerator driven by the Nios II application running on the host. Register
+-- accesses of the driver become Avalon-MM transfers on the params interface
+-- and the SGDMA descriptor chains become the input and output streams, all of
+-- it through the bridge functions called every clock cycle.
+entity acc_bilinear_scaling_cosim is
+    generic (
+        G_LANES             : natural := 1;
+        G_LINE_COUNT        : natural := C_LINE_COUNT;
+        G_OUT_FIFO_DEPTH    : natural := C_OUT_FIFO_DEPTH;
+        G_CHANNELS          : natural := C_CHANNELS;
+        -- Probabilities of the DMAs sending or taking a beat when they can
+        G_VALID_PROB        : real := 1.0;
+        G_READY_PROB        : real := 1.0
+    );
+end entity acc_bilinear_scaling_cosim;
+
+architecture Test of acc_bilinear_scaling_cosim is
+    constant C_TCLK : time := 20 ns;
+
+    signal clk : std_logic := '0';
+    signal reset : std_logic := '1';
+    signal sim_done : std_logic := '0';
+
+    signal asi_input_data_data : std_logic_vector(C_DATA_WIDTH*G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_valid : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_ready : std_logic_vector(G_LANES-1 downto 0);
+    signal asi_input_data_sop : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_eop : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_data : std_logic_vector(C_DATA_WIDTH*G_LANES-1 downto 0);
+    signal aso_output_data_endofpacket : std_logic_vector(G_LANES-1 downto 0);
+    signal aso_output_data_startofpacket : std_logic_vector(G_LANES-1 downto 0);
+    signal aso_output_data_valid : std_logic_vector(G_LANES-1 downto 0);
+    signal aso_output_data_ready : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal params_address : std_logic_vector(C_MM_ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal params_read : std_logic := '0';
+    signal params_write : std_logic := '0';
+    signal params_readdata : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+    signal params_writedata : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := (others => '0');
+    signal ins_done_irq : std_logic;
+
+    -- Encodes a stream beat for the bridge
+    function beat(data : std_logic_vector; sop : std_logic; eop : std_logic) return integer is
+        variable v_beat : integer;
+    begin
+        v_beat := to_integer(unsigned(data));
+        if sop = '1' then
+            v_beat := v_beat + C_BEAT_SOP;
+        end if;
+        if eop = '1' then
+            v_beat := v_beat + C_BEAT_EOP;
+        end if;
+        return v_beat;
+    end function beat;
+begin
+
+    uut: entity work.acc_bilinear_scaling_multi
+        generic map (
+            G_LANES => G_LANES,
+            G_LINE_COUNT => G_LINE_COUNT,
+            G_OUT_FIFO_DEPTH => G_OUT_FIFO_DEPTH,
+            G_CHANNELS => G_CHANNELS
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            asi_input_data_data => asi_input_data_data,
+            asi_input_data_valid => asi_input_data_valid,
+            asi_input_data_ready => asi_input_data_ready,
+            asi_input_data_sop => asi_input_data_sop,
+            asi_input_data_eop => asi_input_data_eop,
+            aso_output_data_data => aso_output_data_data,
+            aso_output_data_endofpacket => aso_output_data_endofpacket,
+            aso_output_data_startofpacket => aso_output_data_startofpacket,
+            aso_output_data_valid => aso_output_data_valid,
+            aso_output_data_ready => aso_output_data_ready,
+            params_address => params_address,
+            params_read => params_read,
+            params_write => params_write,
+            params_readdata => params_readdata,
+            params_writedata => params_writedata,
+            params_waitrequest => open,
+            ins_done_irq => ins_done_irq
+        );
+
+    clk <= not clk after C_TCLK/2 when sim_done = '0' else clk;
+    reset <= '0' after C_TCLK;
+
+    BRIDGE: process(clk) is
+        -- Read issued, data is returned one cycle after the slave takes it
+        variable v_read_wait    : natural range 0 to 1 := 0;
+        variable v_readdata     : integer;
+        variable v_command      : integer;
+        variable v_accepted     : integer;
+        variable v_beat         : integer;
+        variable v_irq          : integer;
+        variable seed1          : positive := 123;
+        variable seed2          : positive := 456;
+        variable rand           : real;
+    begin
+        if rising_edge(clk) and reset = '0' and sim_done = '0' then
+            v_irq := 0;
+            if ins_done_irq = '1' then
+                v_irq := 1;
+            end if;
+
+            if cosim_cycle(v_irq) = 1 then
+                report "Application exited";
+                sim_done <= '1';
+            else
+                -- Register accesses of the driver
+                params_read <= '0';
+                params_write <= '0';
+                if params_read = '1' then
+                    v_read_wait := 1;
+                elsif v_read_wait = 1 then
+                    v_read_wait := 0;
+                    v_readdata := to_integer(unsigned(params_readdata));
+                else
+                    v_readdata := 0;
+                end if;
+                if v_read_wait = 0 then
+                    v_command := cosim_bus(v_readdata);
+                    if v_command /= C_BUS_NONE then
+                        params_address <= std_logic_vector(to_unsigned((v_command / 2**8) mod 2**C_MM_ADDR_WIDTH, C_MM_ADDR_WIDTH));
+                        params_writedata <= std_logic_vector(to_unsigned(v_command mod 2**C_MM_DATA_WIDTH, C_MM_DATA_WIDTH));
+                        if v_command >= C_BUS_READ then
+                            params_read <= '1';
+                        else
+                            params_write <= '1';
+                        end if;
+                    end if;
+                end if;
+
+                for i in 0 to G_LANES-1 loop
+                    -- Stream to memory DMA
+                    v_beat := C_BEAT_NONE;
+                    if aso_output_data_valid(i) = '1' and aso_output_data_ready(i) = '1' then
+                        v_beat := beat(aso_output_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i),
+                                       aso_output_data_startofpacket(i), aso_output_data_endofpacket(i));
+                    end if;
+                    uniform(seed1, seed2, rand);
+                    if cosim_sink(i, v_beat) = 1 and rand < G_READY_PROB then
+                        aso_output_data_ready(i) <= '1';
+                    else
+                        aso_output_data_ready(i) <= '0';
+                    end if;
+
+                    -- Memory to stream DMA
+                    v_accepted := 0;
+                    if asi_input_data_valid(i) = '1' and asi_input_data_ready(i) = '1' then
+                        v_accepted := 1;
+                    end if;
+                    v_beat := cosim_source(i, v_accepted);
+                    uniform(seed1, seed2, rand);
+                    if v_beat /= C_BEAT_NONE and rand < G_VALID_PROB then
+                        asi_input_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i) <=
+                            std_logic_vector(to_unsigned(v_beat mod C_BEAT_SOP, C_DATA_WIDTH));
+                        asi_input_data_sop(i) <= '0';
+                        if (v_beat / C_BEAT_SOP) mod 2 = 1 then
+                            asi_input_data_sop(i) <= '1';
+                        end if;
+                        asi_input_data_eop(i) <= '0';
+                        if v_beat >= C_BEAT_EOP then
+                            asi_input_data_eop(i) <= '1';
+                        end if;
+                        asi_input_data_valid(i) <= '1';
+                    else
+                        asi_input_data_valid(i) <= '0';
+                    end if;
+                end loop;
+            end if;
+        end if;
+    end process BRIDGE;
+
+end architecture Test; -- of acc_bilinear_scaling_cosim
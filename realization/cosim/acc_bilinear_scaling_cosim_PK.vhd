@@ -0,0 +1,66 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+
+-- Foreign functions of the co-simulation bridge (cosim.c), called every clock
+-- cycle. Stream beats are encoded as data | sop << 8 | eop << 9, -1 is no beat.
+package acc_bilinear_scaling_cosim_PK is
+
+    constant C_BEAT_NONE    : integer := -1;
+    constant C_BEAT_SOP     : integer := 2**8;
+    constant C_BEAT_EOP     : integer := 2**9;
+
+    -- Bus commands, write | read | address << 8 | data, -1 is no command
+    constant C_BUS_NONE     : integer := -1;
+    constant C_BUS_WRITE    : integer := 2**16;
+    constant C_BUS_READ     : integer := 2**17;
+
+    -- Starts the application on the first call, returns 1 once it has exited.
+    -- Blocks while the system is idle, until the application accesses the
+    -- accelerator or starts a DMA.
+    impure function cosim_cycle(irq : integer) return integer;
+    attribute foreign of cosim_cycle : function is "VHPIDIRECT cosim_cycle";
+
+    -- Completes the previous command, with the read data for reads, and
+    -- returns the next one.
+    impure function cosim_bus(readdata : integer) return integer;
+    attribute foreign of cosim_bus : function is "VHPIDIRECT cosim_bus";
+
+    -- Memory to stream DMA of the lane, returns the beat to send. The previous
+    -- beat was taken by the accelerator when accepted is 1.
+    impure function cosim_source(lane : integer; accepted : integer) return integer;
+    attribute foreign of cosim_source : function is "VHPIDIRECT cosim_source";
+
+    -- Stream to memory DMA of the lane, takes the beat received in this cycle
+    -- and returns 1 when the next one can be received.
+    impure function cosim_sink(lane : integer; beat : integer) return integer;
+    attribute foreign of cosim_sink : function is "VHPIDIRECT cosim_sink";
+
+end package acc_bilinear_scaling_cosim_PK;
+
+package body acc_bilinear_scaling_cosim_PK is
+
+    impure function cosim_cycle(irq : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT cosim_cycle" severity failure;
+        return 1;
+    end function cosim_cycle;
+
+    impure function cosim_bus(readdata : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT cosim_bus" severity failure;
+        return C_BUS_NONE;
+    end function cosim_bus;
+
+    impure function cosim_source(lane : integer; accepted : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT cosim_source" severity failure;
+        return C_BEAT_NONE;
+    end function cosim_source;
+
+    impure function cosim_sink(lane : integer; beat : integer) return integer is
+    begin
+        assert false report "VHPIDIRECT cosim_sink" severity failure;
+        return 0;
+    end function cosim_sink;
+
+end package body acc_bilinear_scaling_cosim_PK;
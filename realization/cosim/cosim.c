@@ -0,0 +1,575 @@
+/* Co-simulation bridge between the Nios II application and the accelerator RTL.
+ *
+ * The application (main.c built as cosim_app_main) runs on its own thread and
+ * the HAL calls of the driver are served here. GHDL calls the cosim_* bridge
+ * functions every clock cycle: register accesses are handed to the params
+ * interface one byte at a time, SGDMA descriptor chains are read and written
+ * in host memory as the stream beats are taken and given by the accelerator.
+ * Interrupt service routines and SGDMA callbacks run on a third thread. */
+#include <assert.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "altera_avalon_performance_counter.h"
+#include "altera_avalon_sgdma_descriptor.h"
+#include "altera_avalon_sgdma.h"
+#include "altera_avalon_sgdma_regs.h"
+#include "io.h"
+#include "system.h"
+#include "sys/alt_irq.h"
+
+#define COSIM_BEAT_NONE     (-1)
+#define COSIM_BEAT_SOP      (1 << 8)
+#define COSIM_BEAT_EOP      (1 << 9)
+
+#define COSIM_BUS_NONE      (-1)
+#define COSIM_BUS_WRITE     (1 << 16)
+#define COSIM_BUS_READ      (1 << 17)
+
+#define COSIM_IDLE_CYCLES   (1024)  /* Cycles simulated with nothing going on before waiting for the application. */
+#define COSIM_PERF_SECTIONS (8)     /* Performance counter sections, section 0 is unused as on the board. */
+
+struct alt_sgdma_dev {
+    const char* name;
+    alt_sgdma_descriptor* desc;     /* Descriptor being processed, NULL when there is no chain. */
+    uint16_t count;                 /* Bytes of the descriptor transferred. */
+    alt_avalon_sgdma_callback callback;
+    void* context;
+    uint32_t chain_control;
+    uint8_t callback_pending;
+};
+
+/* Application entry, main.c is built with main renamed. */
+int cosim_app_main();
+
+/* All of the state below is guarded by the lock, threads wait on the
+ * condition for each other. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t app_thread;
+static pthread_t isr_thread;
+static uint8_t started = 0;
+static uint8_t app_exited = 0;
+
+static uint64_t cycles = 0;
+static uint32_t idle_cycles = 0;
+
+/* Register access of the application or the ISR, a single one at a time. */
+static uint8_t access_busy = 0;
+static struct {
+    uint8_t pending;    /* Waiting for the bus. */
+    uint8_t issued;     /* On the bus, done on the next bridge call. */
+    uint8_t done;
+    uint8_t write;
+    uint8_t address;
+    uint8_t data;
+} bus;
+
+/* Accelerator done interrupt. */
+static alt_isr_func isr = NULL;
+static void* isr_context = NULL;
+static uint8_t irq_pending = 0;
+static uint8_t isr_running = 0;
+
+static const char* sgdma_in_names[ACC_BILINEAR_SCALING_LANES] = ACC_BILINEAR_SCALING_SGDMA_IN_NAMES;
+static const char* sgdma_out_names[ACC_BILINEAR_SCALING_LANES] = ACC_BILINEAR_SCALING_SGDMA_OUT_NAMES;
+static alt_sgdma_dev sgdma_in[ACC_BILINEAR_SCALING_LANES];
+static alt_sgdma_dev sgdma_out[ACC_BILINEAR_SCALING_LANES];
+
+static struct {
+    uint64_t cycles;
+    uint64_t cycles_begin;
+    double seconds;
+    struct timespec time_begin;
+    uint32_t occurrences;
+} perf[COSIM_PERF_SECTIONS];
+
+_Static_assert(sizeof(alt_sgdma_descriptor) <= ALTERA_AVALON_SGDMA_DESCRIPTOR_SIZE, "SGDMA descriptor too large");
+
+
+static void* app_thread_main(void* arg) {
+    int status = cosim_app_main();
+    fflush(stdout);
+
+    pthread_mutex_lock(&lock);
+    app_exited = 1;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+
+    if (status != 0) {
+        fprintf(stderr, "Application exited with %d\n", status);
+    }
+    return NULL;
+}
+
+
+/* Interrupts of the accelerator and the SGDMAs, served one at a time. */
+static void* isr_thread_main(void* arg) {
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        uint8_t callbacks = 0;
+        for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+            callbacks |= sgdma_in[lane].callback_pending | sgdma_out[lane].callback_pending;
+        }
+        if (app_exited) {
+            break;
+        }
+        if (!irq_pending && !callbacks) {
+            pthread_cond_wait(&cond, &lock);
+            continue;
+        }
+
+        isr_running = 1;
+        if (irq_pending) {
+            irq_pending = 0;
+            pthread_mutex_unlock(&lock);
+            isr(isr_context);
+            pthread_mutex_lock(&lock);
+        }
+        for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+            alt_sgdma_dev* devs[2] = { &sgdma_in[lane], &sgdma_out[lane] };
+            for (unsigned i = 0; i < 2; i++) {
+                if (devs[i]->callback_pending) {
+                    devs[i]->callback_pending = 0;
+                    pthread_mutex_unlock(&lock);
+                    devs[i]->callback(devs[i]->context);
+                    pthread_mutex_lock(&lock);
+                }
+            }
+        }
+        isr_running = 0;
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+
+/* Something is happening or about to happen on the accelerator interfaces. */
+static uint8_t system_active() {
+    if (access_busy || bus.pending || bus.issued || irq_pending || isr_running) {
+        return 1;
+    }
+    for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+        if (sgdma_in[lane].desc || sgdma_out[lane].desc ||
+            sgdma_in[lane].callback_pending || sgdma_out[lane].callback_pending) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static void chain_done(alt_sgdma_dev* dev) {
+    dev->desc = NULL;
+    if (dev->callback &&
+        (dev->chain_control & ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK) &&
+        (dev->chain_control & ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK)) {
+        dev->callback_pending = 1;
+        pthread_cond_broadcast(&cond);
+    }
+}
+
+
+/* Hands the descriptor back to software and moves on to the next one. */
+static void desc_done(alt_sgdma_dev* dev, uint8_t status) {
+    alt_sgdma_descriptor* desc = dev->desc;
+    desc->actual_bytes_transferred = dev->count;
+    desc->status = status;
+    desc->control &= ~ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK;
+
+    dev->count = 0;
+    dev->desc = (alt_sgdma_descriptor*)desc->next;
+    if (!(dev->desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK)) {
+        chain_done(dev);
+    }
+}
+
+
+int cosim_cycle(int irq) {
+    int exited;
+
+    pthread_mutex_lock(&lock);
+    if (!started) {
+        started = 1;
+        pthread_create(&isr_thread, NULL, isr_thread_main, NULL);
+        pthread_create(&app_thread, NULL, app_thread_main, NULL);
+    }
+    cycles++;
+
+    /* Level sensitive, the ISR clears the interrupt before returning. */
+    if (irq && isr && !irq_pending && !isr_running) {
+        irq_pending = 1;
+        pthread_cond_broadcast(&cond);
+    }
+
+    /* Nothing going on for a while, time stands still until the application
+     * accesses the accelerator or starts a DMA. */
+    idle_cycles = system_active() ? 0 : idle_cycles + 1;
+    while (idle_cycles >= COSIM_IDLE_CYCLES && !app_exited && !system_active()) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    if (system_active()) {
+        idle_cycles = 0;
+    }
+
+    exited = app_exited;
+    if (exited) {
+        printf("Co-simulation done after %llu cycles.\n", (unsigned long long)cycles);
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (exited) {
+        pthread_join(app_thread, NULL);
+        pthread_join(isr_thread, NULL);
+    }
+    return exited;
+}
+
+
+int cosim_bus(int readdata) {
+    int command = COSIM_BUS_NONE;
+
+    pthread_mutex_lock(&lock);
+    if (bus.issued) {
+        bus.issued = 0;
+        bus.data = bus.write ? bus.data : readdata;
+        bus.done = 1;
+        pthread_cond_broadcast(&cond);
+    }
+    if (bus.pending) {
+        bus.pending = 0;
+        bus.issued = 1;
+        command = (bus.write ? COSIM_BUS_WRITE : COSIM_BUS_READ) | (bus.address << 8) | bus.data;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return command;
+}
+
+
+int cosim_source(int lane, int accepted) {
+    alt_sgdma_dev* dev = &sgdma_out[lane];
+    alt_sgdma_descriptor* desc;
+    int beat = COSIM_BEAT_NONE;
+
+    assert(lane < ACC_BILINEAR_SCALING_LANES);
+
+    pthread_mutex_lock(&lock);
+    if (accepted && dev->desc) {
+        dev->count++;
+        if (dev->count == dev->desc->bytes_to_transfer) {
+            desc_done(dev, 0);
+        }
+    }
+
+    desc = dev->desc;
+    if (desc) {
+        uint16_t offset = (desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_READ_FIXED_ADDRESS_MSK) ? 0 : dev->count;
+        beat = ((uint8_t*)desc->read_addr)[offset];
+        /* Write fixed address bit is the start of packet of memory to stream descriptors. */
+        if (dev->count == 0 && (desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_WRITE_FIXED_ADDRESS_MSK)) {
+            beat |= COSIM_BEAT_SOP;
+        }
+        if (dev->count == desc->bytes_to_transfer - 1 && (desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_GENERATE_EOP_MSK)) {
+            beat |= COSIM_BEAT_EOP;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    return beat;
+}
+
+
+int cosim_sink(int lane, int beat) {
+    alt_sgdma_dev* dev = &sgdma_in[lane];
+    alt_sgdma_descriptor* desc;
+    int ready;
+
+    assert(lane < ACC_BILINEAR_SCALING_LANES);
+
+    pthread_mutex_lock(&lock);
+    desc = dev->desc;
+    if (beat != COSIM_BEAT_NONE) {
+        /* Ready is only given with a chain running. */
+        assert(desc != NULL);
+        uint16_t offset = (desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_WRITE_FIXED_ADDRESS_MSK) ? 0 : dev->count;
+        ((uint8_t*)desc->write_addr)[offset] = beat & 0xff;
+        dev->count++;
+        /* Zero length descriptors are closed by the end of packet only. */
+        if (beat & COSIM_BEAT_EOP) {
+            desc_done(dev, ALTERA_AVALON_SGDMA_DESCRIPTOR_STATUS_TERMINATED_BY_EOP_MSK);
+        }
+        else if (dev->count == desc->bytes_to_transfer) {
+            desc_done(dev, 0);
+        }
+    }
+    ready = dev->desc != NULL;
+    pthread_mutex_unlock(&lock);
+
+    return ready;
+}
+
+
+static uint8_t bus_transfer(uint8_t write, uint32_t address, uint8_t data) {
+    if (address - ACC_BILINEAR_SCALING_BASE >= ACC_BILINEAR_SCALING_SPAN) {
+        fprintf(stderr, "Register access outside of the accelerator at 0x%x\n", address);
+        return 0;
+    }
+
+    bus.write = write;
+    bus.address = address - ACC_BILINEAR_SCALING_BASE;
+    bus.data = data;
+    bus.done = 0;
+    bus.pending = 1;
+    pthread_cond_broadcast(&cond);
+    while (!bus.done) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    return bus.data;
+}
+
+
+/* Accesses are not interrupted, and the application waits for a running ISR. */
+static void access_begin() {
+    uint8_t in_isr = pthread_equal(pthread_self(), isr_thread);
+
+    pthread_mutex_lock(&lock);
+    while (access_busy || (isr_running && !in_isr)) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    access_busy = 1;
+}
+
+
+static void access_end() {
+    access_busy = 0;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+
+void cosim_iowr(uint32_t address, uint32_t data, uint8_t bytes) {
+    access_begin();
+    for (uint8_t i = 0; i < bytes; i++) {
+        bus_transfer(1, address + i, data >> 8*i);
+    }
+    access_end();
+}
+
+
+uint32_t cosim_iord(uint32_t address, uint8_t bytes) {
+    uint32_t data = 0;
+
+    access_begin();
+    for (uint8_t i = 0; i < bytes; i++) {
+        data |= (uint32_t)bus_transfer(0, address + i, 0) << 8*i;
+    }
+    access_end();
+
+    return data;
+}
+
+
+int alt_ic_isr_register(uint32_t ic_id, uint32_t irq, alt_isr_func isr_func, void* context, void* flags) {
+    if (ic_id != ACC_BILINEAR_SCALING_IRQ_INTERRUPT_CONTROLLER_ID || irq != ACC_BILINEAR_SCALING_IRQ) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    isr = isr_func;
+    isr_context = context;
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+
+alt_sgdma_dev* alt_avalon_sgdma_open(const char* name) {
+    for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+        if (!strcmp(name, sgdma_in_names[lane])) {
+            sgdma_in[lane].name = sgdma_in_names[lane];
+            return &sgdma_in[lane];
+        }
+        if (!strcmp(name, sgdma_out_names[lane])) {
+            sgdma_out[lane].name = sgdma_out_names[lane];
+            return &sgdma_out[lane];
+        }
+    }
+
+    fprintf(stderr, "No SGDMA device %s\n", name);
+    return NULL;
+}
+
+
+void alt_avalon_sgdma_register_callback(
+        alt_sgdma_dev* dev,
+        alt_avalon_sgdma_callback callback,
+        uint32_t chain_control,
+        void* context) {
+
+    pthread_mutex_lock(&lock);
+    dev->callback = callback;
+    dev->chain_control = chain_control;
+    dev->context = context;
+    pthread_mutex_unlock(&lock);
+}
+
+
+static void construct_desc(
+        alt_sgdma_descriptor* desc,
+        alt_sgdma_descriptor* next,
+        uint32_t* read_addr,
+        uint32_t* write_addr,
+        uint16_t length,
+        uint8_t control) {
+
+    /* Chain ends at the next descriptor until it is constructed as well. */
+    next->control &= ~ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK;
+
+    desc->read_addr = read_addr;
+    desc->write_addr = write_addr;
+    desc->next = (uint32_t*)next;
+    desc->bytes_to_transfer = length;
+    desc->read_burst = 0;
+    desc->write_burst = 0;
+    desc->actual_bytes_transferred = 0;
+    desc->status = 0;
+    desc->control = control | ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK;
+}
+
+
+void alt_avalon_sgdma_construct_mem_to_stream_desc(
+        alt_sgdma_descriptor* desc,
+        alt_sgdma_descriptor* next,
+        uint32_t* read_addr,
+        uint16_t length,
+        int read_fixed,
+        int generate_sop,
+        int generate_eop,
+        uint8_t atlantic_channel) {
+
+    construct_desc(desc, next, read_addr, NULL, length,
+        (generate_eop ? ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_GENERATE_EOP_MSK : 0) |
+        (read_fixed ? ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_READ_FIXED_ADDRESS_MSK : 0) |
+        (generate_sop ? ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_WRITE_FIXED_ADDRESS_MSK : 0) |
+        ((atlantic_channel << ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_ATLANTIC_CHANNEL_OFST) &
+         ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_ATLANTIC_CHANNEL_MSK));
+}
+
+
+void alt_avalon_sgdma_construct_stream_to_mem_desc(
+        alt_sgdma_descriptor* desc,
+        alt_sgdma_descriptor* next,
+        uint32_t* write_addr,
+        uint16_t length_or_eop,
+        int write_fixed) {
+
+    construct_desc(desc, next, NULL, write_addr, length_or_eop,
+        write_fixed ? ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_WRITE_FIXED_ADDRESS_MSK : 0);
+}
+
+
+int alt_avalon_sgdma_do_async_transfer(alt_sgdma_dev* dev, alt_sgdma_descriptor* desc) {
+    int result = 0;
+
+    pthread_mutex_lock(&lock);
+    if (dev->desc) {
+        result = -1;
+    }
+    else {
+        dev->desc = desc;
+        dev->count = 0;
+        if (!(desc->control & ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK)) {
+            chain_done(dev);
+        }
+        pthread_cond_broadcast(&cond);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return result;
+}
+
+
+void alt_avalon_sgdma_stop(alt_sgdma_dev* dev) {
+    pthread_mutex_lock(&lock);
+    dev->desc = NULL;
+    dev->count = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+
+void cosim_perf_reset(void) {
+    memset(perf, 0, sizeof(perf));
+}
+
+
+void cosim_perf_begin(int section) {
+    assert(section < COSIM_PERF_SECTIONS);
+
+    pthread_mutex_lock(&lock);
+    perf[section].cycles_begin = cycles;
+    pthread_mutex_unlock(&lock);
+    clock_gettime(CLOCK_MONOTONIC, &perf[section].time_begin);
+}
+
+
+void cosim_perf_end(int section) {
+    struct timespec time_end;
+
+    assert(section < COSIM_PERF_SECTIONS);
+
+    clock_gettime(CLOCK_MONOTONIC, &time_end);
+    pthread_mutex_lock(&lock);
+    perf[section].cycles += cycles - perf[section].cycles_begin;
+    pthread_mutex_unlock(&lock);
+    perf[section].seconds += (time_end.tv_sec - perf[section].time_begin.tv_sec) +
+                             (time_end.tv_nsec - perf[section].time_begin.tv_nsec) / 1e9;
+    perf[section].occurrences++;
+}
+
+
+/* Host time of the section in CPU clocks. Simulated clocks don't advance while
+ * only the application runs, so the host time is what compares the engines. */
+uint64_t perf_get_section_time(void* perf_base, int section) {
+    assert(section < COSIM_PERF_SECTIONS);
+    return perf[section].seconds * ALT_CPU_FREQ;
+}
+
+
+/* Host time is what the application took on this machine, the simulated
+ * clocks are the accelerator cycles spent in the section. */
+int perf_print_formatted_report(void* perf_base, uint32_t clock_freq_hertz, int num_sections, ...) {
+    va_list names;
+
+    printf("--Co-simulation Performance Report--\n");
+    printf("+---------------+-----------+---------------+-----------+-----------+\n");
+    printf("| Section       | Host (sec)| Sim (clocks)  | Sim (sec) |Occurrences|\n");
+    printf("+---------------+-----------+---------------+-----------+-----------+\n");
+
+    va_start(names, num_sections);
+    for (int section = 1; section <= num_sections && section < COSIM_PERF_SECTIONS; section++) {
+        printf("|%-15.15s|%11.5f|%15llu|%11.5f|%11lu|\n",
+               va_arg(names, const char*),
+               perf[section].seconds,
+               (unsigned long long)perf[section].cycles,
+               (double)perf[section].cycles / clock_freq_hertz,
+               (unsigned long)perf[section].occurrences);
+    }
+    va_end(names);
+
+    printf("+---------------+-----------+---------------+-----------+-----------+\n");
+    return 0;
+}
+
+
+uint32_t alt_get_cpu_freq(void) {
+    return ALT_CPU_FREQ;
+}
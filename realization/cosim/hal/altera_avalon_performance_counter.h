@@ -0,0 +1,24 @@
+#ifndef __ALTERA_AVALON_PERFORMANCE_COUNTER_H__
+#define __ALTERA_AVALON_PERFORMANCE_COUNTER_H__
+
+#include <stdint.h>
+
+/* Sections measure both the host time of the application and the simulated
+ * clock cycles, printed side by side by the report. */
+void cosim_perf_reset(void);
+void cosim_perf_begin(int section);
+void cosim_perf_end(int section);
+
+#define PERF_RESET(p)               cosim_perf_reset()
+#define PERF_START_MEASURING(p)     ((void)(p))
+#define PERF_STOP_MEASURING(p)      ((void)(p))
+#define PERF_BEGIN(p, n)            cosim_perf_begin(n)
+#define PERF_END(p, n)              cosim_perf_end(n)
+
+uint64_t perf_get_section_time(void* perf_base, int section);
+
+int perf_print_formatted_report(void* perf_base, uint32_t clock_freq_hertz, int num_sections, ...);
+
+uint32_t alt_get_cpu_freq(void);
+
+#endif /* __ALTERA_AVALON_PERFORMANCE_COUNTER_H__ */
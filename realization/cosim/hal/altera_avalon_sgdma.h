@@ -0,0 +1,42 @@
+#ifndef __ALTERA_AVALON_SGDMA_H__
+#define __ALTERA_AVALON_SGDMA_H__
+
+#include <stdint.h>
+
+#include "altera_avalon_sgdma_descriptor.h"
+
+typedef void (*alt_avalon_sgdma_callback)(void* context);
+
+/* SGDMA device, feeds or drains the stream of one accelerator lane. */
+typedef struct alt_sgdma_dev alt_sgdma_dev;
+
+alt_sgdma_dev* alt_avalon_sgdma_open(const char* name);
+
+void alt_avalon_sgdma_register_callback(
+        alt_sgdma_dev* dev,
+        alt_avalon_sgdma_callback callback,
+        uint32_t chain_control,
+        void* context);
+
+void alt_avalon_sgdma_construct_mem_to_stream_desc(
+        alt_sgdma_descriptor* desc,
+        alt_sgdma_descriptor* next,
+        uint32_t* read_addr,
+        uint16_t length,
+        int read_fixed,
+        int generate_sop,
+        int generate_eop,
+        uint8_t atlantic_channel);
+
+void alt_avalon_sgdma_construct_stream_to_mem_desc(
+        alt_sgdma_descriptor* desc,
+        alt_sgdma_descriptor* next,
+        uint32_t* write_addr,
+        uint16_t length_or_eop,
+        int write_fixed);
+
+int alt_avalon_sgdma_do_async_transfer(alt_sgdma_dev* dev, alt_sgdma_descriptor* desc);
+
+void alt_avalon_sgdma_stop(alt_sgdma_dev* dev);
+
+#endif /* __ALTERA_AVALON_SGDMA_H__ */
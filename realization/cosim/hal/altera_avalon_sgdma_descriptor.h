@@ -0,0 +1,31 @@
+#ifndef __ALTERA_AVALON_SGDMA_DESCRIPTOR_H__
+#define __ALTERA_AVALON_SGDMA_DESCRIPTOR_H__
+
+#include <stdint.h>
+
+/* Descriptor layout of the HAL, pointers take the place of the pads so it is
+ * the same 32 bytes on a 64-bit host. */
+typedef struct {
+    uint32_t* read_addr;
+    uint32_t* write_addr;
+    uint32_t* next;
+    uint16_t bytes_to_transfer;
+    uint8_t read_burst;
+    uint8_t write_burst;
+    uint16_t actual_bytes_transferred;
+    uint8_t status;
+    uint8_t control;
+} alt_sgdma_descriptor;
+
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_SIZE                         (32)
+
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_GENERATE_EOP_MSK     (0x1)
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_READ_FIXED_ADDRESS_MSK (0x2)
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_WRITE_FIXED_ADDRESS_MSK (0x4)
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_ATLANTIC_CHANNEL_MSK (0x78)
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_ATLANTIC_CHANNEL_OFST (3)
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_CONTROL_OWNED_BY_HW_MSK      (0x80)
+
+#define ALTERA_AVALON_SGDMA_DESCRIPTOR_STATUS_TERMINATED_BY_EOP_MSK (0x80)
+
+#endif /* __ALTERA_AVALON_SGDMA_DESCRIPTOR_H__ */
@@ -0,0 +1,15 @@
+#ifndef __ALTERA_AVALON_SGDMA_REGS_H__
+#define __ALTERA_AVALON_SGDMA_REGS_H__
+
+/* Control register bits, only the interrupt enables are used by the
+ * co-simulation, a callback runs when its chain completes. */
+#define ALTERA_AVALON_SGDMA_CONTROL_IE_ERROR_MSK            (0x1)
+#define ALTERA_AVALON_SGDMA_CONTROL_IE_EOP_ENCOUNTERED_MSK  (0x2)
+#define ALTERA_AVALON_SGDMA_CONTROL_IE_DESC_COMPLETED_MSK   (0x4)
+#define ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK  (0x8)
+#define ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK           (0x10)
+#define ALTERA_AVALON_SGDMA_CONTROL_RUN_MSK                 (0x20)
+#define ALTERA_AVALON_SGDMA_CONTROL_STOP_DMA_ER_MSK         (0x40)
+#define ALTERA_AVALON_SGDMA_CONTROL_PARK_MSK                (0x20000)
+
+#endif /* __ALTERA_AVALON_SGDMA_REGS_H__ */
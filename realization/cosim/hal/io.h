@@ -0,0 +1,20 @@
+#ifndef __IO_H__
+#define __IO_H__
+
+#include <stdint.h>
+
+/* Register accesses of the co-simulation. Accesses wider than the 8-bit
+ * params interface are split into byte transfers in ascending address order,
+ * the same as the dynamic bus sizing of the interconnect. */
+void cosim_iowr(uint32_t address, uint32_t data, uint8_t bytes);
+uint32_t cosim_iord(uint32_t address, uint8_t bytes);
+
+#define IOWR_8DIRECT(base, offset, data)    cosim_iowr((base) + (offset), (data), 1)
+#define IOWR_16DIRECT(base, offset, data)   cosim_iowr((base) + (offset), (data), 2)
+#define IOWR_32DIRECT(base, offset, data)   cosim_iowr((base) + (offset), (data), 4)
+
+#define IORD_8DIRECT(base, offset)          ((uint8_t)cosim_iord((base) + (offset), 1))
+#define IORD_16DIRECT(base, offset)         ((uint16_t)cosim_iord((base) + (offset), 2))
+#define IORD_32DIRECT(base, offset)         cosim_iord((base) + (offset), 4)
+
+#endif /* __IO_H__ */
@@ -0,0 +1,12 @@
+#ifndef __ALT_IRQ_H__
+#define __ALT_IRQ_H__
+
+#include <stdint.h>
+
+typedef void (*alt_isr_func)(void* isr_context);
+
+/* Interrupt service routines run on their own thread of the co-simulation,
+ * the application does no register accesses while one is running. */
+int alt_ic_isr_register(uint32_t ic_id, uint32_t irq, alt_isr_func isr, void* isr_context, void* flags);
+
+#endif /* __ALT_IRQ_H__ */
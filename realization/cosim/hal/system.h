@@ -0,0 +1,41 @@
+#ifndef __SYSTEM_H_
+#define __SYSTEM_H_
+
+/* System of the co-simulation, the accelerator with an SGDMA pair per lane. */
+
+#define ALT_CPU_FREQ                                        (50000000)
+
+#define ACC_BILINEAR_SCALING_BASE                           (0x0)
+#define ACC_BILINEAR_SCALING_SPAN                           (64)
+#define ACC_BILINEAR_SCALING_IRQ_INTERRUPT_CONTROLLER_ID    (0)
+#ifndef ACC_BILINEAR_SCALING_IRQ
+#define ACC_BILINEAR_SCALING_IRQ                            (0)
+#endif
+
+#define PERFORMANCE_COUNTER_BASE                            (0x0)
+
+#define SGDMA_IN_NAME                                       "/dev/sgdma_in"
+#define SGDMA_OUT_NAME                                      "/dev/sgdma_out"
+
+/* SGDMA pairs of the lanes, named <name>_<lane>. */
+#ifndef ACC_BILINEAR_SCALING_LANES
+#define ACC_BILINEAR_SCALING_LANES                          1
+#endif
+#define COSIM_CAT(a, b)                                     a ## b
+#define COSIM_SGDMA_NAMES(lanes, name)                      COSIM_CAT(COSIM_SGDMA_NAMES_, lanes)(name)
+#define COSIM_SGDMA_NAMES_1(name)                           { name "_0" }
+#define COSIM_SGDMA_NAMES_2(name)                           { name "_0", name "_1" }
+#define COSIM_SGDMA_NAMES_3(name)                           { name "_0", name "_1", name "_2" }
+#define COSIM_SGDMA_NAMES_4(name)                           { name "_0", name "_1", name "_2", name "_3" }
+#define ACC_BILINEAR_SCALING_SGDMA_IN_NAMES                 COSIM_SGDMA_NAMES(ACC_BILINEAR_SCALING_LANES, SGDMA_IN_NAME)
+#define ACC_BILINEAR_SCALING_SGDMA_OUT_NAMES                COSIM_SGDMA_NAMES(ACC_BILINEAR_SCALING_LANES, SGDMA_OUT_NAME)
+
+#if defined(ACC_BILINEAR_SCALING_MM_MASTERS) && ACC_BILINEAR_SCALING_MM_MASTERS
+#error "Co-simulation bridges the SGDMA streams, the Avalon-MM master variant is not supported"
+#endif
+
+/* Same length as the "/mnt/host" of the board, main.c skips that many
+ * characters, resolves to the working directory. */
+#define ALTERA_HOSTFS_NAME                                  "././././."
+
+#endif /* __SYSTEM_H_ */
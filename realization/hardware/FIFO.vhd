@@ -0,0 +1,92 @@
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.ALL;
+
+-- Show-ahead FIFO, head of the queue is available on data_out while not empty
+entity FIFO is
+    generic (
+        G_DATA_WIDTH    : natural := 10;
+        G_DEPTH         : natural := 16;
+        -- Entries in use from which almost_full is set
+        G_ALMOST_FULL   : natural := 16
+    );
+    port (
+        clk         : in    std_logic;
+        reset       : in    std_logic;
+
+        wr          : in    std_logic;
+        rd          : in    std_logic;
+
+        data_in     : in    std_logic_vector(G_DATA_WIDTH - 1 downto 0);
+        data_out    : out   std_logic_vector(G_DATA_WIDTH - 1 downto 0);
+
+        empty       : out   std_logic;
+        full        : out   std_logic;
+        almost_full : out   std_logic
+    );
+end FIFO;
+
+architecture Behavioral of FIFO is
+    type FIFO_t is array (0 to G_DEPTH - 1) of std_logic_vector(G_DATA_WIDTH - 1 downto 0);
+
+    signal memory   : FIFO_t := (others => (others => '0'));
+    signal c_wr_ptr : integer range 0 to G_DEPTH - 1;
+    signal c_rd_ptr : integer range 0 to G_DEPTH - 1;
+    signal c_used   : integer range 0 to G_DEPTH;
+
+    signal w_wr     : std_logic;
+    signal w_rd     : std_logic;
+begin
+
+    -- Writing when full and reading when empty are ignored
+    w_wr <= wr when c_used < G_DEPTH else '0';
+    w_rd <= rd when c_used > 0 else '0';
+
+    WRITE_PROCESS : process(clk) is
+    begin
+        if rising_edge(clk) then
+            if (w_wr = '1') then
+                memory(c_wr_ptr) <= data_in;
+            end if;
+        end if;
+    end process;
+
+    POINTERS : process(clk) is
+    begin
+        if rising_edge(clk) then
+            if (w_wr = '1') then
+                if c_wr_ptr = G_DEPTH - 1 then
+                    c_wr_ptr <= 0;
+                else
+                    c_wr_ptr <= c_wr_ptr + 1;
+                end if;
+            end if;
+
+            if (w_rd = '1') then
+                if c_rd_ptr = G_DEPTH - 1 then
+                    c_rd_ptr <= 0;
+                else
+                    c_rd_ptr <= c_rd_ptr + 1;
+                end if;
+            end if;
+
+            if (w_wr = '1' and w_rd = '0') then
+                c_used <= c_used + 1;
+            elsif (w_wr = '0' and w_rd = '1') then
+                c_used <= c_used - 1;
+            end if;
+
+            if (reset = '1') then
+                c_wr_ptr <= 0;
+                c_rd_ptr <= 0;
+                c_used <= 0;
+            end if;
+        end if;
+    end process;
+
+    data_out <= memory(c_rd_ptr);
+    empty <= '1' when c_used = 0 else '0';
+    full <= '1' when c_used = G_DEPTH else '0';
+    almost_full <= '1' when c_used >= G_ALMOST_FULL else '0';
+
+end Behavioral;
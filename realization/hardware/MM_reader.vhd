@@ -0,0 +1,182 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Fetches a 2D region row by row with Avalon-MM burst reads and streams it
+-- out, every row ending with an end of packet
+entity MM_reader is
+    generic (
+        G_DATA_WIDTH            : natural := 8;
+        G_ADDR_WIDTH            : natural := 32;
+        G_BURST_WIDTH           : natural := 5;
+        G_BURST                 : natural := 16;
+        G_FIFO_DEPTH            : natural := 64
+    );
+    port (
+        clk                     : in  std_logic;
+        reset                   : in  std_logic;
+
+        -- Region is latched on start, rows are stride bytes apart
+        start                   : in  std_logic;
+        base                    : in  std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+        stride                  : in  std_logic_vector;
+        width                   : in  std_logic_vector;
+        height                  : in  std_logic_vector;
+        busy                    : out std_logic;
+
+        avm_address             : out std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+        avm_read                : out std_logic;
+        avm_burstcount          : out std_logic_vector(G_BURST_WIDTH-1 downto 0);
+        avm_waitrequest         : in  std_logic;
+        avm_readdata            : in  std_logic_vector(G_DATA_WIDTH-1 downto 0);
+        avm_readdatavalid       : in  std_logic;
+
+        aso_data                : out std_logic_vector(G_DATA_WIDTH-1 downto 0);
+        aso_valid               : out std_logic;
+        aso_ready               : in  std_logic;
+        aso_eop                 : out std_logic
+    );
+end entity MM_reader;
+
+architecture rtl of MM_reader is
+    -- Request side, next byte to request
+    signal r_active         : std_logic;
+    signal r_row_addr       : unsigned(G_ADDR_WIDTH-1 downto 0);
+    signal c_req_col        : integer range 0 to 2**width'length-1;
+    signal c_req_row        : integer range 0 to 2**height'length-1;
+
+    signal r_read           : std_logic;
+    signal r_address        : std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+    signal r_burstcount     : std_logic_vector(G_BURST_WIDTH-1 downto 0);
+
+    -- FIFO entries reserved by issued bursts and not yet streamed out, bursts
+    -- are only issued when all their data fits in the FIFO
+    signal c_reserved       : integer range 0 to G_FIFO_DEPTH;
+
+    -- Stream side, column of the byte at the head of the FIFO
+    signal c_out_col        : integer range 0 to 2**width'length-1;
+
+    signal w_fifo_rd        : std_logic;
+    signal w_fifo_empty     : std_logic;
+    signal w_issue          : std_logic;
+    signal w_burst          : integer range 0 to G_BURST;
+
+    signal w_width          : integer range 0 to 2**width'length-1;
+    signal w_height         : integer range 0 to 2**height'length-1;
+begin
+
+    FIFO_i0: entity work.FIFO
+        generic map (
+            G_DATA_WIDTH => G_DATA_WIDTH,
+            G_DEPTH => G_FIFO_DEPTH
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            wr => avm_readdatavalid,
+            rd => w_fifo_rd,
+            data_in => avm_readdata,
+            data_out => aso_data,
+            empty => w_fifo_empty,
+            full => open,
+            almost_full => open
+        );
+
+    w_width <= to_integer(unsigned(width));
+    w_height <= to_integer(unsigned(height));
+
+    -- Bursts don't cross the end of a row
+    w_burst <= G_BURST when w_width - c_req_col > G_BURST else w_width - c_req_col;
+
+    -- Next burst is issued once the previous one is accepted
+    w_issue <= '1' when r_active = '1' and (r_read = '0' or avm_waitrequest = '0')
+        and c_reserved + G_BURST <= G_FIFO_DEPTH else '0';
+
+    REQUEST: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if r_read = '1' and avm_waitrequest = '0' then
+                r_read <= '0';
+            end if;
+
+            if w_issue = '1' then
+                r_read <= '1';
+                r_address <= std_logic_vector(r_row_addr + c_req_col);
+                r_burstcount <= std_logic_vector(to_unsigned(w_burst, G_BURST_WIDTH));
+                if c_req_col + w_burst = w_width then
+                    c_req_col <= 0;
+                    r_row_addr <= r_row_addr + unsigned(stride);
+                    c_req_row <= c_req_row + 1;
+                    if c_req_row = w_height-1 then
+                        r_active <= '0';
+                    end if;
+                else
+                    c_req_col <= c_req_col + w_burst;
+                end if;
+            end if;
+
+            if start = '1' then
+                r_active <= '1';
+                r_row_addr <= unsigned(base);
+                c_req_col <= 0;
+                c_req_row <= 0;
+            end if;
+
+            if reset = '1' then
+                r_active <= '0';
+                r_read <= '0';
+                c_req_col <= 0;
+                c_req_row <= 0;
+            end if;
+        end if;
+    end process REQUEST;
+
+    RESERVE: process(clk) is
+        variable v_reserved : integer range -1 to G_FIFO_DEPTH+G_BURST;
+    begin
+        if rising_edge(clk) then
+            v_reserved := c_reserved;
+            if w_issue = '1' then
+                v_reserved := v_reserved + w_burst;
+            end if;
+            if w_fifo_rd = '1' then
+                v_reserved := v_reserved - 1;
+            end if;
+            c_reserved <= v_reserved;
+
+            if reset = '1' then
+                c_reserved <= 0;
+            end if;
+        end if;
+    end process RESERVE;
+
+    STREAM_POSITION: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if w_fifo_rd = '1' then
+                if c_out_col = w_width-1 then
+                    c_out_col <= 0;
+                else
+                    c_out_col <= c_out_col + 1;
+                end if;
+            end if;
+
+            if start = '1' or reset = '1' then
+                c_out_col <= 0;
+            end if;
+        end if;
+    end process STREAM_POSITION;
+
+    w_fifo_rd <= aso_ready and not w_fifo_empty;
+
+    aso_valid <= not w_fifo_empty;
+    aso_eop <= '1' when c_out_col = w_width-1 else '0';
+
+    -- Busy until the last row is streamed out
+    busy <= '1' when r_active = '1' or c_reserved /= 0 else '0';
+
+    avm_address <= r_address;
+    avm_read <= r_read;
+    avm_burstcount <= r_burstcount;
+
+end architecture rtl; -- of MM_reader
@@ -0,0 +1,87 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+-- Writes a stream of rows to a 2D region with Avalon-MM writes, every end of
+-- packet moves to the next row
+entity MM_writer is
+    generic (
+        G_DATA_WIDTH            : natural := 8;
+        G_ADDR_WIDTH            : natural := 32
+    );
+    port (
+        clk                     : in  std_logic;
+        reset                   : in  std_logic;
+
+        -- Region is latched on start, rows are stride bytes apart
+        start                   : in  std_logic;
+        base                    : in  std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+        stride                  : in  std_logic_vector;
+        busy                    : out std_logic;
+
+        asi_data                : in  std_logic_vector(G_DATA_WIDTH-1 downto 0);
+        asi_valid               : in  std_logic;
+        asi_ready               : out std_logic;
+        asi_eop                 : in  std_logic;
+
+        avm_address             : out std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+        avm_write               : out std_logic;
+        avm_writedata           : out std_logic_vector(G_DATA_WIDTH-1 downto 0);
+        avm_waitrequest         : in  std_logic
+    );
+end entity MM_writer;
+
+architecture rtl of MM_writer is
+    -- Address of the next byte
+    signal r_row_addr       : unsigned(G_ADDR_WIDTH-1 downto 0);
+    signal c_col            : integer range 0 to 2**16-1;
+
+    signal r_write          : std_logic;
+    signal r_address        : std_logic_vector(G_ADDR_WIDTH-1 downto 0);
+    signal r_writedata      : std_logic_vector(G_DATA_WIDTH-1 downto 0);
+
+    signal w_asi_ready      : std_logic;
+begin
+
+    -- Next byte is taken as soon as the pending write is accepted
+    w_asi_ready <= '1' when r_write = '0' or avm_waitrequest = '0' else '0';
+
+    WRITE_PROC: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if r_write = '1' and avm_waitrequest = '0' then
+                r_write <= '0';
+            end if;
+
+            if asi_valid = '1' and w_asi_ready = '1' then
+                r_write <= '1';
+                r_address <= std_logic_vector(r_row_addr + c_col);
+                r_writedata <= asi_data;
+                if asi_eop = '1' then
+                    c_col <= 0;
+                    r_row_addr <= r_row_addr + unsigned(stride);
+                else
+                    c_col <= c_col + 1;
+                end if;
+            end if;
+
+            if start = '1' then
+                r_row_addr <= unsigned(base);
+                c_col <= 0;
+            end if;
+
+            if reset = '1' then
+                r_write <= '0';
+                c_col <= 0;
+            end if;
+        end if;
+    end process WRITE_PROC;
+
+    asi_ready <= w_asi_ready;
+    busy <= r_write;
+
+    avm_address <= r_address;
+    avm_write <= r_write;
+    avm_writedata <= r_writedata;
+
+end architecture rtl; -- of MM_writer
@@ -0,0 +1,66 @@
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.ALL;
+
+-- Line RAM split in two banks, even columns are stored in one and odd columns
+-- in the other, so two neighbouring pixels can be read in the same cycle
+entity RAM_line is
+    generic (
+        G_DATA_WIDTH    : natural := 8;
+        G_ADDR_WIDTH    : natural := 12
+    );
+    port (
+        clk             : in    std_logic;
+
+        rd              : in    std_logic;
+        wr              : in    std_logic;
+        rd_addr_even    : in    std_logic_vector(G_ADDR_WIDTH - 2 downto 0);
+        rd_addr_odd     : in    std_logic_vector(G_ADDR_WIDTH - 2 downto 0);
+        wr_addr         : in    std_logic_vector(G_ADDR_WIDTH - 1 downto 0);
+
+        data_in         : in    std_logic_vector(G_DATA_WIDTH - 1 downto 0);
+        data_out_even   : out   std_logic_vector(G_DATA_WIDTH - 1 downto 0);
+        data_out_odd    : out   std_logic_vector(G_DATA_WIDTH - 1 downto 0)
+    );
+end RAM_line;
+
+architecture Behavioral of RAM_line is
+    signal w_wr_even    : std_logic;
+    signal w_wr_odd     : std_logic;
+begin
+
+    RAM_even: entity work.RAM
+        generic map (
+            G_DATA_WIDTH => G_DATA_WIDTH,
+            G_ADDR_WIDTH => G_ADDR_WIDTH - 1
+        )
+        port map (
+            clk => clk,
+            rd => rd,
+            wr => w_wr_even,
+            rd_addr => rd_addr_even,
+            wr_addr => wr_addr(G_ADDR_WIDTH - 1 downto 1),
+            data_in => data_in,
+            data_out => data_out_even
+        );
+
+    RAM_odd: entity work.RAM
+        generic map (
+            G_DATA_WIDTH => G_DATA_WIDTH,
+            G_ADDR_WIDTH => G_ADDR_WIDTH - 1
+        )
+        port map (
+            clk => clk,
+            rd => rd,
+            wr => w_wr_odd,
+            rd_addr => rd_addr_odd,
+            wr_addr => wr_addr(G_ADDR_WIDTH - 1 downto 1),
+            data_in => data_in,
+            data_out => data_out_odd
+        );
+
+    -- Least significant bit of the column selects the bank
+    w_wr_even <= wr and not wr_addr(0);
+    w_wr_odd  <= wr and wr_addr(0);
+
+end Behavioral;
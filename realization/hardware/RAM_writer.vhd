@@ -5,7 +5,10 @@ use IEEE.numeric_std.all;
 entity RAM_writer is
     generic (
         G_RAM_DATA_WIDTH    : natural;
-        G_RAM_ADDR_WIDTH    : natural
+        G_RAM_ADDR_WIDTH    : natural;
+        G_RAM_COUNT         : natural := 3;
+        -- Channels of an interleaved pixel, a RAM word holds all channels of a pixel
+        G_CHANNELS          : natural := 1
     );
     port (
         clk                     : in  std_logic;
@@ -17,168 +20,276 @@ entity RAM_writer is
         asi_input_data_eop      : in  std_logic;
 
         rd                      : in  std_logic;
-        rd_addr                 : in  std_logic_vector;
+        rd_addr_even            : in  std_logic_vector;
+        rd_addr_odd             : in  std_logic_vector;
 
-        data_out_0              : out std_logic_vector;
-        data_out_1              : out std_logic_vector;
+        -- Indexes of the rows the pixel group is read from
+        row_top                 : in  std_logic_vector;
+        row_bottom              : in  std_logic_vector;
+        rows_ready              : out std_logic;
 
-        ram_sel                 : out std_logic;
-        ram_filled              : out std_logic_vector(1 downto 0);
+        data_top_even           : out std_logic_vector;
+        data_top_odd            : out std_logic_vector;
+        data_bottom_even        : out std_logic_vector;
+        data_bottom_odd         : out std_logic_vector;
+
+        -- Rows with index lower than row_base are not needed anymore
+        row_base                : in  std_logic_vector;
+        flush                   : in  std_logic;
+
+        -- Rows are tagged with their index instead of being counted
+        row_tag_en              : in  std_logic;
+        -- Current input beat is a part of the row tag
+        header                  : out std_logic;
 
         row_count               : out std_logic_vector;
-        reset_row_count         : in  std_logic;
-        ram_reset               : in  std_logic_vector(1 downto 0)
+        reset_row_count         : in  std_logic
     );
 end entity RAM_writer;
 
 architecture rtl of RAM_writer is
     constant C_RAM_DEPTH    : natural := 2**G_RAM_ADDR_WIDTH;
+    constant C_BYTE_WIDTH   : natural := G_RAM_DATA_WIDTH / G_CHANNELS;
 
-    type ram_addr_t     is array (0 to 1) of std_logic_vector(G_RAM_ADDR_WIDTH-1 downto 0);
-    type ram_counter_t  is array (0 to 1) of integer range 0 to C_RAM_DEPTH-1;
+    type ram_data_t     is array (0 to G_RAM_COUNT-1) of std_logic_vector(G_RAM_DATA_WIDTH-1 downto 0);
+    type row_tag_t      is array (0 to G_RAM_COUNT-1) of integer range 0 to 2**(row_count'high+1)-1;
+    type pixel_t        is array (0 to G_CHANNELS-1) of std_logic_vector(C_BYTE_WIDTH-1 downto 0);
 
-    signal r_ram_sel        : std_logic;
-    signal r_ram_filled     : std_logic_vector(1 downto 0);
+    -- RAM the next row is written to, RAMs are used as a ring
+    signal c_wr_ram         : integer range 0 to G_RAM_COUNT-1;
+    -- RAM filled statuses and indexes of the rows they hold
+    signal r_ram_filled     : std_logic_vector(G_RAM_COUNT-1 downto 0);
+    signal r_row_tag        : row_tag_t;
 
+    signal w_accept         : std_logic;
     signal w_wr             : std_logic;
-    signal w_wr_array       : std_logic_vector(1 downto 0);
-    signal w_wr_addr        : ram_addr_t;
-    signal c_wr_addr        : ram_counter_t;
+    signal w_wr_array       : std_logic_vector(G_RAM_COUNT-1 downto 0);
+    signal w_wr_addr        : std_logic_vector(G_RAM_ADDR_WIDTH-1 downto 0);
+    signal c_wr_addr        : integer range 0 to C_RAM_DEPTH-1;
+
+    signal w_data_even      : ram_data_t;
+    signal w_data_odd       : ram_data_t;
 
-    signal c_rd_column      : ram_counter_t;
+    -- RAMs holding the requested rows, registered together with the RAM outputs
+    signal w_sel_top        : integer range 0 to G_RAM_COUNT-1;
+    signal w_sel_bottom     : integer range 0 to G_RAM_COUNT-1;
+    signal r_sel_top        : integer range 0 to G_RAM_COUNT-1;
+    signal r_sel_bottom     : integer range 0 to G_RAM_COUNT-1;
 
     signal c_row_count      : integer range 0 to 2**(row_count'high+1)-1;
 
+    -- Row tag bytes received for the current row, low byte of the tag and the whole tag
+    signal c_header         : integer range 0 to 2;
+    signal r_tag_low        : std_logic_vector(C_BYTE_WIDTH-1 downto 0);
+    signal r_tag            : integer range 0 to 2**(row_count'high+1)-1;
+    signal w_header         : std_logic;
+
+    -- Channels of the current pixel received so far, the pixel is written with its last channel
+    signal c_channel        : integer range 0 to G_CHANNELS-1;
+    signal r_pixel          : pixel_t;
     signal w_data_in        : std_logic_vector(G_RAM_DATA_WIDTH-1 downto 0);
 
     signal w_asi_input_data_ready : std_logic;
 
 begin
 
-    RAM_i0: entity work.RAM
-        generic map (
-            G_DATA_WIDTH => G_RAM_DATA_WIDTH,
-            G_ADDR_WIDTH => G_RAM_ADDR_WIDTH
-        )
-        port map (
-            clk => clk,
-            rd => rd,
-            wr => w_wr_array(0),
-            rd_addr => rd_addr,
-            wr_addr => w_wr_addr(0),
-            data_in => w_data_in,
-            data_out => data_out_0
-        );
-
-    RAM_i1: entity work.RAM
-        generic map (
-            G_DATA_WIDTH => G_RAM_DATA_WIDTH,
-            G_ADDR_WIDTH => G_RAM_ADDR_WIDTH
-        )
-        port map (
-            clk => clk,
-            rd => rd,
-            wr => w_wr_array(1),
-            rd_addr => rd_addr,
-            wr_addr => w_wr_addr(1),
-            data_in => w_data_in,
-            data_out => data_out_1
-        );
-
-    w_data_in <= asi_input_data_data;
+    RAMS: for i in 0 to G_RAM_COUNT-1 generate
+        RAM_i: entity work.RAM_line
+            generic map (
+                G_DATA_WIDTH => G_RAM_DATA_WIDTH,
+                G_ADDR_WIDTH => G_RAM_ADDR_WIDTH
+            )
+            port map (
+                clk => clk,
+                rd => rd,
+                wr => w_wr_array(i),
+                rd_addr_even => rd_addr_even,
+                rd_addr_odd => rd_addr_odd,
+                wr_addr => w_wr_addr,
+                data_in => w_data_in,
+                data_out_even => w_data_even(i),
+                data_out_odd => w_data_odd(i)
+            );
+
+        -- Generating write signal for each RAM
+        w_wr_array(i) <= w_wr when c_wr_ram = i else '0';
+    end generate RAMS;
+
+    -- Last channel comes straight from the input, the others were collected before
+    PIXEL_DATA: process (r_pixel, asi_input_data_data) is
+    begin
+        for i in 0 to G_CHANNELS-1 loop
+            if i = G_CHANNELS-1 then
+                w_data_in(C_BYTE_WIDTH*(i+1)-1 downto C_BYTE_WIDTH*i) <= asi_input_data_data;
+            else
+                w_data_in(C_BYTE_WIDTH*(i+1)-1 downto C_BYTE_WIDTH*i) <= r_pixel(i);
+            end if;
+        end loop;
+    end process PIXEL_DATA;
 
     -- Conversions
-    w_wr_addr(0) <= std_logic_vector(to_unsigned(c_wr_addr(0), G_RAM_ADDR_WIDTH));
-    w_wr_addr(1) <= std_logic_vector(to_unsigned(c_wr_addr(1), G_RAM_ADDR_WIDTH));
+    w_wr_addr <= std_logic_vector(to_unsigned(c_wr_addr, G_RAM_ADDR_WIDTH));
 
-    -- Ready for next data when at least one RAM is not filled
-    w_asi_input_data_ready <= not (r_ram_filled(0) and r_ram_filled(1));
+    -- Ready for next data when the next RAM in the ring doesn't hold a row which is still needed
+    w_asi_input_data_ready <= '1' when
+        r_ram_filled(c_wr_ram) = '0'
+        or r_row_tag(c_wr_ram) < to_integer(unsigned(row_base))
+        or flush = '1'
+        else '0';
 
     -- Activate write signal when there is data is valid, and ready for data
-    w_wr <= (asi_input_data_valid and w_asi_input_data_ready);
-    -- Generating write signal for each RAM
-    w_wr_array(0) <= w_wr and not r_ram_filled(0) and not r_ram_sel;
-    w_wr_array(1) <= w_wr and not r_ram_filled(1) and r_ram_sel;
+    w_accept <= (asi_input_data_valid and w_asi_input_data_ready);
+    -- Row tag isn't written to the RAMs
+    w_header <= '1' when row_tag_en = '1' and c_header < 2 else '0';
+    w_wr <= w_accept and not w_header when c_channel = G_CHANNELS-1 else '0';
 
-    WRITE_POSITION: process (clk) is
-        variable v_ram_sel : integer range 0 to 1;
+    PIXEL_CHANNELS: process (clk) is
     begin
         if rising_edge(clk) then
-            -- Variable init
-            if r_ram_sel = '1' then
-                v_ram_sel := 1;
-            else
-                v_ram_sel := 0;
+            if w_accept = '1' and w_header = '0' then
+                r_pixel(c_channel) <= asi_input_data_data;
+                if c_channel = G_CHANNELS-1 or asi_input_data_eop = '1' then
+                    c_channel <= 0;
+                else
+                    c_channel <= c_channel + 1;
+                end if;
             end if;
 
-            -- If writing to currently selected RAM increment write address
-            if w_wr_array(v_ram_sel) = '1' then
-                c_wr_addr(v_ram_sel) <= c_wr_addr(v_ram_sel) + 1;
+            if reset = '1' or reset_row_count = '1' then
+                c_channel <= 0;
+            end if;
+        end if;
+    end process PIXEL_CHANNELS;
+
+    ROW_TAG: process (clk) is
+    begin
+        if rising_edge(clk) then
+            if w_accept = '1' then
+                if w_header = '1' then
+                    c_header <= c_header + 1;
+                    if c_header = 0 then
+                        r_tag_low <= asi_input_data_data;
+                    else
+                        r_tag <= to_integer(unsigned(std_logic_vector'(asi_input_data_data & r_tag_low)));
+                    end if;
+                elsif asi_input_data_eop = '1' then
+                    c_header <= 0;
+                end if;
+            end if;
+
+            if reset = '1' or reset_row_count = '1' then
+                c_header <= 0;
+            end if;
+        end if;
+    end process ROW_TAG;
+
+    WRITE_POSITION: process (clk) is
+    begin
+        if rising_edge(clk) then
+            -- If writing increment write address
+            if w_wr = '1' then
+                c_wr_addr <= c_wr_addr + 1;
                 -- If at the end of a row
                 if asi_input_data_eop = '1' then
-                    c_wr_addr(v_ram_sel) <= 0;
+                    c_wr_addr <= 0;
                 end if;
             end if;
 
-            if reset = '1' then
-                c_wr_addr(0) <= 0;
-                c_wr_addr(1) <= 0;
+            if reset = '1' or reset_row_count = '1' then
+                c_wr_addr <= 0;
             end if;
         end if;
     end process WRITE_POSITION;
 
     RAM_FILLED_STATUSES: process (clk) is
-        variable v_ram_sel : integer range 0 to 1;
     begin
         if rising_edge(clk) then
-            -- Variable init
-            if r_ram_sel = '1' then
-                v_ram_sel := 1;
-            else
-                v_ram_sel := 0;
+            -- RAM content is invalid as soon as it is being overwritten
+            if w_wr = '1' then
+                r_ram_filled(c_wr_ram) <= '0';
             end if;
 
-            -- If writing the end of a row, set ram_filled
+            -- If writing the end of a row, set ram_filled and remember the row index
             if w_wr = '1' and asi_input_data_eop = '1' then
-                r_ram_filled(v_ram_sel) <= '1';
-            end if;
-
-            -- Reset RAM filled flags
-            if ram_reset(0) = '1' then
-                r_ram_filled(0) <= '0';
+                r_ram_filled(c_wr_ram) <= '1';
+                if row_tag_en = '1' then
+                    r_row_tag(c_wr_ram) <= r_tag;
+                else
+                    r_row_tag(c_wr_ram) <= c_row_count;
+                end if;
             end if;
 
-            if ram_reset(1) = '1' then
-                r_ram_filled(1) <= '0';
+            -- Rows from the previous image must not be found
+            if reset_row_count = '1' then
+                r_ram_filled <= (others => '0');
             end if;
 
             if reset = '1' then
                 r_ram_filled <= (others => '0');
+                r_row_tag <= (others => 0);
             end if;
         end if;
     end process RAM_FILLED_STATUSES;
 
     RAM_SELECT: process (clk) is
-        variable v_ram_sel : integer range 0 to 1;
     begin
         if rising_edge(clk) then
-            -- Variable init
-            if r_ram_sel = '1' then
-                v_ram_sel := 1;
-            else
-                v_ram_sel := 0;
+            -- If writing the end of a row, move to the next RAM in the ring
+            if w_wr = '1' and asi_input_data_eop = '1' then
+                if c_wr_ram = G_RAM_COUNT-1 then
+                    c_wr_ram <= 0;
+                else
+                    c_wr_ram <= c_wr_ram + 1;
+                end if;
             end if;
 
-            -- If writing the end of a row, toggle ram_sel
-            if w_wr_array(v_ram_sel) = '1' and asi_input_data_eop = '1' then
-                r_ram_sel <= not r_ram_sel;
+            if reset = '1' or reset_row_count = '1' then
+                c_wr_ram <= 0;
             end if;
+        end if;
+    end process RAM_SELECT;
+
+    -- Looking up the RAMs holding the requested rows
+    ROW_LOOKUP: process (r_ram_filled, r_row_tag, row_top, row_bottom) is
+        variable v_top_found    : std_logic;
+        variable v_bottom_found : std_logic;
+    begin
+        v_top_found := '0';
+        v_bottom_found := '0';
+        w_sel_top <= 0;
+        w_sel_bottom <= 0;
+        for i in 0 to G_RAM_COUNT-1 loop
+            if r_ram_filled(i) = '1' and r_row_tag(i) = to_integer(unsigned(row_top)) then
+                w_sel_top <= i;
+                v_top_found := '1';
+            end if;
+            if r_ram_filled(i) = '1' and r_row_tag(i) = to_integer(unsigned(row_bottom)) then
+                w_sel_bottom <= i;
+                v_bottom_found := '1';
+            end if;
+        end loop;
+        rows_ready <= v_top_found and v_bottom_found;
+    end process ROW_LOOKUP;
 
+    -- RAM selection is registered at the same time the RAM outputs are
+    READ_SELECT: process (clk) is
+    begin
+        if rising_edge(clk) then
+            if rd = '1' then
+                r_sel_top <= w_sel_top;
+                r_sel_bottom <= w_sel_bottom;
+            end if;
             if reset = '1' then
-                r_ram_sel <= '0';
+                r_sel_top <= 0;
+                r_sel_bottom <= 0;
             end if;
         end if;
-    end process RAM_SELECT;
+    end process READ_SELECT;
+
+    data_top_even <= w_data_even(r_sel_top);
+    data_top_odd <= w_data_odd(r_sel_top);
+    data_bottom_even <= w_data_even(r_sel_bottom);
+    data_bottom_odd <= w_data_odd(r_sel_bottom);
 
     COUNT_ROWS: process (clk) is
     begin
@@ -200,7 +311,6 @@ begin
 
     -- Assignments
     asi_input_data_ready <= w_asi_input_data_ready;
-    ram_filled <= r_ram_filled;
-    ram_sel <= r_ram_sel;
+    header <= w_header;
 
 end architecture rtl; -- of RAM_writer
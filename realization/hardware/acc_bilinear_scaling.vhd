@@ -5,6 +5,15 @@ use IEEE.numeric_std.all;
 use work.acc_bilinear_scaling_PK.all;
 
 entity acc_bilinear_scaling is
+    generic (
+        -- Number of line buffers, rows beyond the two being processed are loaded in the background
+        G_LINE_COUNT                    : natural := C_LINE_COUNT;
+        -- Number of output pixels buffered, computation continues during sink stalls until it fills up
+        G_OUT_FIFO_DEPTH                : natural := C_OUT_FIFO_DEPTH;
+        -- Channels of an interleaved pixel, streamed a channel per beat, widths and
+        -- positions are in pixels and all channels use the same coordinates
+        G_CHANNELS                      : natural := C_CHANNELS
+    );
     port (
         clk                             : in  std_logic;
         reset                           : in  std_logic;
@@ -23,24 +32,31 @@ entity acc_bilinear_scaling is
         params_write                    : in  std_logic;
         params_readdata                 : out std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
         params_writedata                : in  std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
-        params_waitrequest              : out std_logic
+        params_waitrequest              : out std_logic;
+        ins_done_irq                    : out std_logic
     );
 end entity acc_bilinear_scaling;
 
 architecture rtl of acc_bilinear_scaling is
     -- Amount of delay from the start of calculation to ASO output
-    constant C_VALID_DELAY  : natural := 3;
+    constant C_VALID_DELAY  : natural := 4;
+    -- Line buffer words and pipeline hold all channels of a pixel
+    constant C_PIXEL_WIDTH  : natural := C_DATA_WIDTH*G_CHANNELS;
 
     -- Arrays declared for RAM signals of both RAMs
-    type ram_data_t     is array (0 to 1) of std_logic_vector(C_DATA_WIDTH-1 downto 0);
+    type ram_data_t     is array (0 to 1) of std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
     type ram_addr_t     is array (0 to 1) of std_logic_vector(C_ADDR_WIDTH-1 downto 0);
     type ram_counter_t  is array (0 to 1) of integer range 0 to C_RAM_DEPTH-1;
     -- Register map array
     type register_map_t is array (0 to 2**C_MM_ADDR_WIDTH-1) of std_logic_vector(C_MM_DATA_WIDTH - 1 downto 0);
+    -- Performance counters array
+    type perf_counters_t is array (0 to C_PERF_COUNT-1) of unsigned(C_PERF_WIDTH-1 downto 0);
     -- Pixel group row data type
-    type row_data_t     is array (0 to 1) of integer range 0 to 2**C_DATA_WIDTH-1;
+    type row_data_t     is array (0 to 1) of std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
+    -- Calculation subproducts of every channel
+    type subp_t         is array (0 to G_CHANNELS-1) of integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
     -- Declaring states for FSM
-    type state_t        is (st_wait, st_read, st_process);
+    type state_t        is (st_wait, st_process);
 
     -- State machine signals
     signal current_state    : state_t;
@@ -55,6 +71,10 @@ architecture rtl of acc_bilinear_scaling is
     signal w_width          : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
     signal w_height         : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
     signal w_ctl            : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+    signal w_x_phase        : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_width_out      : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_y_phase        : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_height_out     : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
 
     -- Output image dimensions
     signal r_width_out      : integer range 0 to 2**C_DIM_WIDTH;
@@ -64,12 +84,10 @@ architecture rtl of acc_bilinear_scaling is
     signal c_x_out          : integer range 0 to 2**C_DIM_WIDTH;
     signal c_y_out          : integer range 0 to 2**C_DIM_WIDTH;
 
-    -- Currently active RAM
-    signal w_ram_sel        : std_logic;
-    -- RAM filled statuses
-    signal w_ram_filled     : std_logic_vector(1 downto 0);
-    -- RAM reset statuses
-    signal r_ram_reset      : std_logic_vector(1 downto 0);
+    -- Rows of the current pixel group, both are present in the line buffers
+    signal w_row_top        : std_logic_vector(C_DIM_WIDTH-1 downto 0);
+    signal w_row_bottom     : std_logic_vector(C_DIM_WIDTH-1 downto 0);
+    signal w_rows_ready     : std_logic;
     -- Number of rows written by RAM_writer
     signal w_row_cnt        : std_logic_vector(C_DIM_WIDTH-1 downto 0);
     -- Reset row count
@@ -82,13 +100,16 @@ architecture rtl of acc_bilinear_scaling is
 
     -- RAM read control signals
     signal w_ram_rd         : std_logic;
-    signal w_ram_rd_addr    : std_logic_vector(C_ADDR_WIDTH-1 downto 0);
-    signal c_ram_rd_addr    : integer range 0 to C_RAM_DEPTH-1;
-    signal w_ram_data_out   : ram_data_t;
+    signal w_ram_rd_addr_even   : std_logic_vector(C_ADDR_WIDTH-2 downto 0);
+    signal w_ram_rd_addr_odd    : std_logic_vector(C_ADDR_WIDTH-2 downto 0);
+    signal w_ram_top_even   : std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
+    signal w_ram_top_odd    : std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
+    signal w_ram_bot_even   : std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
+    signal w_ram_bot_odd    : std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
 
-    -- Registers with pixel values needed for current calculation
-    signal r_top            : row_data_t;
-    signal r_bottom         : row_data_t;
+    -- Pixel group selection, delayed until the RAM data is available
+    signal r_odd_d1         : std_logic;
+    signal r_sat_x_d1       : std_logic;
 
     -- Computation signals
     signal r_alpha_x        : integer range 0 to 2**C_NFRAC-1;
@@ -96,46 +117,82 @@ architecture rtl of acc_bilinear_scaling is
     signal r_floor_x        : integer range 0 to 2**C_DIM_WIDTH-1;
     signal r_floor_y        : integer range 0 to 2**C_DIM_WIDTH-1;
 
+    signal r_alpha_x_d1     : integer range 0 to 2**C_NFRAC-1;
     signal r_alpha_y_d1     : integer range 0 to 2**C_NFRAC-1;
+    signal r_alpha_y_d2     : integer range 0 to 2**C_NFRAC-1;
 
     -- Image coordinates signals
     signal r_x              : std_logic_vector(C_DIM_WIDTH+C_NFRAC-1 downto 0);
     signal r_y              : std_logic_vector(C_DIM_WIDTH+C_NFRAC-1 downto 0);
-    signal w_x_incremented  : integer range 0 to 2**(C_DIM_WIDTH+C_NFRAC+1)-1;
-    signal w_y_incremented  : integer range 0 to 2**(C_DIM_WIDTH+C_NFRAC+1)-1;
-    signal w_floor_x_incremented    : integer range 0 to 2**(C_DIM_WIDTH+C_NFRAC+1)-1;
-    signal w_floor_y_incremented    : integer range 0 to 2**(C_DIM_WIDTH+C_NFRAC+1)-1;
 
     -- Calculation subproducts
-    signal r_subp_topleft   : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_subp_botleft   : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_subp_topright  : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_subp_botright  : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_subp_top       : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_subp_bot       : integer range 0 to 2**(C_NFRAC+C_DATA_WIDTH)-1;
-    signal r_prod           : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+    signal r_subp_topleft   : subp_t;
+    signal r_subp_botleft   : subp_t;
+    signal r_subp_topright  : subp_t;
+    signal r_subp_botright  : subp_t;
+    signal r_subp_top       : subp_t;
+    signal r_subp_bot       : subp_t;
+    signal r_prod           : std_logic_vector(C_PIXEL_WIDTH-1 downto 0);
 
     -- Avalon Stream handshake delayed signals
     signal r_valid          : std_logic_vector(C_VALID_DELAY-1 downto 0);
     signal r_last           : std_logic_vector(C_VALID_DELAY-1 downto 0);
     signal r_sop            : std_logic_vector(C_VALID_DELAY-1 downto 0);
 
-    -- Flag indicating that all pixels that need current group of pixels
-    -- are processed and new group of pixels can be read
-    signal w_proc_flag      : std_logic;
-    signal w_need_new_row   : std_logic;
+    -- Pipeline enable, the whole pipeline moves while the output FIFO has
+    -- room for the pixels in flight
+    signal r_en             : std_logic;
+
+    -- Output FIFO signals, pixel is stored together with its end and start of packet flags
+    signal w_fifo_wr        : std_logic;
+    signal w_fifo_rd        : std_logic;
+    signal w_fifo_in        : std_logic_vector(C_PIXEL_WIDTH+1 downto 0);
+    signal w_fifo_out       : std_logic_vector(C_PIXEL_WIDTH+1 downto 0);
+    signal w_fifo_empty     : std_logic;
+    signal w_fifo_full      : std_logic;
+    signal w_fifo_almost_full : std_logic;
+
+    -- Channel of the pixel at the head of the output FIFO being streamed out,
+    -- the pixel is removed from the FIFO with its last channel
+    signal c_out_channel    : integer range 0 to G_CHANNELS-1;
+    signal w_out_data       : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+    signal w_out_beat       : std_logic;
+    signal w_out_last       : std_logic;
+    signal w_out_eop        : std_logic;
+
+    -- Flag indicating that the last pixel of the current output row is issued
+    signal w_row_done       : std_logic;
 
     -- Sticky bit to receive all rows left although not neccessary
     signal r_flush          : std_logic;
 
-    -- Informs about the read status of current pixel group
-    signal r_read_status    : std_logic_vector(2 downto 0);
+    -- Performance counters, counting while the accelerator is busy with an image
+    signal r_perf           : perf_counters_t;
+
+    -- CRC-32 register of the output pixels, seeded when an image starts
+    signal w_crc_seed       : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+    signal r_crc            : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_crc            : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+
+    -- Status flags, done and error are held until the next control reset
+    signal r_busy           : std_logic;
+    signal r_done           : std_logic;
+    signal r_error          : std_logic;
+    signal w_start          : std_logic;
+    signal w_status         : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+    signal w_y_out          : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    -- Number of bytes received in the current input row
+    signal c_in_col         : integer range 0 to 2**C_DIM_WIDTH*G_CHANNELS-1;
+    -- Current input beat is a part of the row tag
+    signal w_in_header      : std_logic;
 begin
 
     RAM_writer_i0: entity work.RAM_writer
         generic map (
-            G_RAM_DATA_WIDTH => C_DATA_WIDTH,
-            G_RAM_ADDR_WIDTH => C_ADDR_WIDTH
+            G_RAM_DATA_WIDTH => C_PIXEL_WIDTH,
+            G_RAM_ADDR_WIDTH => C_ADDR_WIDTH,
+            G_RAM_COUNT => G_LINE_COUNT,
+            G_CHANNELS => G_CHANNELS
         )
         port map (
             clk => clk,
@@ -146,14 +203,21 @@ begin
             asi_input_data_sop => asi_input_data_sop,
             asi_input_data_eop => asi_input_data_eop,
             rd => w_ram_rd,
-            rd_addr => w_ram_rd_addr,
-            data_out_0 => w_ram_data_out(0),
-            data_out_1 => w_ram_data_out(1),
-            ram_sel => w_ram_sel,
-            ram_filled => w_ram_filled,
+            rd_addr_even => w_ram_rd_addr_even,
+            rd_addr_odd => w_ram_rd_addr_odd,
+            row_top => w_row_top,
+            row_bottom => w_row_bottom,
+            rows_ready => w_rows_ready,
+            data_top_even => w_ram_top_even,
+            data_top_odd => w_ram_top_odd,
+            data_bottom_even => w_ram_bot_even,
+            data_bottom_odd => w_ram_bot_odd,
+            row_base => w_row_top,
+            flush => r_flush,
+            row_tag_en => w_ctl(C_CTL_ROW_TAG),
+            header => w_in_header,
             reset_row_count => r_ctl_reset,
-            row_count => w_row_cnt,
-            ram_reset => r_ram_reset
+            row_count => w_row_cnt
         );
 
     -- Mapping signals from register map to meaningful names
@@ -164,6 +228,12 @@ begin
     w_width  <= register_map(C_WIDTH_ADDR+1) & register_map(C_WIDTH_ADDR);
     w_height <= register_map(C_HEIGHT_ADDR+1) & register_map(C_HEIGHT_ADDR);
     w_ctl    <= register_map(C_CTL_ADDR);
+    w_x_phase   <= register_map(C_X_PHASE_ADDR+1) & register_map(C_X_PHASE_ADDR);
+    w_width_out <= register_map(C_WIDTH_OUT_ADDR+1) & register_map(C_WIDTH_OUT_ADDR);
+    w_y_phase   <= register_map(C_Y_PHASE_ADDR+1) & register_map(C_Y_PHASE_ADDR);
+    w_height_out <= register_map(C_HEIGHT_OUT_ADDR+1) & register_map(C_HEIGHT_OUT_ADDR);
+    w_crc_seed  <= register_map(C_CRC_ADDR+3) & register_map(C_CRC_ADDR+2) &
+                   register_map(C_CRC_ADDR+1) & register_map(C_CRC_ADDR);
 
     -- Calculating alpha and floor values
     r_alpha_x <= to_integer(unsigned(r_x(C_NFRAC-1 downto 0)));
@@ -171,15 +241,85 @@ begin
     r_floor_x <= to_integer(unsigned(r_x(r_x'high downto C_NFRAC)));
     r_floor_y <= to_integer(unsigned(r_y(r_y'high downto C_NFRAC)));
 
+    OUT_FIFO_i0: entity work.FIFO
+        generic map (
+            G_DATA_WIDTH => C_PIXEL_WIDTH+2,
+            G_DEPTH => G_OUT_FIFO_DEPTH,
+            G_ALMOST_FULL => G_OUT_FIFO_DEPTH-C_VALID_DELAY
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            wr => w_fifo_wr,
+            rd => w_fifo_rd,
+            data_in => w_fifo_in,
+            data_out => w_fifo_out,
+            empty => w_fifo_empty,
+            full => w_fifo_full,
+            almost_full => w_fifo_almost_full
+        );
+
+    -- Pixel leaving the pipeline is pushed to the output FIFO
+    w_fifo_in <= r_sop(0) & r_last(0) & r_prod;
+    w_fifo_wr <= r_en and r_valid(0);
+    w_fifo_rd <= aso_output_data_ready and w_out_last;
+
+    -- Channels of the pixel are sent one per beat
+    w_out_beat <= aso_output_data_ready and not w_fifo_empty;
+    w_out_last <= '1' when c_out_channel = G_CHANNELS-1 else '0';
+    w_out_eop <= w_fifo_out(C_PIXEL_WIDTH) and w_out_last;
+
+    OUT_CHANNEL_SELECT: process (w_fifo_out, c_out_channel) is
+    begin
+        w_out_data <= w_fifo_out(C_DATA_WIDTH-1 downto 0);
+        for i in 0 to G_CHANNELS-1 loop
+            if c_out_channel = i then
+                w_out_data <= w_fifo_out(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i);
+            end if;
+        end loop;
+    end process OUT_CHANNEL_SELECT;
+
+    OUT_CHANNEL: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if w_out_beat = '1' then
+                if w_out_last = '1' then
+                    c_out_channel <= 0;
+                else
+                    c_out_channel <= c_out_channel + 1;
+                end if;
+            end if;
+            if reset = '1' then
+                c_out_channel <= 0;
+            end if;
+        end if;
+    end process OUT_CHANNEL;
+
     -- Avalon Stream handshake signals
-    aso_output_data_data <= r_prod;
-    aso_output_data_valid <= r_valid(0);
-    aso_output_data_endofpacket <= r_last(0);
-    aso_output_data_startofpacket <= r_sop(0);
+    aso_output_data_data <= w_out_data;
+    aso_output_data_valid <= not w_fifo_empty;
+    aso_output_data_endofpacket <= w_out_eop;
+    aso_output_data_startofpacket <= w_fifo_out(C_PIXEL_WIDTH+1) when c_out_channel = 0 else '0';
 
     -- Connecting to output port
     asi_input_data_ready <= w_asi_input_data_ready;
 
+    assert G_OUT_FIFO_DEPTH > C_VALID_DELAY
+        report "Output FIFO must be deeper than the pipeline" severity failure;
+
+    -- Pipeline enable is registered from the FIFO fill level, so it doesn't
+    -- depend on the sink ready. The pipeline stops once the FIFO is almost
+    -- full, the slots left hold the pixels still in flight.
+    ENABLE: process(clk) is
+    begin
+        if rising_edge(clk) then
+            r_en <= not w_fifo_almost_full;
+            if reset = '1' then
+                r_en <= '1';
+            end if;
+        end if;
+    end process ENABLE;
+
     -- Sequential state change
     CONTROL_STATE: process(clk) is
     begin
@@ -192,30 +332,21 @@ begin
     end process CONTROL_STATE;
 
     -- Determines next state
-    NEXT_STATE_PROCESS: process(current_state, w_proc_flag, w_ram_filled, r_read_status, c_x_out, r_width_out) is
+    NEXT_STATE_PROCESS: process(current_state, w_row_done, w_rows_ready, r_flush) is
     begin
         case current_state is
             when st_wait =>
-                if w_ram_filled(0) = '1' and w_ram_filled(1) = '1' then
-                    next_state <= st_read;
+                -- Rows left in the line buffers after the image is processed must not be used
+                if w_rows_ready = '1' and r_flush = '0' then
+                    next_state <= st_process;
                 else
                     next_state <= st_wait;
                 end if;
-            when st_read =>
-                if r_read_status(0) = '0' then
-                    next_state <= st_read;
-                else
-                    next_state <= st_process;
-                end if;
             when st_process =>
-                if w_proc_flag = '0' then
+                if w_row_done = '0' then
                     next_state <= st_process;
                 else
-                    if c_x_out < r_width_out-1 then
-                        next_state <= st_read;
-                    else
-                        next_state <= st_wait;
-                    end if;
+                    next_state <= st_wait;
                 end if;
             when others =>
                 next_state <= st_wait;
@@ -223,6 +354,9 @@ begin
     end process NEXT_STATE_PROCESS;
 
     -- Main processing logic
+    -- Stage 1 walks the output coordinates and issues the RAM reads, stage 2
+    -- gets the pixel group from the RAMs and calculates the horizontal subproducts,
+    -- stage 3 the vertical subproducts and stage 4 the final pixel value
     PROCESSING: process(clk) is
         variable v_x        : std_logic_vector(r_x'range);
         variable v_floor_x  : integer range 0 to 2**C_DIM_WIDTH-1;
@@ -235,22 +369,14 @@ begin
         variable v_width    : integer range 0 to 2**C_DIM_WIDTH;
         variable v_height   : integer range 0 to 2**C_DIM_WIDTH;
 
-        variable v_top      : row_data_t;
-        variable v_bottom   : row_data_t;
-        variable v_row_cnt  : integer range 0 to 2**C_DIM_WIDTH - 1;
+        variable v_top          : row_data_t;
+        variable v_bottom       : row_data_t;
     begin
         if rising_edge(clk) then
             v_width  := to_integer(unsigned(w_width));
             v_height := to_integer(unsigned(w_height));
-            v_row_cnt := to_integer(unsigned(w_row_cnt));
 
-            -- Variables initialized to current values because they're used for determining v_top and v_bottom
-            v_x := std_logic_vector(unsigned(r_x));
-            v_floor_x := to_integer(unsigned(v_x(v_x'high downto C_NFRAC)));
-            v_y := std_logic_vector(unsigned(r_y));
-            v_floor_y := to_integer(unsigned(v_y(v_y'high downto C_NFRAC)));
-
-            if aso_output_data_ready = '1' then
+            if r_en = '1' then
                 r_valid <= '0' & r_valid(r_valid'high downto 1);
                 r_last <= '0' & r_last(r_last'high downto 1);
                 r_sop <= '0' & r_sop(r_sop'high downto 1);
@@ -261,7 +387,7 @@ begin
                     if (v_floor_x < v_width and c_x_out /= r_width_out-1) then
                         r_x <= v_x;
                     else
-                        r_x <= (others => '0');
+                        r_x <= std_logic_vector(resize(unsigned(w_x_phase), r_x'length));
                     end if;
 
                     v_x_out := c_x_out + 1;
@@ -280,7 +406,7 @@ begin
                         if (v_floor_y < v_height and c_y_out /= r_height_out-1) then
                             r_y <= v_y;
                         else
-                            r_y <= (others => '0');
+                            r_y <= std_logic_vector(resize(unsigned(w_y_phase), r_y'length));
                         end if;
 
                         v_y_out := c_y_out + 1;
@@ -294,18 +420,6 @@ begin
                         end if;
                     end if;
 
-                    if v_floor_y /= v_height-1 then
-                        v_top := r_top;
-                    else
-                        v_top := r_bottom;
-                    end if;
-                    v_bottom := r_bottom;
-
-                    r_subp_topleft <= (2**C_NFRAC - r_alpha_x) * v_top(0);
-                    r_subp_botleft <= (2**C_NFRAC - r_alpha_x) * v_bottom(0);
-                    r_subp_topright <= r_alpha_x * v_top(1);
-                    r_subp_botright <= r_alpha_x * v_bottom(1);
-
                     r_valid <= '1' & r_valid(r_valid'high downto 1);
                     if c_x_out = r_width_out-1 then
                         r_last <= '1' & r_last(r_last'high downto 1);
@@ -313,30 +427,82 @@ begin
                     if c_x_out = 0 then
                         r_sop <= '1' & r_sop(r_sop'high downto 1);
                     end if;
+                else
+                    -- Every row starts at the x phase, the first one at the y phase
+                    r_x <= std_logic_vector(resize(unsigned(w_x_phase), r_x'length));
+                    if c_y_out = 0 then
+                        r_y <= std_logic_vector(resize(unsigned(w_y_phase), r_y'length));
+                    end if;
                 end if;
 
-                -- These counters were held until reset_row_count was generated
-                if r_reinit = '1' then
-                    c_x_out <= 0;
-                    c_y_out <= 0;
-                    r_x <= (others => '0');
-                    r_y <= (others => '0');
+                -- Stage 1: the RAMs are read at the current floor_x, remember how
+                -- to pick the pixel group out of the banks when the data arrives
+                r_alpha_x_d1 <= r_alpha_x;
+                r_alpha_y_d1 <= r_alpha_y;
+                if r_floor_x mod 2 = 0 then
+                    r_odd_d1 <= '0';
+                else
+                    r_odd_d1 <= '1';
+                end if;
+                -- Saturating if at the end of the row
+                if r_floor_x >= v_width-1 then
+                    r_sat_x_d1 <= '1';
+                else
+                    r_sat_x_d1 <= '0';
                 end if;
 
-                r_subp_top <= (2**C_NFRAC - r_alpha_y_d1) * ((r_subp_topleft + r_subp_topright) / 2**C_NFRAC);
-                r_subp_bot <= r_alpha_y_d1 * ((r_subp_botleft + r_subp_botright) / 2**C_NFRAC);
+                -- Stage 2: left pixel is in the bank matching the floor_x parity,
+                -- right pixel is in the other one
+                if r_odd_d1 = '0' then
+                    v_top(0)    := w_ram_top_even;
+                    v_top(1)    := w_ram_top_odd;
+                    v_bottom(0) := w_ram_bot_even;
+                    v_bottom(1) := w_ram_bot_odd;
+                else
+                    v_top(0)    := w_ram_top_odd;
+                    v_top(1)    := w_ram_top_even;
+                    v_bottom(0) := w_ram_bot_odd;
+                    v_bottom(1) := w_ram_bot_even;
+                end if;
+                if r_sat_x_d1 = '1' then
+                    v_top(1) := v_top(0);
+                    v_bottom(1) := v_bottom(0);
+                end if;
 
-                r_alpha_y_d1 <= r_alpha_y;
+                r_alpha_y_d2 <= r_alpha_y_d1;
 
-                r_prod <= std_logic_vector(to_unsigned((r_subp_top + r_subp_bot) / 2**C_NFRAC, C_DATA_WIDTH));
+                -- Every channel is interpolated with the same weights
+                for c in 0 to G_CHANNELS-1 loop
+                    r_subp_topleft(c) <= (2**C_NFRAC - r_alpha_x_d1) * to_integer(unsigned(v_top(0)(C_DATA_WIDTH*(c+1)-1 downto C_DATA_WIDTH*c)));
+                    r_subp_botleft(c) <= (2**C_NFRAC - r_alpha_x_d1) * to_integer(unsigned(v_bottom(0)(C_DATA_WIDTH*(c+1)-1 downto C_DATA_WIDTH*c)));
+                    r_subp_topright(c) <= r_alpha_x_d1 * to_integer(unsigned(v_top(1)(C_DATA_WIDTH*(c+1)-1 downto C_DATA_WIDTH*c)));
+                    r_subp_botright(c) <= r_alpha_x_d1 * to_integer(unsigned(v_bottom(1)(C_DATA_WIDTH*(c+1)-1 downto C_DATA_WIDTH*c)));
+
+                    -- Stage 3
+                    r_subp_top(c) <= (2**C_NFRAC - r_alpha_y_d2) * ((r_subp_topleft(c) + r_subp_topright(c)) / 2**C_NFRAC);
+                    r_subp_bot(c) <= r_alpha_y_d2 * ((r_subp_botleft(c) + r_subp_botright(c)) / 2**C_NFRAC);
+
+                    -- Stage 4
+                    r_prod(C_DATA_WIDTH*(c+1)-1 downto C_DATA_WIDTH*c) <=
+                        std_logic_vector(to_unsigned((r_subp_top(c) + r_subp_bot(c)) / 2**C_NFRAC, C_DATA_WIDTH));
+                end loop;
             end if;
+
+            -- These counters were held until reset_row_count was generated
+            if r_reinit = '1' then
+                c_x_out <= 0;
+                c_y_out <= 0;
+                r_x <= std_logic_vector(resize(unsigned(w_x_phase), r_x'length));
+                r_y <= std_logic_vector(resize(unsigned(w_y_phase), r_y'length));
+            end if;
+
             if reset = '1' then
-                r_subp_topleft <= 0;
-                r_subp_botleft <= 0;
-                r_subp_topright <= 0;
-                r_subp_botright <= 0;
-                r_subp_top <= 0;
-                r_subp_bot <= 0;
+                r_subp_topleft <= (others => 0);
+                r_subp_botleft <= (others => 0);
+                r_subp_topright <= (others => 0);
+                r_subp_botright <= (others => 0);
+                r_subp_top <= (others => 0);
+                r_subp_bot <= (others => 0);
                 r_prod <= (others => '0');
                 r_valid <= (others => '0');
                 r_x <= (others => '0');
@@ -347,28 +513,20 @@ begin
         end if;
     end process PROCESSING;
 
-    -- Future coordinate values
-    w_x_incremented <= to_integer(unsigned(r_x)) + to_integer(unsigned(w_x_inc));
-    w_y_incremented <= to_integer(unsigned(r_y)) + to_integer(unsigned(w_y_inc));
-    w_floor_x_incremented <= w_x_incremented / 2**C_NFRAC;
-    w_floor_y_incremented <= w_y_incremented / 2**C_NFRAC;
-
-    -- Generating w_proc_flag
-    -- Current group of pixels is processed current state is st_process and new pixel is needed
-    -- and the output was ready so the pipeline moved
-    w_proc_flag <= '1' when (w_floor_x_incremented > r_floor_x or c_x_out = r_width_out-1) and current_state = st_process and aso_output_data_ready = '1' else '0';
-
-    -- New row is needed when next floor y value is greater the current, but only if the next floor y value
-    -- is in the range (not greater than image height)
-    w_need_new_row <= '1' when
-        (c_x_out = r_width_out-1
-        and w_floor_y_incremented > r_floor_y
-        and w_floor_y_incremented < to_integer(unsigned(w_height))-1)
-        else '0';
+    -- Generating w_row_done
+    -- Last pixel of the current output row is issued when current state is st_process
+    -- and the pipeline moved
+    w_row_done <= '1' when c_x_out = r_width_out-1 and current_state = st_process and r_en = '1' else '0';
+
+    -- Pixel group rows, saturating if at the last row
+    w_row_top <= std_logic_vector(to_unsigned(r_floor_y, C_DIM_WIDTH));
+    w_row_bottom <= std_logic_vector(to_unsigned(r_floor_y, C_DIM_WIDTH)) when r_floor_y >= to_integer(unsigned(w_height))-1
+        else std_logic_vector(to_unsigned(r_floor_y + 1, C_DIM_WIDTH));
 
     -- This process makes sure that all input rows are read, even if they are not
     -- used for calculation (This is neccessary at the end of the image in case of
-    -- downscaling or upscaling when truncate error piles up.)
+    -- downscaling or upscaling when truncate error piles up.) In row tag mode only
+    -- the sampled rows are sent, so there is nothing left to receive.
     FLUSH_PROCESS: process (clk) is
         variable v_height   : integer range 0 to 2**(2*C_MM_DATA_WIDTH) - 1;
         variable v_row_cnt  : integer range 0 to 2**C_DIM_WIDTH - 1;
@@ -382,7 +540,7 @@ begin
             r_reinit <= '0';
 
             -- Set when at the end of image
-            if c_x_out = r_width_out-1 and c_y_out = r_height_out-1 then
+            if w_row_done = '1' and c_y_out = r_height_out-1 then
                 r_flush <= '1';
             end if;
 
@@ -393,10 +551,8 @@ begin
 
             -- Generate r_reinit signal when all output pixels have been processed
             if c_x_out = r_width_out-1 and c_y_out = r_height_out-1 then
-                -- r_reinit will be set when w_proc_flag is genereated, meaning that processing is finished
-                -- or when there is an end of packet signal at the input which is the case when all output
-                -- pixels are processed, but there is still some input data to be flushed :(
-                r_reinit <= w_proc_flag or asi_input_data_eop;
+                -- r_reinit will be set when w_row_done is genereated, meaning that processing is finished
+                r_reinit <= w_row_done;
             end if;
 
             if reset = '1' then
@@ -406,134 +562,145 @@ begin
         end if;
     end process FLUSH_PROCESS;
 
-    CTL_REG_PROC: process(clk) is
-        variable v_address : integer range 0 to 2**C_MM_ADDR_WIDTH - 1;
+    -- Image processing starts with the first input pixel accepted after the previous image
+    w_start <= asi_input_data_valid and w_asi_input_data_ready and not r_busy and not r_flush;
+
+    -- Busy from the start of the image until the last output pixel leaves the
+    -- pipeline and the output FIFO, then done until the next control reset
+    STATUS_PROC: process(clk) is
+        variable v_width    : integer range 0 to 2**(2*C_MM_DATA_WIDTH)*G_CHANNELS - 1;
     begin
         if rising_edge(clk) then
-            v_address := to_integer(unsigned(params_address));
-            r_ctl_reset <= '0';
-            if v_address = C_CTL_ADDR and params_writedata(C_CTL_RESET) = '1' and params_write = '1' then
-                r_ctl_reset <= '1';
+            v_width := to_integer(unsigned(w_width)) * G_CHANNELS;
+
+            if w_start = '1' then
+                r_busy <= '1';
             end if;
-            if reset = '1' then
-                r_ctl_reset <= '0';
+            if r_busy = '1' and r_flush = '1' and unsigned(r_valid) = 0 and w_fifo_empty = '1' then
+                r_busy <= '0';
+                r_done <= '1';
             end if;
-        end if;
-    end process CTL_REG_PROC;
 
-    -- Generating RAM rd signal
-    w_ram_rd <= '1' when current_state = st_read else '0';
+            -- Every input row must be exactly width pixels long, not counting the row tag,
+            -- the row is counted in bytes as every channel is a separate beat
+            if asi_input_data_valid = '1' and w_asi_input_data_ready = '1' and w_in_header = '0' then
+                if asi_input_data_eop = '1' then
+                    if c_in_col /= v_width-1 then
+                        r_error <= '1';
+                    end if;
+                    c_in_col <= 0;
+                elsif c_in_col = v_width-1 then
+                    r_error <= '1';
+                else
+                    c_in_col <= c_in_col + 1;
+                end if;
+            end if;
 
-    -- Generating RAM reset signals
-    RAM_RESET_PROC: process(c_x_out, c_y_out, r_width_out, r_height_out, w_need_new_row, w_ram_sel, r_flush, w_row_cnt, r_floor_y) is
-        variable v_ram_active   : integer range 0 to 1;
-        variable v_ram_inactive : integer range 0 to 1;
-    begin
+            if r_ctl_reset = '1' then
+                r_done <= '0';
+                r_error <= '0';
+                c_in_col <= 0;
+            end if;
 
-        -- if w_ram_sel = '0' then v_ram_sel := 0; else v_ram_sel := 1; end if;
-        if w_ram_sel = '0' then
-            v_ram_active := 0;
-            v_ram_inactive := 1;
-        else
-            v_ram_active := 1;
-            v_ram_inactive := 0;
-        end if;
-        -- Default value
-        r_ram_reset <= (others => '0');
-
-        -- If at the end of row and new row is needed for computation
-        if w_need_new_row = '1' then
-            r_ram_reset(v_ram_active) <= '1';
-        -- When needed row has greater index than last row read, at least two
-        -- new rows have to be read so both RAMs are reset
-        elsif r_floor_y > to_integer(unsigned(w_row_cnt)) then
-            r_ram_reset <= (others => '1');
-        -- When needed row has equal index with the last row read, only one more row
-        -- needs to be read after the current one
-        elsif r_floor_y = to_integer(unsigned(w_row_cnt)) then
-            r_ram_reset(v_ram_inactive) <='1';
-        -- If last input rows need to be flushed
-        elsif r_flush = '1' then
-            r_ram_reset <= (others => '1');
-        -- If at the end of processing
-        elsif c_x_out = r_width_out-1 and c_y_out = r_height_out-1 then
-            r_ram_reset <= (others => '1');
-        else
-            r_ram_reset <= (others => '0');
+            if reset = '1' then
+                r_busy <= '0';
+                r_done <= '0';
+                r_error <= '0';
+                c_in_col <= 0;
+            end if;
         end if;
-    end process RAM_RESET_PROC;
-
-    RAM_READ_ADDRESS: process(current_state, r_read_status, r_floor_x, w_width) is
-        variable v_width    : integer range 0 to 2**(2*C_MM_DATA_WIDTH) - 1;
+    end process STATUS_PROC;
+
+    w_status <= (
+        C_STATUS_IDLE => not r_busy and not r_done,
+        C_STATUS_BUSY => r_busy,
+        C_STATUS_DONE => r_done,
+        C_STATUS_ERROR => r_error,
+        others => '0');
+    w_y_out <= std_logic_vector(to_unsigned(c_y_out, 2*C_MM_DATA_WIDTH));
+
+    -- Interrupt is raised when the image is done, acknowledged by the control reset
+    ins_done_irq <= r_done and w_ctl(C_CTL_IRQ_EN);
+
+    -- Counters are cleared when an image starts and hold their values after it is
+    -- processed, so they can be read out once the output DMA transfer is done
+    PERF_COUNTERS: process(clk) is
     begin
-        c_ram_rd_addr <= r_floor_x;
-        if current_state = st_read then
-            v_width := to_integer(unsigned(w_width));
-            case r_read_status is
-                when "100" =>
-                    c_ram_rd_addr <= r_floor_x;
-                when "010" =>
-                    if r_floor_x = v_width-1 then
-                        c_ram_rd_addr <= r_floor_x;
+        if rising_edge(clk) then
+            if w_start = '1' then
+                r_perf <= (others => (others => '0'));
+            end if;
+
+            if r_busy = '1' then
+                r_perf(C_PERF_BUSY) <= r_perf(C_PERF_BUSY) + 1;
+                if current_state = st_wait and r_flush = '0' then
+                    -- Rows needed for the next output row are not received yet
+                    if w_rows_ready = '0' then
+                        r_perf(C_PERF_IN_STALL) <= r_perf(C_PERF_IN_STALL) + 1;
+                    -- Rows are present, state is changing to st_process
                     else
-                        c_ram_rd_addr <= r_floor_x + 1;
+                        r_perf(C_PERF_ROW_SWITCH) <= r_perf(C_PERF_ROW_SWITCH) + 1;
                     end if;
-                when "001" =>
-                    -- If at the end of the row, saturate
-                    if r_floor_x = v_width-1 then
-                        c_ram_rd_addr <= r_floor_x;
-                    else
-                        c_ram_rd_addr <= r_floor_x + 1;
+                end if;
+                if r_en = '0' then
+                    r_perf(C_PERF_OUT_STALL) <= r_perf(C_PERF_OUT_STALL) + 1;
+                end if;
+                if w_out_beat = '1' and w_out_last = '1' then
+                    r_perf(C_PERF_PIXELS) <= r_perf(C_PERF_PIXELS) + 1;
+                    if w_out_eop = '1' then
+                        r_perf(C_PERF_ROWS) <= r_perf(C_PERF_ROWS) + 1;
                     end if;
-                when others =>
-                    c_ram_rd_addr <= r_floor_x;
-            end case;
+                end if;
+            end if;
+
+            if reset = '1' then
+                r_perf <= (others => (others => '0'));
+            end if;
         end if;
-    end process RAM_READ_ADDRESS;
-    w_ram_rd_addr <= std_logic_vector(to_unsigned(c_ram_rd_addr, C_ADDR_WIDTH));
+    end process PERF_COUNTERS;
 
-    READ_DATA_BUFFERS: process(clk) is
-        variable v_sel_top      : integer range 0 to 1;
-        variable v_sel_bottom   : integer range 0 to 1;
-        variable v_ram_sel      : integer range 0 to 1;
+    -- Seed is the CRC of the previous part of the output (0 for none), so the
+    -- CRC of a strip can be chained onto the CRC of the strips before it
+    CRC_PROC: process(clk) is
     begin
         if rising_edge(clk) then
-            if w_ram_sel = '0' then
-                v_ram_sel := 0;
-            else
-                v_ram_sel := 1;
+            if w_start = '1' then
+                r_crc <= not w_crc_seed;
+            elsif w_out_beat = '1' then
+                r_crc <= crc32_update(r_crc, w_out_data);
             end if;
 
-            if v_ram_sel = 0 then
-                v_sel_top := 0;
-                v_sel_bottom := 1;
-            else
-                v_sel_top := 1;
-                v_sel_bottom := 0;
+            if reset = '1' then
+                r_crc <= (others => '1');
             end if;
+        end if;
+    end process CRC_PROC;
 
-            if current_state = st_read then
-                case r_read_status is
-                    when "100" =>
-                        null;
-                    when "010" =>
-                        r_top(0)    <= to_integer(unsigned(w_ram_data_out(v_sel_top)));
-                        r_bottom(0) <= to_integer(unsigned(w_ram_data_out(v_sel_bottom)));
-                    when "001" =>
-                        r_top(1)    <= to_integer(unsigned(w_ram_data_out(v_sel_top)));
-                        r_bottom(1) <= to_integer(unsigned(w_ram_data_out(v_sel_bottom)));
-                    when others =>
-                        null;
-                end case;
-                r_read_status <= r_read_status(0) & r_read_status(r_read_status'high downto 1);
+    w_crc <= not r_crc;
+
+    CTL_REG_PROC: process(clk) is
+        variable v_address : integer range 0 to 2**C_MM_ADDR_WIDTH - 1;
+    begin
+        if rising_edge(clk) then
+            v_address := to_integer(unsigned(params_address));
+            r_ctl_reset <= '0';
+            if v_address = C_CTL_ADDR and params_writedata(C_CTL_RESET) = '1' and params_write = '1' then
+                r_ctl_reset <= '1';
             end if;
             if reset = '1' then
-                r_top <= (others => 0);
-                r_bottom <= (others => 0);
-                r_read_status <= (r_read_status'high => '1', others => '0');
+                r_ctl_reset <= '0';
             end if;
         end if;
-    end process READ_DATA_BUFFERS;
+    end process CTL_REG_PROC;
+
+    -- Generating RAM rd signal, RAM outputs are held while the pipeline is stalled
+    w_ram_rd <= r_en;
+
+    -- Left pixel of the group is in the bank matching the floor_x parity and the
+    -- right one in the other bank, so even bank is read at floor_x rounded up
+    -- and odd bank at floor_x rounded down
+    w_ram_rd_addr_even <= std_logic_vector(to_unsigned(((r_floor_x + 1) / 2) mod 2**(C_ADDR_WIDTH-1), C_ADDR_WIDTH-1));
+    w_ram_rd_addr_odd <= std_logic_vector(to_unsigned((r_floor_x / 2) mod 2**(C_ADDR_WIDTH-1), C_ADDR_WIDTH-1));
 
     OUTPUT_DIMS_CALC: process(clk) is
         variable v_sx       : integer range 0 to 2**C_MM_DATA_WIDTH - 1;
@@ -546,11 +713,19 @@ begin
             v_sx := to_integer(unsigned(w_sx));
 
             r_width_out <= (v_width * v_sx) / 2**C_SCALE_FRAC;
+            -- Output width of the strip is set explicitly in strip mode
+            if unsigned(w_width_out) /= 0 then
+                r_width_out <= to_integer(unsigned(w_width_out));
+            end if;
 
             v_height := to_integer(unsigned(w_height));
             v_sy := to_integer(unsigned(w_sy));
 
             r_height_out <= (v_height * v_sy) / 2**C_SCALE_FRAC;
+            -- Output height of the row band is set explicitly in row band mode
+            if unsigned(w_height_out) /= 0 then
+                r_height_out <= to_integer(unsigned(w_height_out));
+            end if;
         end if;
     end process OUTPUT_DIMS_CALC;
 
@@ -569,14 +744,36 @@ begin
         end if;
     end process WRITE_MM;
 
-    -- Avalon MM write implementation
+    -- Avalon MM read implementation
     READ_MM: process(clk) is
         variable v_address : integer range 0 to 2**C_MM_ADDR_WIDTH - 1;
+        variable v_counter : integer range 0 to C_PERF_COUNT - 1;
     begin
         if rising_edge(clk) then
             v_address := to_integer(unsigned(params_address));
             if params_read = '1' then
                 params_readdata <= register_map(v_address);
+                if v_address = C_STATUS_ADDR then
+                    params_readdata <= w_status;
+                elsif v_address = C_ROW_ADDR then
+                    params_readdata <= w_y_out(C_MM_DATA_WIDTH-1 downto 0);
+                elsif v_address = C_ROW_ADDR+1 then
+                    params_readdata <= w_y_out(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH);
+                end if;
+                for i in 0 to 3 loop
+                    if v_address = C_CRC_ADDR + i then
+                        params_readdata <= w_crc(8*i+7 downto 8*i);
+                    end if;
+                end loop;
+                -- Performance counters are read a byte at a time
+                if v_address >= C_PERF_ADDR and v_address < C_PERF_ADDR + 4*C_PERF_COUNT then
+                    v_counter := (v_address - C_PERF_ADDR) / 4;
+                    for i in 0 to 3 loop
+                        if (v_address - C_PERF_ADDR) mod 4 = i then
+                            params_readdata <= std_logic_vector(r_perf(v_counter)(8*i+7 downto 8*i));
+                        end if;
+                    end loop;
+                end if;
             end if;
             if (reset = '1') then
                 params_readdata <= (others => '0');
@@ -15,8 +15,11 @@ package acc_bilinear_scaling_PK is
     constant C_ADDR_WIDTH       : natural := 12;
     constant C_DATA_WIDTH       : natural := 8;
     constant C_RAM_DEPTH        : natural := 2**C_ADDR_WIDTH;
+    constant C_LINE_COUNT       : natural := 3;
+    constant C_OUT_FIFO_DEPTH   : natural := 16;
+    constant C_CHANNELS         : natural := 1;
 
-    constant C_MM_ADDR_WIDTH    : natural := 4;
+    constant C_MM_ADDR_WIDTH    : natural := 6;
     constant C_MM_DATA_WIDTH    : natural := 8;
 
     constant C_SX_ADDR          : natural := 0;
@@ -26,8 +29,85 @@ package acc_bilinear_scaling_PK is
     constant C_WIDTH_ADDR       : natural := 6;
     constant C_HEIGHT_ADDR      : natural := 8;
     constant C_CTL_ADDR         : natural := 10;
+    constant C_STATUS_ADDR      : natural := 11;
+    constant C_ROW_ADDR         : natural := 12;
+    -- Strip mode, starting x coordinate of every row and output width (0 for width*sx)
+    constant C_X_PHASE_ADDR     : natural := 40;
+    constant C_WIDTH_OUT_ADDR   : natural := 42;
+    -- Row band mode, starting y coordinate and output height (0 for height*sy)
+    constant C_Y_PHASE_ADDR     : natural := 44;
+    constant C_HEIGHT_OUT_ADDR  : natural := 46;
+    -- Output CRC-32, written value is the seed, read value the CRC of the output so far
+    constant C_CRC_ADDR         : natural := 52;
+    -- Lane the register map accesses go to in the multi-lane wrapper
+    constant C_LANE_ADDR        : natural := 48;
+    constant C_LANE_ALL         : natural := 2**C_MM_DATA_WIDTH-1;
 
     constant C_CTL_RESET        : natural := 0;
+    constant C_CTL_IRQ_EN       : natural := 1;
+    -- Input rows start with a 2 byte little endian row index, rows not sampled can be skipped
+    constant C_CTL_ROW_TAG      : natural := 2;
+
+    constant C_STATUS_IDLE      : natural := 0;
+    constant C_STATUS_BUSY      : natural := 1;
+    constant C_STATUS_DONE      : natural := 2;
+    constant C_STATUS_ERROR     : natural := 3;
+
+    -- Read-only performance counters, 32-bit little endian each starting at C_PERF_ADDR
+    constant C_PERF_ADDR        : natural := 16;
+    constant C_PERF_WIDTH       : natural := 32;
+    constant C_PERF_BUSY        : natural := 0;
+    constant C_PERF_IN_STALL    : natural := 1;
+    constant C_PERF_OUT_STALL   : natural := 2;
+    constant C_PERF_ROW_SWITCH  : natural := 3;
+    constant C_PERF_PIXELS      : natural := 4;
+    constant C_PERF_ROWS        : natural := 5;
+    constant C_PERF_COUNT       : natural := 6;
+
+    -- Avalon-MM master variant, its registers follow the accelerator register map
+    constant C_MM_MASTER_ADDR_WIDTH : natural := C_MM_ADDR_WIDTH + 1;
+    constant C_AVM_ADDR_WIDTH   : natural := 32;
+    constant C_AVM_BURST_WIDTH  : natural := 5;
+    constant C_AVM_BURST        : natural := 16;
+    constant C_AVM_FIFO_DEPTH   : natural := 64;
+    -- Source and destination base addresses are 32-bit, strides and ROI offsets 16-bit
+    constant C_SRC_BASE_ADDR    : natural := 64;
+    constant C_SRC_STRIDE_ADDR  : natural := 68;
+    constant C_ROI_X_ADDR       : natural := 70;
+    constant C_ROI_Y_ADDR       : natural := 72;
+    constant C_DST_BASE_ADDR    : natural := 76;
+    constant C_DST_STRIDE_ADDR  : natural := 80;
+    constant C_DMA_CTL_ADDR     : natural := 82;
+    constant C_DMA_STATUS_ADDR  : natural := 83;
+
+    constant C_DMA_CTL_START    : natural := 0;
+
+    constant C_DMA_STATUS_READ  : natural := 0;
+    constant C_DMA_STATUS_WRITE : natural := 1;
 
     constant C_NFRAC            : natural := 12;
+
+    -- CRC-32 (IEEE 802.3, reflected), same as crc32_update in the software model
+    constant C_CRC_POLY         : std_logic_vector(31 downto 0) := x"EDB88320";
+
+    function crc32_update(crc : std_logic_vector(31 downto 0); data : std_logic_vector(7 downto 0))
+        return std_logic_vector;
+end acc_bilinear_scaling_PK;
+
+package body acc_bilinear_scaling_PK is
+    -- Shifts a byte into the CRC register, LSB first
+    function crc32_update(crc : std_logic_vector(31 downto 0); data : std_logic_vector(7 downto 0))
+        return std_logic_vector is
+        variable v_crc : std_logic_vector(31 downto 0);
+    begin
+        v_crc := crc;
+        for i in 0 to 7 loop
+            if (v_crc(0) xor data(i)) = '1' then
+                v_crc := ('0' & v_crc(31 downto 1)) xor C_CRC_POLY;
+            else
+                v_crc := '0' & v_crc(31 downto 1);
+            end if;
+        end loop;
+        return v_crc;
+    end function crc32_update;
 end acc_bilinear_scaling_PK;
@@ -2,14 +2,38 @@ library IEEE;
 use IEEE.std_logic_1164.all;
 use IEEE.numeric_std.all;
 use IEEE.math_real.all;
+use IEEE.std_logic_textio.all;
+use STD.textio.all;
 
 use work.acc_bilinear_scaling_PK.all;
 
 entity acc_bilinear_scaling_TB is
-
+    generic (
+        G_SX                : real := 4.0;
+        G_SY                : real := 4.0;
+        G_WIDTH             : natural := 20;
+        G_HEIGHT            : natural := 20;
+        -- Strip mode, starting x coordinate in (4.12) fixed point and output width (0 for width*sx)
+        G_X_PHASE           : natural := 0;
+        G_WIDTH_OUT         : natural := 0;
+        -- Row tag mode, only the input rows sampled by the y coordinate walk are sent
+        G_ROW_TAG           : boolean := false;
+        -- Interleaved channels per pixel, input and reference files hold every channel of a pixel in a row
+        G_CHANNELS          : natural := C_CHANNELS;
+        G_LINE_COUNT        : natural := C_LINE_COUNT;
+        G_OUT_FIFO_DEPTH    : natural := C_OUT_FIFO_DEPTH;
+        G_VALID_PROB        : real := 0.5;
+        G_READY_PROB        : real := 0.5;
+        G_FILE_INPUT        : string := "input.txt";
+        G_FILE_OUTPUT_REF   : string := "output_ref.txt";
+        -- Vector file format, "bin" or "hex" text lines, or "raw" bytes
+        G_DATA_FORMAT       : string := "bin"
+    );
 end entity acc_bilinear_scaling_TB;
 
 architecture Test of acc_bilinear_scaling_TB is
+    type raw_file_t is file of character;
+
     signal clk : std_logic := '0';
     signal reset : std_logic := '1';
     signal asi_input_data_data : std_logic_vector (7 downto 0) := (others => '0');
@@ -24,35 +48,96 @@ architecture Test of acc_bilinear_scaling_TB is
     signal aso_output_data_ready : std_logic := '0';
     signal aso_output_data_data_err : std_logic := '1';
     signal aso_output_data_last_err : std_logic := '1';
-    signal params_address : std_logic_vector(3 downto 0)  := (others => '0');
+    signal params_address : std_logic_vector(C_MM_ADDR_WIDTH-1 downto 0)  := (others => '0');
     signal params_read : std_logic := '0';
     signal params_write : std_logic := '0';
     signal params_readdata : std_logic_vector (7 downto 0) := (others => '0');
     signal params_writedata : std_logic_vector (7 downto 0) := x"10";
     signal params_waitrequest : std_logic := '0';
+    signal ins_done_irq : std_logic := '0';
 
     constant C_TCLK : time := 20 ns;
     signal reset_source : std_logic := '1';
 
-    constant sx : real := 4.0;
-    constant sy : real := 4.0;
+    constant C_WIDTH  : natural := G_WIDTH;
+    constant C_HEIGHT : natural := G_HEIGHT;
+
+    constant C_SX_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SX * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+    constant C_SY_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SY * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+
+    -- Increments are calculated from the fixed point scaling factors, same as in the software model
+    constant sx : real := real(to_integer(unsigned(C_SX_FIXED))) / 2.0**C_SCALE_FRAC;
+    constant sy : real := real(to_integer(unsigned(C_SY_FIXED))) / 2.0**C_SCALE_FRAC;
     constant x_inc : real := 1.0/sx;
     constant y_inc : real := 1.0/sy;
 
-    constant C_WIDTH  : natural := 20;
-    constant C_HEIGHT : natural := 20;
-
-    constant C_SX_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(sx * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
-    constant C_SY_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(sy * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
     constant C_X_INC_FIXED  : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(x_inc * 2**C_NFRAC) ), 2*C_MM_DATA_WIDTH));
     constant C_Y_INC_FIXED  : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(y_inc * 2**C_NFRAC) ), 2*C_MM_DATA_WIDTH));
 
     constant C_WIDTH_FIXED : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(C_WIDTH, 2*C_MM_DATA_WIDTH));
     constant C_HEIGHT_FIXED : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(C_HEIGHT, 2*C_MM_DATA_WIDTH));
 
+    constant C_X_PHASE_FIXED : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(G_X_PHASE, 2*C_MM_DATA_WIDTH));
+    constant C_WIDTH_OUT_FIXED : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(G_WIDTH_OUT, 2*C_MM_DATA_WIDTH));
+
+    function width_out return natural is
+    begin
+        if G_WIDTH_OUT /= 0 then
+            return G_WIDTH_OUT;
+        end if;
+        return C_WIDTH * to_integer(unsigned(C_SX_FIXED)) / 2**C_SCALE_FRAC;
+    end function width_out;
+
+    constant C_WIDTH_OUT  : natural := width_out;
+    constant C_HEIGHT_OUT : natural := C_HEIGHT * to_integer(unsigned(C_SY_FIXED)) / 2**C_SCALE_FRAC;
+
+    -- Every channel is a separate beat of the streams
+    constant C_ROW_BYTES     : natural := C_WIDTH*G_CHANNELS;
+    constant C_ROW_BYTES_OUT : natural := C_WIDTH_OUT*G_CHANNELS;
+    constant C_OUT_BYTES     : natural := C_ROW_BYTES_OUT*C_HEIGHT_OUT;
+
+    -- Output file of the sink, raw bytes are not a text file
+    function output_file return string is
+    begin
+        if G_DATA_FORMAT = "raw" then
+            return "output.raw";
+        end if;
+        return "output.txt";
+    end function output_file;
+
+    type perf_values_t is array (0 to C_PERF_COUNT-1) of natural;
+
+    -- Input row is sampled by some output row, same as in the software model
+    function row_needed(row : natural) return boolean is
+        variable v_floor_y  : natural;
+        variable v_floor_y1 : natural;
+    begin
+        for v in 0 to C_HEIGHT_OUT-1 loop
+            v_floor_y := (v * to_integer(unsigned(C_Y_INC_FIXED))) / 2**C_NFRAC;
+            v_floor_y1 := v_floor_y + 1;
+            if v_floor_y >= C_HEIGHT-1 then
+                v_floor_y1 := v_floor_y;
+            end if;
+            if row = v_floor_y or row = v_floor_y1 then
+                return true;
+            end if;
+        end loop;
+        return false;
+    end function row_needed;
+
     signal avmm_addr_wr : integer range 0 to 2**C_MM_ADDR_WIDTH-1;
+
+    -- Set when the last output pixel of the frame is accepted
+    signal frame_done : std_logic := '0';
+    -- Stops the clock once all checks are done, so the simulation ends on its own
+    signal sim_done : std_logic := '0';
 begin
     DUT_i0: entity work.acc_bilinear_scaling
+        generic map (
+            G_LINE_COUNT => G_LINE_COUNT,
+            G_OUT_FIFO_DEPTH => G_OUT_FIFO_DEPTH,
+            G_CHANNELS => G_CHANNELS
+        )
         port map (
             clk => clk,
             reset => reset,
@@ -71,32 +156,109 @@ begin
             params_write => params_write,
             params_readdata => params_readdata,
             params_writedata => params_writedata,
-            params_waitrequest => params_waitrequest
+            params_waitrequest => params_waitrequest,
+            ins_done_irq => ins_done_irq
         );
 
-    AVS_SOURCE_i0 : entity work.avs_source
-        generic map (
-            G_PACKET_SIZE       => C_WIDTH,
-            G_VALID_PROB        => 0.5,
-            G_FILE_TEST_VECTORS => "input.txt",
-            G_DATA_FORMAT       => "bin"
-        )
-        port map(
-            clk => clk,
-            reset => reset_source,
-            data => asi_input_data_data,
-            valid => asi_input_data_valid,
-            ready => asi_input_data_ready,
-            last => asi_input_data_eop
-        );
+    AVS_SOURCE_GEN: if not G_ROW_TAG generate
+        AVS_SOURCE_i0 : entity work.avs_source
+            generic map (
+                G_PACKET_SIZE       => C_ROW_BYTES,
+                G_VALID_PROB        => G_VALID_PROB,
+                G_FILE_TEST_VECTORS => G_FILE_INPUT,
+                G_DATA_FORMAT       => G_DATA_FORMAT
+            )
+            port map(
+                clk => clk,
+                reset => reset_source,
+                data => asi_input_data_data,
+                valid => asi_input_data_valid,
+                ready => asi_input_data_ready,
+                last => asi_input_data_eop
+            );
+    end generate AVS_SOURCE_GEN;
+
+    -- Sends the sampled input rows, each preceded by its row index, the rest are skipped
+    ROW_TAG_SOURCE_GEN: if G_ROW_TAG generate
+        ROW_TAG_SOURCE: process is
+            type pixels_t is array (0 to C_ROW_BYTES*C_HEIGHT-1) of std_logic_vector(C_DATA_WIDTH-1 downto 0);
+            file f_input        : text;
+            file f_input_raw    : raw_file_t;
+            variable v_line     : line;
+            variable v_char     : character;
+            variable v_pixels   : pixels_t;
+            variable v_tag      : std_logic_vector(C_DIM_WIDTH-1 downto 0);
+            variable v_rows     : natural := 0;
+            variable seed1      : positive := 123;
+            variable seed2      : positive := 456;
+            variable rand       : real;
+        begin
+            if G_DATA_FORMAT = "raw" then
+                file_open(f_input_raw, G_FILE_INPUT, read_mode);
+                for i in v_pixels'range loop
+                    read(f_input_raw, v_char);
+                    v_pixels(i) := std_logic_vector(to_unsigned(character'pos(v_char), C_DATA_WIDTH));
+                end loop;
+                file_close(f_input_raw);
+            else
+                file_open(f_input, G_FILE_INPUT, read_mode);
+                for i in v_pixels'range loop
+                    readline(f_input, v_line);
+                    if G_DATA_FORMAT = "hex" then
+                        hread(v_line, v_pixels(i));
+                    else
+                        read(v_line, v_pixels(i));
+                    end if;
+                end loop;
+                file_close(f_input);
+            end if;
+
+            wait until reset_source = '0';
+
+            for row in 0 to C_HEIGHT-1 loop
+                if row_needed(row) then
+                    v_rows := v_rows + 1;
+                    v_tag := std_logic_vector(to_unsigned(row, C_DIM_WIDTH));
+                    for i in 0 to C_ROW_BYTES+1 loop
+                        if i < 2 then
+                            asi_input_data_data <= v_tag(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i);
+                        else
+                            asi_input_data_data <= v_pixels(row*C_ROW_BYTES + i-2);
+                        end if;
+                        if i = C_ROW_BYTES+1 then
+                            asi_input_data_eop <= '1';
+                        else
+                            asi_input_data_eop <= '0';
+                        end if;
+                        -- Beat is sent when valid and ready are both set on the clock edge
+                        loop
+                            uniform(seed1, seed2, rand);
+                            if rand < G_VALID_PROB then
+                                asi_input_data_valid <= '1';
+                            else
+                                asi_input_data_valid <= '0';
+                            end if;
+                            wait until rising_edge(clk);
+                            exit when asi_input_data_valid = '1' and asi_input_data_ready = '1';
+                        end loop;
+                    end loop;
+                end if;
+            end loop;
+            asi_input_data_valid <= '0';
+            asi_input_data_eop <= '0';
+
+            report "Row tag mode, sent " & integer'image(v_rows) & " of " & integer'image(C_HEIGHT) & " input rows";
+            wait;
+        end process ROW_TAG_SOURCE;
+    end generate ROW_TAG_SOURCE_GEN;
 
     AVS_SINK_i0 : entity work.avs_sink
         generic map (
-            G_PACKET_SIZE       => C_WIDTH * to_integer(unsigned(C_SX_FIXED)) / 2**C_SCALE_FRAC,
-            G_READY_PROB        => 0.5,
-            G_FILE_OUTPUT       => "output.txt",
-            G_FILE_OUTPUT_REF   => "output_ref.txt",
-            G_DATA_FORMAT       => "bin"
+            G_PACKET_SIZE       => C_ROW_BYTES_OUT,
+            G_READY_PROB        => G_READY_PROB,
+            G_FILE_OUTPUT       => output_file,
+            G_FILE_OUTPUT_REF   => G_FILE_OUTPUT_REF,
+            G_DATA_FORMAT       => G_DATA_FORMAT
         )
         port map(
             clk => clk,
@@ -109,12 +271,92 @@ begin
             error_in_last => aso_output_data_last_err
         );
 
-    clk <= not clk after C_TCLK/2;
+    clk <= not clk after C_TCLK/2 when sim_done = '0' else clk;
     reset <= '0' after C_TCLK;
 
     params_address <= std_logic_vector(to_unsigned(avmm_addr_wr, C_MM_ADDR_WIDTH));
 
+    -- Sink compares every accepted output pixel with the reference
+    OUTPUT_CHECK: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if reset = '0' then
+                assert aso_output_data_data_err = '0'
+                    report "Output pixel differs from the reference" severity error;
+                assert aso_output_data_last_err = '0'
+                    report "Output end of packet misplaced" severity error;
+            end if;
+        end if;
+    end process OUTPUT_CHECK;
+
+    -- Counts clock cycles from the moment the source starts streaming until
+    -- the last output pixel of the frame is accepted by the sink, and cycles
+    -- in which the source had valid data but the accelerator wasn't ready
+    FRAME_CYCLES: process(clk) is
+        variable v_cycles : natural := 0;
+        variable v_stalls : natural := 0;
+        variable v_bytes  : natural := 0;
+        variable v_pixels : natural := 0;
+    begin
+        if rising_edge(clk) then
+            if reset_source = '0' and v_bytes < C_OUT_BYTES then
+                v_cycles := v_cycles + 1;
+                if asi_input_data_valid = '1' and asi_input_data_ready = '0' then
+                    v_stalls := v_stalls + 1;
+                end if;
+                if aso_output_data_valid = '1' and aso_output_data_ready = '1' then
+                    v_bytes := v_bytes + 1;
+                    v_pixels := v_bytes / G_CHANNELS;
+                    if v_bytes = C_OUT_BYTES then
+                        frame_done <= '1';
+                        report "Frame " & integer'image(C_WIDTH) & "x" & integer'image(C_HEIGHT) &
+                            " -> " & integer'image(C_WIDTH_OUT) & "x" & integer'image(C_HEIGHT_OUT) &
+                            " with " & integer'image(G_CHANNELS) & " channels" &
+                            " processed in " & integer'image(v_cycles) & " cycles (" &
+                            real'image(real(v_cycles) / real(v_pixels)) & " cycles per output pixel), input stalled for " &
+                            integer'image(v_stalls) & " cycles with " & integer'image(G_LINE_COUNT) & " line buffers, " &
+                            real'image(real(v_pixels) / real(v_cycles)) & " output pixels per cycle at ready probability " &
+                            real'image(G_READY_PROB) & " with output FIFO depth " & integer'image(G_OUT_FIFO_DEPTH);
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process FRAME_CYCLES;
+
     process is
+        variable v_perf   : perf_values_t;
+        variable v_status : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        variable v_row    : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+        variable v_crc    : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+        variable v_crc_ref: std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+        variable v_pixel  : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+        variable v_line   : line;
+        variable v_char   : character;
+        file f_output_ref : text;
+        file f_output_ref_raw : raw_file_t;
+
+        -- Reads a register, read latency is one cycle
+        procedure read_reg(address : in natural; value : out std_logic_vector(C_MM_DATA_WIDTH-1 downto 0)) is
+        begin
+            avmm_addr_wr <= address;
+            params_read <= '1';
+            wait for C_TCLK;
+            params_read <= '0';
+            wait for C_TCLK;
+            value := params_readdata;
+        end procedure read_reg;
+
+        -- Reads a performance counter a byte at a time
+        procedure read_perf(index : in natural; value : out natural) is
+            variable v_value : unsigned(C_PERF_WIDTH-1 downto 0);
+            variable v_byte  : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        begin
+            for i in 0 to C_PERF_WIDTH/C_MM_DATA_WIDTH-1 loop
+                read_reg(C_PERF_ADDR + 4*index + i, v_byte);
+                v_value(C_MM_DATA_WIDTH*(i+1)-1 downto C_MM_DATA_WIDTH*i) := unsigned(v_byte);
+            end loop;
+            value := to_integer(v_value(30 downto 0));
+        end procedure read_perf;
     begin
         wait until reset='0';
         wait until rising_edge(clk);
@@ -165,16 +407,127 @@ begin
         params_write <= '1';
         wait for C_TCLK;
 
+        avmm_addr_wr <= C_X_PHASE_ADDR;
+        params_writedata <= C_X_PHASE_FIXED(C_MM_DATA_WIDTH-1 downto 0);
+        params_write <= '1';
+        wait for C_TCLK;
+        avmm_addr_wr <= C_X_PHASE_ADDR+1;
+        params_writedata <= C_X_PHASE_FIXED(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH);
+        params_write <= '1';
+        wait for C_TCLK;
+
+        avmm_addr_wr <= C_WIDTH_OUT_ADDR;
+        params_writedata <= C_WIDTH_OUT_FIXED(C_MM_DATA_WIDTH-1 downto 0);
+        params_write <= '1';
+        wait for C_TCLK;
+        avmm_addr_wr <= C_WIDTH_OUT_ADDR+1;
+        params_writedata <= C_WIDTH_OUT_FIXED(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH);
+        params_write <= '1';
+        wait for C_TCLK;
+
+        avmm_addr_wr <= C_CTL_ADDR;
+        params_writedata <= (C_CTL_IRQ_EN => '1', others => '0');
+        if G_ROW_TAG then
+            params_writedata(C_CTL_ROW_TAG) <= '1';
+        end if;
+        params_write <= '1';
+        wait for C_TCLK;
+
         params_write <= '0';
+        read_reg(C_STATUS_ADDR, v_status);
+        assert v_status(C_STATUS_IDLE) = '1' and v_status(C_STATUS_BUSY) = '0' and v_status(C_STATUS_DONE) = '0'
+            report "Accelerator not idle before the frame" severity error;
+
         reset_source <= '0';
 
-        wait for 120 ms;
+        -- Busy while processing, current output row is within the image
+        wait until aso_output_data_valid = '1';
+        wait until rising_edge(clk);
+        read_reg(C_STATUS_ADDR, v_status);
+        assert v_status(C_STATUS_BUSY) = '1' and v_status(C_STATUS_IDLE) = '0' and v_status(C_STATUS_DONE) = '0'
+            report "Accelerator not busy during the frame" severity error;
+        read_reg(C_ROW_ADDR, v_row(C_MM_DATA_WIDTH-1 downto 0));
+        read_reg(C_ROW_ADDR+1, v_row(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH));
+        report "Current output row " & integer'image(to_integer(unsigned(v_row)));
+        assert to_integer(unsigned(v_row)) < C_HEIGHT_OUT
+            report "Current output row out of range" severity error;
+
+        -- Interrupt is raised only after the last output pixel is accepted
+        wait until ins_done_irq = '1';
+        assert frame_done = '1'
+            report "Done interrupt raised before the last output pixel" severity error;
+        wait until rising_edge(clk);
+        read_reg(C_STATUS_ADDR, v_status);
+        assert v_status(C_STATUS_DONE) = '1' and v_status(C_STATUS_BUSY) = '0' and v_status(C_STATUS_IDLE) = '0'
+            report "Accelerator not done after the frame" severity error;
+        assert v_status(C_STATUS_ERROR) = '0'
+            report "Input row length error reported" severity error;
+
+        -- Reading performance counters after the frame is done
+        for i in 0 to C_PERF_COUNT-1 loop
+            read_perf(i, v_perf(i));
+        end loop;
+        report "Performance counters: busy " & integer'image(v_perf(C_PERF_BUSY)) &
+            ", input stall " & integer'image(v_perf(C_PERF_IN_STALL)) &
+            ", output stall " & integer'image(v_perf(C_PERF_OUT_STALL)) &
+            ", row switch " & integer'image(v_perf(C_PERF_ROW_SWITCH)) &
+            ", pixels " & integer'image(v_perf(C_PERF_PIXELS)) &
+            ", rows " & integer'image(v_perf(C_PERF_ROWS));
+        assert v_perf(C_PERF_PIXELS) = C_WIDTH_OUT*C_HEIGHT_OUT
+            report "Output pixel counter mismatch" severity error;
+        assert v_perf(C_PERF_ROWS) = C_HEIGHT_OUT
+            report "Output row counter mismatch" severity error;
+
+        -- Output CRC must match the CRC of the reference output
+        for i in 0 to 3 loop
+            read_reg(C_CRC_ADDR + i, v_crc(C_MM_DATA_WIDTH*(i+1)-1 downto C_MM_DATA_WIDTH*i));
+        end loop;
+        v_crc_ref := (others => '1');
+        if G_DATA_FORMAT = "raw" then
+            file_open(f_output_ref_raw, G_FILE_OUTPUT_REF, read_mode);
+            for i in 0 to C_OUT_BYTES-1 loop
+                read(f_output_ref_raw, v_char);
+                v_pixel := std_logic_vector(to_unsigned(character'pos(v_char), C_DATA_WIDTH));
+                v_crc_ref := crc32_update(v_crc_ref, v_pixel);
+            end loop;
+            file_close(f_output_ref_raw);
+        else
+            file_open(f_output_ref, G_FILE_OUTPUT_REF, read_mode);
+            for i in 0 to C_OUT_BYTES-1 loop
+                readline(f_output_ref, v_line);
+                if G_DATA_FORMAT = "hex" then
+                    hread(v_line, v_pixel);
+                else
+                    read(v_line, v_pixel);
+                end if;
+                v_crc_ref := crc32_update(v_crc_ref, v_pixel);
+            end loop;
+            file_close(f_output_ref);
+        end if;
+        v_crc_ref := not v_crc_ref;
+        write(v_line, string'("Output CRC "));
+        hwrite(v_line, v_crc);
+        write(v_line, string'(", reference CRC "));
+        hwrite(v_line, v_crc_ref);
+        report v_line.all;
+        deallocate(v_line);
+        assert v_crc = v_crc_ref
+            report "Output CRC mismatch" severity error;
+
+        -- Control reset acknowledges the interrupt
         avmm_addr_wr <= C_CTL_ADDR;
-        params_writedata <= (C_CTL_RESET => '1', others => '0');
+        params_writedata <= (C_CTL_RESET => '1', C_CTL_IRQ_EN => '1', others => '0');
         params_write <= '1';
         wait for C_TCLK;
         params_write <= '0';
+        read_reg(C_STATUS_ADDR, v_status);
+        assert ins_done_irq = '0'
+            report "Done interrupt not cleared by the control reset" severity error;
+        assert v_status(C_STATUS_IDLE) = '1' and v_status(C_STATUS_DONE) = '0'
+            report "Accelerator not idle after the control reset" severity error;
 
+        report "Simulation done";
+        sim_done <= '1';
         wait;
     end process;
 
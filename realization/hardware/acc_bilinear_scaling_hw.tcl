@@ -41,6 +41,8 @@ set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
 set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
 add_fileset_file acc_bilinear_scaling.vhd VHDL PATH acc_bilinear_scaling.vhd
 add_fileset_file RAM.vhd VHDL PATH RAM.vhd
+add_fileset_file RAM_line.vhd VHDL PATH RAM_line.vhd
+add_fileset_file FIFO.vhd VHDL PATH FIFO.vhd
 add_fileset_file acc_bilinear_scaling_PK.vhd VHDL PATH acc_bilinear_scaling_PK.vhd
 add_fileset_file RAM_writer.vhd VHDL PATH RAM_writer.vhd
 
@@ -48,6 +50,30 @@ add_fileset_file RAM_writer.vhd VHDL PATH RAM_writer.vhd
 # 
 # parameters
 # 
+add_parameter G_LINE_COUNT NATURAL 3 ""
+set_parameter_property G_LINE_COUNT DEFAULT_VALUE 3
+set_parameter_property G_LINE_COUNT DISPLAY_NAME G_LINE_COUNT
+set_parameter_property G_LINE_COUNT TYPE NATURAL
+set_parameter_property G_LINE_COUNT UNITS None
+set_parameter_property G_LINE_COUNT ALLOWED_RANGES 2:16
+set_parameter_property G_LINE_COUNT DESCRIPTION "Number of line buffers"
+set_parameter_property G_LINE_COUNT HDL_PARAMETER true
+add_parameter G_OUT_FIFO_DEPTH NATURAL 16 ""
+set_parameter_property G_OUT_FIFO_DEPTH DEFAULT_VALUE 16
+set_parameter_property G_OUT_FIFO_DEPTH DISPLAY_NAME G_OUT_FIFO_DEPTH
+set_parameter_property G_OUT_FIFO_DEPTH TYPE NATURAL
+set_parameter_property G_OUT_FIFO_DEPTH UNITS None
+set_parameter_property G_OUT_FIFO_DEPTH ALLOWED_RANGES 1:1024
+set_parameter_property G_OUT_FIFO_DEPTH DESCRIPTION "Output FIFO depth in pixels"
+set_parameter_property G_OUT_FIFO_DEPTH HDL_PARAMETER true
+add_parameter G_CHANNELS NATURAL 1 ""
+set_parameter_property G_CHANNELS DEFAULT_VALUE 1
+set_parameter_property G_CHANNELS DISPLAY_NAME G_CHANNELS
+set_parameter_property G_CHANNELS TYPE NATURAL
+set_parameter_property G_CHANNELS UNITS None
+set_parameter_property G_CHANNELS ALLOWED_RANGES 1:4
+set_parameter_property G_CHANNELS DESCRIPTION "Interleaved channels per pixel"
+set_parameter_property G_CHANNELS HDL_PARAMETER true
 
 
 # 
@@ -144,7 +170,7 @@ set_interface_property params PORT_NAME_MAP ""
 set_interface_property params CMSIS_SVD_VARIABLES ""
 set_interface_property params SVD_ADDRESS_GROUP ""
 
-add_interface_port params params_address address Input 4
+add_interface_port params params_address address Input 6
 add_interface_port params params_read read Input 1
 add_interface_port params params_write write Input 1
 add_interface_port params params_readdata readdata Output 8
@@ -169,3 +195,21 @@ set_interface_property clk SVD_ADDRESS_GROUP ""
 
 add_interface_port clk clk clk Input 1
 
+
+
+# 
+# connection point done
+# 
+add_interface done interrupt end
+set_interface_property done associatedAddressablePoint params
+set_interface_property done associatedClock clk
+set_interface_property done associatedReset reset
+set_interface_property done bridgedReceiverOffset ""
+set_interface_property done bridgesToReceiver ""
+set_interface_property done ENABLED true
+set_interface_property done EXPORT_OF ""
+set_interface_property done PORT_NAME_MAP ""
+set_interface_property done CMSIS_SVD_VARIABLES ""
+set_interface_property done SVD_ADDRESS_GROUP ""
+
+add_interface_port done ins_done_irq irq Output 1
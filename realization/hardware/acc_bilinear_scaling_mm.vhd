@@ -0,0 +1,249 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+use work.acc_bilinear_scaling_PK.all;
+
+-- Accelerator with its own Avalon-MM masters, the input region of interest is
+-- fetched from memory and the output rows are written back without external
+-- DMAs. Accelerator registers keep their addresses, master registers follow.
+entity acc_bilinear_scaling_mm is
+    generic (
+        G_LINE_COUNT                    : natural := C_LINE_COUNT;
+        G_OUT_FIFO_DEPTH                : natural := C_OUT_FIFO_DEPTH;
+        G_CHANNELS                      : natural := C_CHANNELS;
+        G_BURST                         : natural := C_AVM_BURST;
+        G_FIFO_DEPTH                    : natural := C_AVM_FIFO_DEPTH
+    );
+    port (
+        clk                             : in  std_logic;
+        reset                           : in  std_logic;
+        avm_src_address                 : out std_logic_vector(C_AVM_ADDR_WIDTH-1 downto 0);
+        avm_src_read                    : out std_logic;
+        avm_src_burstcount              : out std_logic_vector(C_AVM_BURST_WIDTH-1 downto 0);
+        avm_src_waitrequest             : in  std_logic;
+        avm_src_readdata                : in  std_logic_vector(C_DATA_WIDTH-1 downto 0);
+        avm_src_readdatavalid           : in  std_logic;
+        avm_dst_address                 : out std_logic_vector(C_AVM_ADDR_WIDTH-1 downto 0);
+        avm_dst_write                   : out std_logic;
+        avm_dst_writedata               : out std_logic_vector(C_DATA_WIDTH-1 downto 0);
+        avm_dst_waitrequest             : in  std_logic;
+        params_address                  : in  std_logic_vector(C_MM_MASTER_ADDR_WIDTH-1 downto 0);
+        params_read                     : in  std_logic;
+        params_write                    : in  std_logic;
+        params_readdata                 : out std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        params_writedata                : in  std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        params_waitrequest              : out std_logic;
+        ins_done_irq                    : out std_logic
+    );
+end entity acc_bilinear_scaling_mm;
+
+architecture rtl of acc_bilinear_scaling_mm is
+    -- Master registers
+    type register_map_t is array (C_SRC_BASE_ADDR to C_DMA_CTL_ADDR) of std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+
+    signal register_map     : register_map_t;
+    signal w_src_base       : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_src_stride     : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_roi_x          : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_roi_y          : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_dst_base       : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+    signal w_dst_stride     : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+
+    -- Copies of the accelerator input dimensions, the region of interest size
+    signal r_width          : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    signal r_height         : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+    -- Bytes in a row of the region of interest, pixels are interleaved channels
+    signal w_row_bytes      : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+
+    -- Start pulse and the address of the first byte of the region of interest
+    signal r_start          : std_logic;
+    signal w_roi_base       : std_logic_vector(C_AVM_ADDR_WIDTH-1 downto 0);
+
+    signal w_acc_write      : std_logic;
+    signal w_acc_readdata   : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+    signal w_acc_irq        : std_logic;
+    signal r_master_read    : std_logic;
+    signal r_master_readdata: std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+
+    signal w_in_data        : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+    signal w_in_valid       : std_logic;
+    signal w_in_ready       : std_logic;
+    signal w_in_eop         : std_logic;
+    signal w_out_data       : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+    signal w_out_valid      : std_logic;
+    signal w_out_ready      : std_logic;
+    signal w_out_eop        : std_logic;
+
+    signal w_read_busy      : std_logic;
+    signal w_write_busy     : std_logic;
+    signal w_status         : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+begin
+
+    ACC_i0: entity work.acc_bilinear_scaling
+        generic map (
+            G_LINE_COUNT => G_LINE_COUNT,
+            G_OUT_FIFO_DEPTH => G_OUT_FIFO_DEPTH,
+            G_CHANNELS => G_CHANNELS
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            asi_input_data_data => w_in_data,
+            asi_input_data_valid => w_in_valid,
+            asi_input_data_ready => w_in_ready,
+            asi_input_data_sop => '0',
+            asi_input_data_eop => w_in_eop,
+            aso_output_data_data => w_out_data,
+            aso_output_data_endofpacket => w_out_eop,
+            aso_output_data_startofpacket => open,
+            aso_output_data_valid => w_out_valid,
+            aso_output_data_ready => w_out_ready,
+            params_address => params_address(C_MM_ADDR_WIDTH-1 downto 0),
+            params_read => params_read,
+            params_write => w_acc_write,
+            params_readdata => w_acc_readdata,
+            params_writedata => params_writedata,
+            params_waitrequest => open,
+            ins_done_irq => w_acc_irq
+        );
+
+    MM_reader_i0: entity work.MM_reader
+        generic map (
+            G_DATA_WIDTH => C_DATA_WIDTH,
+            G_ADDR_WIDTH => C_AVM_ADDR_WIDTH,
+            G_BURST_WIDTH => C_AVM_BURST_WIDTH,
+            G_BURST => G_BURST,
+            G_FIFO_DEPTH => G_FIFO_DEPTH
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            start => r_start,
+            base => w_roi_base,
+            stride => w_src_stride,
+            width => w_row_bytes,
+            height => r_height,
+            busy => w_read_busy,
+            avm_address => avm_src_address,
+            avm_read => avm_src_read,
+            avm_burstcount => avm_src_burstcount,
+            avm_waitrequest => avm_src_waitrequest,
+            avm_readdata => avm_src_readdata,
+            avm_readdatavalid => avm_src_readdatavalid,
+            aso_data => w_in_data,
+            aso_valid => w_in_valid,
+            aso_ready => w_in_ready,
+            aso_eop => w_in_eop
+        );
+
+    MM_writer_i0: entity work.MM_writer
+        generic map (
+            G_DATA_WIDTH => C_DATA_WIDTH,
+            G_ADDR_WIDTH => C_AVM_ADDR_WIDTH
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            start => r_start,
+            base => w_dst_base,
+            stride => w_dst_stride,
+            busy => w_write_busy,
+            asi_data => w_out_data,
+            asi_valid => w_out_valid,
+            asi_ready => w_out_ready,
+            asi_eop => w_out_eop,
+            avm_address => avm_dst_address,
+            avm_write => avm_dst_write,
+            avm_writedata => avm_dst_writedata,
+            avm_waitrequest => avm_dst_waitrequest
+        );
+
+    -- Mapping signals from register map to meaningful names
+    w_src_base   <= register_map(C_SRC_BASE_ADDR+3) & register_map(C_SRC_BASE_ADDR+2) &
+                    register_map(C_SRC_BASE_ADDR+1) & register_map(C_SRC_BASE_ADDR);
+    w_src_stride <= register_map(C_SRC_STRIDE_ADDR+1) & register_map(C_SRC_STRIDE_ADDR);
+    w_roi_x      <= register_map(C_ROI_X_ADDR+1) & register_map(C_ROI_X_ADDR);
+    w_roi_y      <= register_map(C_ROI_Y_ADDR+1) & register_map(C_ROI_Y_ADDR);
+    w_dst_base   <= register_map(C_DST_BASE_ADDR+3) & register_map(C_DST_BASE_ADDR+2) &
+                    register_map(C_DST_BASE_ADDR+1) & register_map(C_DST_BASE_ADDR);
+    w_dst_stride <= register_map(C_DST_STRIDE_ADDR+1) & register_map(C_DST_STRIDE_ADDR);
+
+    w_row_bytes <= std_logic_vector(resize(unsigned(r_width) * G_CHANNELS, w_row_bytes'length));
+
+    -- First byte of the region of interest
+    w_roi_base <= std_logic_vector(unsigned(w_src_base) + resize(unsigned(w_roi_y) * unsigned(w_src_stride), C_AVM_ADDR_WIDTH)
+        + unsigned(w_roi_x));
+
+    -- Addresses past the accelerator register map are the master registers
+    w_acc_write <= params_write when unsigned(params_address) < 2**C_MM_ADDR_WIDTH else '0';
+
+    WRITE_MM: process(clk) is
+        variable v_address : integer range 0 to 2**C_MM_MASTER_ADDR_WIDTH - 1;
+    begin
+        if rising_edge(clk) then
+            v_address := to_integer(unsigned(params_address));
+            r_start <= '0';
+            if params_write = '1' then
+                if v_address >= register_map'low and v_address <= register_map'high then
+                    register_map(v_address) <= params_writedata;
+                end if;
+                if v_address = C_DMA_CTL_ADDR and params_writedata(C_DMA_CTL_START) = '1' then
+                    r_start <= '1';
+                end if;
+                -- Region of interest size is the accelerator input size
+                if v_address = C_WIDTH_ADDR then
+                    r_width(C_MM_DATA_WIDTH-1 downto 0) <= params_writedata;
+                elsif v_address = C_WIDTH_ADDR+1 then
+                    r_width(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH) <= params_writedata;
+                elsif v_address = C_HEIGHT_ADDR then
+                    r_height(C_MM_DATA_WIDTH-1 downto 0) <= params_writedata;
+                elsif v_address = C_HEIGHT_ADDR+1 then
+                    r_height(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH) <= params_writedata;
+                end if;
+            end if;
+            if reset = '1' then
+                register_map <= (others => (others => '0'));
+                r_width <= (others => '0');
+                r_height <= (others => '0');
+                r_start <= '0';
+            end if;
+        end if;
+    end process WRITE_MM;
+
+    w_status <= (
+        C_DMA_STATUS_READ => w_read_busy,
+        C_DMA_STATUS_WRITE => w_write_busy,
+        others => '0');
+
+    -- Read latency is one cycle, same as the accelerator registers
+    READ_MM: process(clk) is
+        variable v_address : integer range 0 to 2**C_MM_MASTER_ADDR_WIDTH - 1;
+    begin
+        if rising_edge(clk) then
+            v_address := to_integer(unsigned(params_address));
+            r_master_read <= '0';
+            if params_read = '1' and v_address >= 2**C_MM_ADDR_WIDTH then
+                r_master_read <= '1';
+                r_master_readdata <= (others => '0');
+                if v_address >= register_map'low and v_address <= register_map'high then
+                    r_master_readdata <= register_map(v_address);
+                elsif v_address = C_DMA_STATUS_ADDR then
+                    r_master_readdata <= w_status;
+                end if;
+            end if;
+            if reset = '1' then
+                r_master_read <= '0';
+                r_master_readdata <= (others => '0');
+            end if;
+        end if;
+    end process READ_MM;
+
+    params_readdata <= r_master_readdata when r_master_read = '1' else w_acc_readdata;
+
+    -- Done once the last output pixel is written to memory
+    ins_done_irq <= w_acc_irq and not w_write_busy;
+
+    params_waitrequest <= '0';
+
+end architecture rtl; -- of acc_bilinear_scaling_mm
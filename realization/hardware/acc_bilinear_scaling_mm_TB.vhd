@@ -0,0 +1,252 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+use IEEE.std_logic_textio.all;
+use STD.textio.all;
+
+use work.acc_bilinear_scaling_PK.all;
+
+-- Whole input image is loaded to the memory model, the accelerator fetches the
+-- region of interest and writes the output right after the input image. The
+-- output region is dumped after the done interrupt and compared against the
+-- reference file, which has to be generated for the same region of interest.
+entity acc_bilinear_scaling_mm_TB is
+    generic (
+        G_SX                : real := 4.0;
+        G_SY                : real := 4.0;
+        -- Input image in memory
+        G_SRC_WIDTH         : natural := 20;
+        G_SRC_HEIGHT        : natural := 20;
+        -- Region of interest
+        G_ROI_X             : natural := 0;
+        G_ROI_Y             : natural := 0;
+        G_WIDTH             : natural := 20;
+        G_HEIGHT            : natural := 20;
+        G_WAIT_PROB         : real := 0.3;
+        G_FILE_INPUT        : string := "input.txt";
+        G_FILE_OUTPUT_REF   : string := "output_ref.txt"
+    );
+end entity acc_bilinear_scaling_mm_TB;
+
+architecture Test of acc_bilinear_scaling_mm_TB is
+    signal clk : std_logic := '0';
+    signal reset : std_logic := '1';
+    signal avm_src_address : std_logic_vector(C_AVM_ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal avm_src_read : std_logic := '0';
+    signal avm_src_burstcount : std_logic_vector(C_AVM_BURST_WIDTH-1 downto 0) := (others => '0');
+    signal avm_src_waitrequest : std_logic := '1';
+    signal avm_src_readdata : std_logic_vector(C_DATA_WIDTH-1 downto 0) := (others => '0');
+    signal avm_src_readdatavalid : std_logic := '0';
+    signal avm_dst_address : std_logic_vector(C_AVM_ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal avm_dst_write : std_logic := '0';
+    signal avm_dst_writedata : std_logic_vector(C_DATA_WIDTH-1 downto 0) := (others => '0');
+    signal avm_dst_waitrequest : std_logic := '1';
+    signal params_address : std_logic_vector(C_MM_MASTER_ADDR_WIDTH-1 downto 0) := (others => '0');
+    signal params_read : std_logic := '0';
+    signal params_write : std_logic := '0';
+    signal params_readdata : std_logic_vector (7 downto 0) := (others => '0');
+    signal params_writedata : std_logic_vector (7 downto 0) := (others => '0');
+    signal params_waitrequest : std_logic := '0';
+    signal ins_done_irq : std_logic := '0';
+    signal dump : std_logic := '0';
+
+    constant C_TCLK : time := 20 ns;
+
+    constant C_WIDTH  : natural := G_WIDTH;
+    constant C_HEIGHT : natural := G_HEIGHT;
+
+    constant C_SX_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SX * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+    constant C_SY_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SY * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+
+    -- Increments are calculated from the fixed point scaling factors, same as in the software model
+    constant sx : real := real(to_integer(unsigned(C_SX_FIXED))) / 2.0**C_SCALE_FRAC;
+    constant sy : real := real(to_integer(unsigned(C_SY_FIXED))) / 2.0**C_SCALE_FRAC;
+
+    constant C_X_INC  : natural := integer( floor(1.0/sx * 2**C_NFRAC) );
+    constant C_Y_INC  : natural := integer( floor(1.0/sy * 2**C_NFRAC) );
+
+    constant C_WIDTH_OUT  : natural := C_WIDTH * to_integer(unsigned(C_SX_FIXED)) / 2**C_SCALE_FRAC;
+    constant C_HEIGHT_OUT : natural := C_HEIGHT * to_integer(unsigned(C_SY_FIXED)) / 2**C_SCALE_FRAC;
+
+    -- Memory layout, output rows are written without gaps right after the input image
+    constant C_SRC_BASE   : natural := 0;
+    constant C_DST_BASE   : natural := G_SRC_WIDTH*G_SRC_HEIGHT;
+    constant C_MEM_SIZE   : natural := C_DST_BASE + C_WIDTH_OUT*C_HEIGHT_OUT;
+
+    signal avmm_addr_wr : integer range 0 to 2**C_MM_MASTER_ADDR_WIDTH-1;
+begin
+    DUT_i0: entity work.acc_bilinear_scaling_mm
+        port map (
+            clk => clk,
+            reset => reset,
+            avm_src_address => avm_src_address,
+            avm_src_read => avm_src_read,
+            avm_src_burstcount => avm_src_burstcount,
+            avm_src_waitrequest => avm_src_waitrequest,
+            avm_src_readdata => avm_src_readdata,
+            avm_src_readdatavalid => avm_src_readdatavalid,
+            avm_dst_address => avm_dst_address,
+            avm_dst_write => avm_dst_write,
+            avm_dst_writedata => avm_dst_writedata,
+            avm_dst_waitrequest => avm_dst_waitrequest,
+            params_address => params_address,
+            params_read => params_read,
+            params_write => params_write,
+            params_readdata => params_readdata,
+            params_writedata => params_writedata,
+            params_waitrequest => params_waitrequest,
+            ins_done_irq => ins_done_irq
+        );
+
+    MEMORY_i0: entity work.avm_memory
+        generic map (
+            G_SIZE => C_MEM_SIZE,
+            G_WAIT_PROB => G_WAIT_PROB,
+            G_FILE_INIT => G_FILE_INPUT,
+            G_INIT_ADDR => C_SRC_BASE,
+            G_INIT_COUNT => G_SRC_WIDTH*G_SRC_HEIGHT,
+            G_FILE_DUMP => "output.txt",
+            G_DUMP_ADDR => C_DST_BASE,
+            G_DUMP_COUNT => C_WIDTH_OUT*C_HEIGHT_OUT
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            rd_address => avm_src_address,
+            rd_read => avm_src_read,
+            rd_burstcount => avm_src_burstcount,
+            rd_waitrequest => avm_src_waitrequest,
+            rd_readdata => avm_src_readdata,
+            rd_readdatavalid => avm_src_readdatavalid,
+            wr_address => avm_dst_address,
+            wr_write => avm_dst_write,
+            wr_writedata => avm_dst_writedata,
+            wr_waitrequest => avm_dst_waitrequest,
+            dump => dump
+        );
+
+    clk <= not clk after C_TCLK/2;
+    reset <= '0' after C_TCLK;
+
+    params_address <= std_logic_vector(to_unsigned(avmm_addr_wr, C_MM_MASTER_ADDR_WIDTH));
+
+    process is
+        variable v_status   : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        variable v_cycles   : natural := 0;
+
+        file f_output       : text;
+        file f_output_ref   : text;
+        variable v_line     : line;
+        variable v_ref_line : line;
+        variable v_value    : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+        variable v_ref      : std_logic_vector(C_DATA_WIDTH-1 downto 0);
+        variable v_errors   : natural := 0;
+
+        -- Writes a register
+        procedure write_reg(address : in natural; value : in std_logic_vector(C_MM_DATA_WIDTH-1 downto 0)) is
+        begin
+            avmm_addr_wr <= address;
+            params_writedata <= value;
+            params_write <= '1';
+            wait for C_TCLK;
+            params_write <= '0';
+        end procedure write_reg;
+
+        -- Writes a register of count bytes, little endian
+        procedure write_reg_n(address : in natural; value : in natural; count : in natural) is
+            variable v_value : std_logic_vector(4*C_MM_DATA_WIDTH-1 downto 0);
+        begin
+            v_value := std_logic_vector(to_unsigned(value, 4*C_MM_DATA_WIDTH));
+            for i in 0 to count-1 loop
+                write_reg(address+i, v_value(C_MM_DATA_WIDTH*(i+1)-1 downto C_MM_DATA_WIDTH*i));
+            end loop;
+        end procedure write_reg_n;
+
+        -- Reads a register, read latency is one cycle
+        procedure read_reg(address : in natural; value : out std_logic_vector(C_MM_DATA_WIDTH-1 downto 0)) is
+        begin
+            avmm_addr_wr <= address;
+            params_read <= '1';
+            wait for C_TCLK;
+            params_read <= '0';
+            wait for C_TCLK;
+            value := params_readdata;
+        end procedure read_reg;
+    begin
+        assert G_ROI_X + G_WIDTH <= G_SRC_WIDTH and G_ROI_Y + G_HEIGHT <= G_SRC_HEIGHT
+            report "Region of interest outside of the input image" severity failure;
+
+        wait until reset='0';
+        wait until rising_edge(clk);
+
+        write_reg_n(C_WIDTH_ADDR, C_WIDTH, 2);
+        write_reg_n(C_HEIGHT_ADDR, C_HEIGHT, 2);
+        write_reg(C_SX_ADDR, C_SX_FIXED);
+        write_reg(C_SY_ADDR, C_SY_FIXED);
+        write_reg_n(C_X_INC_ADDR, C_X_INC, 2);
+        write_reg_n(C_Y_INC_ADDR, C_Y_INC, 2);
+        write_reg(C_CTL_ADDR, (C_CTL_IRQ_EN => '1', others => '0'));
+
+        write_reg_n(C_SRC_BASE_ADDR, C_SRC_BASE, 4);
+        write_reg_n(C_SRC_STRIDE_ADDR, G_SRC_WIDTH, 2);
+        write_reg_n(C_ROI_X_ADDR, G_ROI_X, 2);
+        write_reg_n(C_ROI_Y_ADDR, G_ROI_Y, 2);
+        write_reg_n(C_DST_BASE_ADDR, C_DST_BASE, 4);
+        write_reg_n(C_DST_STRIDE_ADDR, C_WIDTH_OUT, 2);
+
+        -- Master registers read back
+        read_reg(C_SRC_STRIDE_ADDR, v_status);
+        assert to_integer(unsigned(v_status)) = G_SRC_WIDTH mod 2**C_MM_DATA_WIDTH
+            report "Source stride read back mismatch" severity error;
+
+        write_reg(C_DMA_CTL_ADDR, (C_DMA_CTL_START => '1', others => '0'));
+
+        -- Interrupt is raised only after the last output pixel is written
+        while ins_done_irq = '0' loop
+            wait until rising_edge(clk);
+            v_cycles := v_cycles + 1;
+        end loop;
+        report "Frame " & integer'image(C_WIDTH) & "x" & integer'image(C_HEIGHT) &
+            " -> " & integer'image(C_WIDTH_OUT) & "x" & integer'image(C_HEIGHT_OUT) &
+            " processed from memory in " & integer'image(v_cycles) & " cycles";
+
+        read_reg(C_STATUS_ADDR, v_status);
+        assert v_status(C_STATUS_DONE) = '1' and v_status(C_STATUS_ERROR) = '0'
+            report "Accelerator not done after the frame" severity error;
+        read_reg(C_DMA_STATUS_ADDR, v_status);
+        assert v_status(C_DMA_STATUS_READ) = '0' and v_status(C_DMA_STATUS_WRITE) = '0'
+            report "Masters busy after the frame" severity error;
+
+        -- Output region is compared against the reference
+        dump <= '1';
+        wait until rising_edge(clk);
+        dump <= '0';
+        wait until rising_edge(clk);
+        file_open(f_output, "output.txt", read_mode);
+        file_open(f_output_ref, G_FILE_OUTPUT_REF, read_mode);
+        for i in 0 to C_WIDTH_OUT*C_HEIGHT_OUT-1 loop
+            readline(f_output, v_line);
+            read(v_line, v_value);
+            readline(f_output_ref, v_ref_line);
+            read(v_ref_line, v_ref);
+            if v_value /= v_ref then
+                v_errors := v_errors + 1;
+            end if;
+        end loop;
+        file_close(f_output);
+        file_close(f_output_ref);
+        assert v_errors = 0
+            report integer'image(v_errors) & " output pixels differ from the reference" severity error;
+        report "Output compared, " & integer'image(v_errors) & " errors";
+
+        -- Control reset acknowledges the interrupt
+        write_reg(C_CTL_ADDR, (C_CTL_RESET => '1', others => '0'));
+        read_reg(C_STATUS_ADDR, v_status);
+        assert ins_done_irq = '0' and v_status(C_STATUS_IDLE) = '1'
+            report "Accelerator not idle after the control reset" severity error;
+
+        wait;
+    end process;
+
+end architecture Test;
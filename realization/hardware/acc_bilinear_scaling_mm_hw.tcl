@@ -0,0 +1,254 @@
+# TCL File Generated by Component Editor 20.1
+# Thu Mar 17 11:38:27 CET 2022
+# DO NOT MODIFY
+
+
+# 
+# acc_bilinear_scaling_mm "acc_bilinear_scaling_mm" v0.1
+#  2022.03.17.11:38:27
+# 
+# 
+
+# 
+# request TCL package from ACDS 16.1
+# 
+package require -exact qsys 16.1
+
+
+# 
+# module acc_bilinear_scaling_mm
+# 
+set_module_property DESCRIPTION "acc_bilinear_scaling with Avalon-MM masters fetching the input and writing the output"
+set_module_property NAME acc_bilinear_scaling_mm
+set_module_property VERSION 0.1
+set_module_property INTERNAL false
+set_module_property OPAQUE_ADDRESS_MAP true
+set_module_property AUTHOR ""
+set_module_property DISPLAY_NAME acc_bilinear_scaling_mm
+set_module_property INSTANTIATE_IN_SYSTEM_MODULE true
+set_module_property EDITABLE true
+set_module_property REPORT_TO_TALKBACK false
+set_module_property ALLOW_GREYBOX_GENERATION false
+set_module_property REPORT_HIERARCHY false
+
+
+# 
+# file sets
+# 
+add_fileset QUARTUS_SYNTH QUARTUS_SYNTH "" ""
+set_fileset_property QUARTUS_SYNTH TOP_LEVEL acc_bilinear_scaling_mm
+set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
+set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
+add_fileset_file acc_bilinear_scaling.vhd VHDL PATH acc_bilinear_scaling.vhd
+add_fileset_file RAM.vhd VHDL PATH RAM.vhd
+add_fileset_file RAM_line.vhd VHDL PATH RAM_line.vhd
+add_fileset_file FIFO.vhd VHDL PATH FIFO.vhd
+add_fileset_file acc_bilinear_scaling_PK.vhd VHDL PATH acc_bilinear_scaling_PK.vhd
+add_fileset_file RAM_writer.vhd VHDL PATH RAM_writer.vhd
+add_fileset_file MM_reader.vhd VHDL PATH MM_reader.vhd
+add_fileset_file MM_writer.vhd VHDL PATH MM_writer.vhd
+add_fileset_file acc_bilinear_scaling_mm.vhd VHDL PATH acc_bilinear_scaling_mm.vhd
+
+
+# 
+# parameters
+# 
+add_parameter G_LINE_COUNT NATURAL 3 ""
+set_parameter_property G_LINE_COUNT DEFAULT_VALUE 3
+set_parameter_property G_LINE_COUNT DISPLAY_NAME G_LINE_COUNT
+set_parameter_property G_LINE_COUNT TYPE NATURAL
+set_parameter_property G_LINE_COUNT UNITS None
+set_parameter_property G_LINE_COUNT ALLOWED_RANGES 2:16
+set_parameter_property G_LINE_COUNT DESCRIPTION "Number of line buffers"
+set_parameter_property G_LINE_COUNT HDL_PARAMETER true
+add_parameter G_OUT_FIFO_DEPTH NATURAL 16 ""
+set_parameter_property G_OUT_FIFO_DEPTH DEFAULT_VALUE 16
+set_parameter_property G_OUT_FIFO_DEPTH DISPLAY_NAME G_OUT_FIFO_DEPTH
+set_parameter_property G_OUT_FIFO_DEPTH TYPE NATURAL
+set_parameter_property G_OUT_FIFO_DEPTH UNITS None
+set_parameter_property G_OUT_FIFO_DEPTH ALLOWED_RANGES 1:1024
+set_parameter_property G_OUT_FIFO_DEPTH DESCRIPTION "Output FIFO depth in pixels"
+set_parameter_property G_OUT_FIFO_DEPTH HDL_PARAMETER true
+add_parameter G_CHANNELS NATURAL 1 ""
+set_parameter_property G_CHANNELS DEFAULT_VALUE 1
+set_parameter_property G_CHANNELS DISPLAY_NAME G_CHANNELS
+set_parameter_property G_CHANNELS TYPE NATURAL
+set_parameter_property G_CHANNELS UNITS None
+set_parameter_property G_CHANNELS ALLOWED_RANGES 1:4
+set_parameter_property G_CHANNELS DESCRIPTION "Interleaved channels per pixel"
+set_parameter_property G_CHANNELS HDL_PARAMETER true
+add_parameter G_BURST NATURAL 16 ""
+set_parameter_property G_BURST DEFAULT_VALUE 16
+set_parameter_property G_BURST DISPLAY_NAME G_BURST
+set_parameter_property G_BURST TYPE NATURAL
+set_parameter_property G_BURST UNITS None
+set_parameter_property G_BURST ALLOWED_RANGES 1:16
+set_parameter_property G_BURST DESCRIPTION "Read burst length in bytes"
+set_parameter_property G_BURST HDL_PARAMETER true
+add_parameter G_FIFO_DEPTH NATURAL 64 ""
+set_parameter_property G_FIFO_DEPTH DEFAULT_VALUE 64
+set_parameter_property G_FIFO_DEPTH DISPLAY_NAME G_FIFO_DEPTH
+set_parameter_property G_FIFO_DEPTH TYPE NATURAL
+set_parameter_property G_FIFO_DEPTH UNITS None
+set_parameter_property G_FIFO_DEPTH ALLOWED_RANGES 16:1024
+set_parameter_property G_FIFO_DEPTH DESCRIPTION "Read data FIFO depth in bytes"
+set_parameter_property G_FIFO_DEPTH HDL_PARAMETER true
+
+
+# 
+# display items
+# 
+
+
+# 
+# connection point reset
+# 
+add_interface reset reset end
+set_interface_property reset associatedClock clk
+set_interface_property reset synchronousEdges DEASSERT
+set_interface_property reset ENABLED true
+set_interface_property reset EXPORT_OF ""
+set_interface_property reset PORT_NAME_MAP ""
+set_interface_property reset CMSIS_SVD_VARIABLES ""
+set_interface_property reset SVD_ADDRESS_GROUP ""
+
+add_interface_port reset reset reset Input 1
+
+
+# 
+# connection point src
+# 
+add_interface src avalon start
+set_interface_property src addressUnits SYMBOLS
+set_interface_property src associatedClock clk
+set_interface_property src associatedReset reset
+set_interface_property src bitsPerSymbol 8
+set_interface_property src burstOnBurstBoundariesOnly false
+set_interface_property src burstcountUnits WORDS
+set_interface_property src doStreamReads false
+set_interface_property src doStreamWrites false
+set_interface_property src holdTime 0
+set_interface_property src linewrapBursts false
+set_interface_property src maximumPendingReadTransactions 0
+set_interface_property src maximumPendingWriteTransactions 0
+set_interface_property src readLatency 0
+set_interface_property src readWaitTime 1
+set_interface_property src setupTime 0
+set_interface_property src timingUnits Cycles
+set_interface_property src writeWaitTime 0
+set_interface_property src ENABLED true
+set_interface_property src EXPORT_OF ""
+set_interface_property src PORT_NAME_MAP ""
+set_interface_property src CMSIS_SVD_VARIABLES ""
+set_interface_property src SVD_ADDRESS_GROUP ""
+
+add_interface_port src avm_src_address address Output 32
+add_interface_port src avm_src_read read Output 1
+add_interface_port src avm_src_burstcount burstcount Output 5
+add_interface_port src avm_src_waitrequest waitrequest Input 1
+add_interface_port src avm_src_readdata readdata Input 8
+add_interface_port src avm_src_readdatavalid readdatavalid Input 1
+
+
+# 
+# connection point dst
+# 
+add_interface dst avalon start
+set_interface_property dst addressUnits SYMBOLS
+set_interface_property dst associatedClock clk
+set_interface_property dst associatedReset reset
+set_interface_property dst bitsPerSymbol 8
+set_interface_property dst burstOnBurstBoundariesOnly false
+set_interface_property dst burstcountUnits WORDS
+set_interface_property dst doStreamReads false
+set_interface_property dst doStreamWrites false
+set_interface_property dst holdTime 0
+set_interface_property dst linewrapBursts false
+set_interface_property dst maximumPendingReadTransactions 0
+set_interface_property dst maximumPendingWriteTransactions 0
+set_interface_property dst readLatency 0
+set_interface_property dst readWaitTime 1
+set_interface_property dst setupTime 0
+set_interface_property dst timingUnits Cycles
+set_interface_property dst writeWaitTime 0
+set_interface_property dst ENABLED true
+set_interface_property dst EXPORT_OF ""
+set_interface_property dst PORT_NAME_MAP ""
+set_interface_property dst CMSIS_SVD_VARIABLES ""
+set_interface_property dst SVD_ADDRESS_GROUP ""
+
+add_interface_port dst avm_dst_address address Output 32
+add_interface_port dst avm_dst_write write Output 1
+add_interface_port dst avm_dst_writedata writedata Output 8
+add_interface_port dst avm_dst_waitrequest waitrequest Input 1
+
+
+# 
+# connection point params
+# 
+add_interface params avalon end
+set_interface_property params addressUnits SYMBOLS
+set_interface_property params associatedClock clk
+set_interface_property params associatedReset reset
+set_interface_property params bitsPerSymbol 8
+set_interface_property params burstOnBurstBoundariesOnly false
+set_interface_property params burstcountUnits SYMBOLS
+set_interface_property params explicitAddressSpan 0
+set_interface_property params holdTime 0
+set_interface_property params linewrapBursts false
+set_interface_property params maximumPendingReadTransactions 0
+set_interface_property params maximumPendingWriteTransactions 0
+set_interface_property params readLatency 1
+set_interface_property params readWaitTime 1
+set_interface_property params setupTime 0
+set_interface_property params timingUnits Cycles
+set_interface_property params writeWaitTime 0
+set_interface_property params ENABLED true
+set_interface_property params EXPORT_OF ""
+set_interface_property params PORT_NAME_MAP ""
+set_interface_property params CMSIS_SVD_VARIABLES ""
+set_interface_property params SVD_ADDRESS_GROUP ""
+
+add_interface_port params params_address address Input 7
+add_interface_port params params_read read Input 1
+add_interface_port params params_write write Input 1
+add_interface_port params params_readdata readdata Output 8
+add_interface_port params params_writedata writedata Input 8
+add_interface_port params params_waitrequest waitrequest Output 1
+set_interface_assignment params embeddedsw.configuration.isFlash 0
+set_interface_assignment params embeddedsw.configuration.isMemoryDevice 0
+set_interface_assignment params embeddedsw.configuration.isNonVolatileStorage 0
+set_interface_assignment params embeddedsw.configuration.isPrintableDevice 0
+
+
+# 
+# connection point clk
+# 
+add_interface clk clock end
+set_interface_property clk clockRate 0
+set_interface_property clk ENABLED true
+set_interface_property clk EXPORT_OF ""
+set_interface_property clk PORT_NAME_MAP ""
+set_interface_property clk CMSIS_SVD_VARIABLES ""
+set_interface_property clk SVD_ADDRESS_GROUP ""
+
+add_interface_port clk clk clk Input 1
+
+
+
+# 
+# connection point done
+# 
+add_interface done interrupt end
+set_interface_property done associatedAddressablePoint params
+set_interface_property done associatedClock clk
+set_interface_property done associatedReset reset
+set_interface_property done bridgedReceiverOffset ""
+set_interface_property done bridgesToReceiver ""
+set_interface_property done ENABLED true
+set_interface_property done EXPORT_OF ""
+set_interface_property done PORT_NAME_MAP ""
+set_interface_property done CMSIS_SVD_VARIABLES ""
+set_interface_property done SVD_ADDRESS_GROUP ""
+
+add_interface_port done ins_done_irq irq Output 1
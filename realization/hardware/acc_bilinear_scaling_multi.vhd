@@ -0,0 +1,127 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+
+use work.acc_bilinear_scaling_PK.all;
+
+-- Multiple accelerator lanes behind a single register map, each lane has its
+-- own input and output stream and processes its own band of rows. Register
+-- accesses go to the lane selected by the lane register, writes go to all
+-- lanes when C_LANE_ALL is selected.
+entity acc_bilinear_scaling_multi is
+    generic (
+        G_LANES                         : natural := 2;
+        G_LINE_COUNT                    : natural := C_LINE_COUNT;
+        G_OUT_FIFO_DEPTH                : natural := C_OUT_FIFO_DEPTH;
+        G_CHANNELS                      : natural := C_CHANNELS
+    );
+    port (
+        clk                             : in  std_logic;
+        reset                           : in  std_logic;
+        -- Lane i uses bits C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i of data and bit i of the rest
+        asi_input_data_data             : in  std_logic_vector(C_DATA_WIDTH*G_LANES-1 downto 0);
+        asi_input_data_valid            : in  std_logic_vector(G_LANES-1 downto 0);
+        asi_input_data_ready            : out std_logic_vector(G_LANES-1 downto 0);
+        asi_input_data_sop              : in  std_logic_vector(G_LANES-1 downto 0);
+        asi_input_data_eop              : in  std_logic_vector(G_LANES-1 downto 0);
+        aso_output_data_data            : out std_logic_vector(C_DATA_WIDTH*G_LANES-1 downto 0);
+        aso_output_data_endofpacket     : out std_logic_vector(G_LANES-1 downto 0);
+        aso_output_data_startofpacket   : out std_logic_vector(G_LANES-1 downto 0);
+        aso_output_data_valid           : out std_logic_vector(G_LANES-1 downto 0);
+        aso_output_data_ready           : in  std_logic_vector(G_LANES-1 downto 0);
+        params_address                  : in  std_logic_vector(C_MM_ADDR_WIDTH-1 downto 0);
+        params_read                     : in  std_logic;
+        params_write                    : in  std_logic;
+        params_readdata                 : out std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        params_writedata                : in  std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+        params_waitrequest              : out std_logic;
+        ins_done_irq                    : out std_logic
+    );
+end entity acc_bilinear_scaling_multi;
+
+architecture rtl of acc_bilinear_scaling_multi is
+    type readdata_t is array (0 to G_LANES-1) of std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+
+    -- Selected lane
+    signal r_lane           : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+    -- Lane register is read instead of the lane registers
+    signal r_lane_read      : std_logic;
+
+    signal w_write          : std_logic_vector(G_LANES-1 downto 0);
+    signal w_readdata       : readdata_t;
+    signal w_irq            : std_logic_vector(G_LANES-1 downto 0);
+begin
+
+    LANES: for i in 0 to G_LANES-1 generate
+        LANE_i: entity work.acc_bilinear_scaling
+            generic map (
+                G_LINE_COUNT => G_LINE_COUNT,
+                G_OUT_FIFO_DEPTH => G_OUT_FIFO_DEPTH,
+                G_CHANNELS => G_CHANNELS
+            )
+            port map (
+                clk => clk,
+                reset => reset,
+                asi_input_data_data => asi_input_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i),
+                asi_input_data_valid => asi_input_data_valid(i),
+                asi_input_data_ready => asi_input_data_ready(i),
+                asi_input_data_sop => asi_input_data_sop(i),
+                asi_input_data_eop => asi_input_data_eop(i),
+                aso_output_data_data => aso_output_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i),
+                aso_output_data_endofpacket => aso_output_data_endofpacket(i),
+                aso_output_data_startofpacket => aso_output_data_startofpacket(i),
+                aso_output_data_valid => aso_output_data_valid(i),
+                aso_output_data_ready => aso_output_data_ready(i),
+                params_address => params_address,
+                params_read => params_read,
+                params_write => w_write(i),
+                params_readdata => w_readdata(i),
+                params_writedata => params_writedata,
+                params_waitrequest => open,
+                ins_done_irq => w_irq(i)
+            );
+
+        -- Lane register itself is not written to the lanes
+        w_write(i) <= params_write when
+            to_integer(unsigned(params_address)) /= C_LANE_ADDR and
+            (to_integer(unsigned(r_lane)) = i or to_integer(unsigned(r_lane)) = C_LANE_ALL)
+            else '0';
+    end generate LANES;
+
+    LANE_REG_PROC: process(clk) is
+    begin
+        if rising_edge(clk) then
+            if params_write = '1' and to_integer(unsigned(params_address)) = C_LANE_ADDR then
+                r_lane <= params_writedata;
+            end if;
+            r_lane_read <= '0';
+            if params_read = '1' and to_integer(unsigned(params_address)) = C_LANE_ADDR then
+                r_lane_read <= '1';
+            end if;
+            if reset = '1' then
+                r_lane <= (others => '0');
+                r_lane_read <= '0';
+            end if;
+        end if;
+    end process LANE_REG_PROC;
+
+    -- Reads return the data of the selected lane, first lane if all are selected
+    READ_MUX: process(r_lane, r_lane_read, w_readdata) is
+    begin
+        params_readdata <= w_readdata(0);
+        for i in 0 to G_LANES-1 loop
+            if to_integer(unsigned(r_lane)) = i then
+                params_readdata <= w_readdata(i);
+            end if;
+        end loop;
+        if r_lane_read = '1' then
+            params_readdata <= r_lane;
+        end if;
+    end process READ_MUX;
+
+    -- Interrupt is raised when any of the lanes is done
+    ins_done_irq <= '1' when unsigned(w_irq) /= 0 else '0';
+
+    params_waitrequest <= '0';
+
+end architecture rtl; -- of acc_bilinear_scaling_multi
@@ -0,0 +1,279 @@
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use IEEE.math_real.all;
+
+use work.acc_bilinear_scaling_PK.all;
+
+-- Every lane gets its own band of rows from the same input file and its output
+-- is compared against the matching rows of the same reference file. Running
+-- with G_LANES = 1 gives the single lane baseline.
+entity acc_bilinear_scaling_multi_TB is
+    generic (
+        G_LANES             : natural := 2;
+        G_SX                : real := 4.0;
+        G_SY                : real := 4.0;
+        G_WIDTH             : natural := 20;
+        G_HEIGHT            : natural := 20;
+        G_VALID_PROB        : real := 0.5;
+        G_READY_PROB        : real := 0.5;
+        G_FILE_INPUT        : string := "input.txt";
+        G_FILE_OUTPUT_REF   : string := "output_ref.txt";
+        -- Vector file format, "bin" or "hex" text lines, or "raw" bytes
+        G_DATA_FORMAT       : string := "bin"
+    );
+end entity acc_bilinear_scaling_multi_TB;
+
+architecture Test of acc_bilinear_scaling_multi_TB is
+    signal clk : std_logic := '0';
+    signal reset : std_logic := '1';
+    signal asi_input_data_data : std_logic_vector (C_DATA_WIDTH*G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_valid : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_ready : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_sop : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal asi_input_data_eop : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_data : std_logic_vector (C_DATA_WIDTH*G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_endofpacket : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_startofpacket : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_valid : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_ready : std_logic_vector(G_LANES-1 downto 0) := (others => '0');
+    signal aso_output_data_data_err : std_logic_vector(G_LANES-1 downto 0) := (others => '1');
+    signal aso_output_data_last_err : std_logic_vector(G_LANES-1 downto 0) := (others => '1');
+    signal params_address : std_logic_vector(C_MM_ADDR_WIDTH-1 downto 0)  := (others => '0');
+    signal params_read : std_logic := '0';
+    signal params_write : std_logic := '0';
+    signal params_readdata : std_logic_vector (7 downto 0) := (others => '0');
+    signal params_writedata : std_logic_vector (7 downto 0) := (others => '0');
+    signal params_waitrequest : std_logic := '0';
+    signal ins_done_irq : std_logic := '0';
+
+    constant C_TCLK : time := 20 ns;
+    signal reset_source : std_logic := '1';
+
+    constant C_WIDTH  : natural := G_WIDTH;
+    constant C_HEIGHT : natural := G_HEIGHT;
+
+    constant C_SX_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SX * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+    constant C_SY_FIXED     : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(integer( floor(G_SY * 2**C_SCALE_FRAC) ), C_MM_DATA_WIDTH));
+
+    -- Increments are calculated from the fixed point scaling factors, same as in the software model
+    constant sx : real := real(to_integer(unsigned(C_SX_FIXED))) / 2.0**C_SCALE_FRAC;
+    constant sy : real := real(to_integer(unsigned(C_SY_FIXED))) / 2.0**C_SCALE_FRAC;
+
+    constant C_X_INC  : natural := integer( floor(1.0/sx * 2**C_NFRAC) );
+    constant C_Y_INC  : natural := integer( floor(1.0/sy * 2**C_NFRAC) );
+
+    constant C_WIDTH_OUT  : natural := C_WIDTH * to_integer(unsigned(C_SX_FIXED)) / 2**C_SCALE_FRAC;
+    constant C_HEIGHT_OUT : natural := C_HEIGHT * to_integer(unsigned(C_SY_FIXED)) / 2**C_SCALE_FRAC;
+
+    -- Row bands, split the same way as in the driver
+    function band_out_start(lane : natural) return natural is
+    begin
+        return lane * C_HEIGHT_OUT / G_LANES;
+    end function band_out_start;
+
+    function band_in_start(lane : natural) return natural is
+    begin
+        return band_out_start(lane) * C_Y_INC / 2**C_NFRAC;
+    end function band_in_start;
+
+    function band_phase(lane : natural) return natural is
+    begin
+        return band_out_start(lane) * C_Y_INC mod 2**C_NFRAC;
+    end function band_phase;
+
+    -- Last input row of the band is the bottom row of its last pixel group
+    function band_in_height(lane : natural) return natural is
+        variable v_floor : natural;
+    begin
+        v_floor := (band_out_start(lane+1) - 1) * C_Y_INC / 2**C_NFRAC;
+        if v_floor < C_HEIGHT-1 then
+            v_floor := v_floor + 1;
+        end if;
+        return v_floor - band_in_start(lane) + 1;
+    end function band_in_height;
+
+    -- Output file of a lane sink, raw bytes are not a text file
+    function output_file(lane : natural) return string is
+    begin
+        if G_DATA_FORMAT = "raw" then
+            return "output_" & integer'image(lane) & ".raw";
+        end if;
+        return "output_" & integer'image(lane) & ".txt";
+    end function output_file;
+
+    signal avmm_addr_wr : integer range 0 to 2**C_MM_ADDR_WIDTH-1;
+begin
+    DUT_i0: entity work.acc_bilinear_scaling_multi
+        generic map (
+            G_LANES => G_LANES
+        )
+        port map (
+            clk => clk,
+            reset => reset,
+            asi_input_data_data => asi_input_data_data,
+            asi_input_data_valid => asi_input_data_valid,
+            asi_input_data_ready => asi_input_data_ready,
+            asi_input_data_sop => asi_input_data_sop,
+            asi_input_data_eop => asi_input_data_eop,
+            aso_output_data_data => aso_output_data_data,
+            aso_output_data_endofpacket => aso_output_data_endofpacket,
+            aso_output_data_startofpacket => aso_output_data_startofpacket,
+            aso_output_data_valid => aso_output_data_valid,
+            aso_output_data_ready => aso_output_data_ready,
+            params_address => params_address,
+            params_read => params_read,
+            params_write => params_write,
+            params_readdata => params_readdata,
+            params_writedata => params_writedata,
+            params_waitrequest => params_waitrequest,
+            ins_done_irq => ins_done_irq
+        );
+
+    LANES: for i in 0 to G_LANES-1 generate
+        AVS_SOURCE_i : entity work.avs_source
+            generic map (
+                G_PACKET_SIZE       => C_WIDTH,
+                G_VALID_PROB        => G_VALID_PROB,
+                G_FILE_TEST_VECTORS => G_FILE_INPUT,
+                G_DATA_FORMAT       => G_DATA_FORMAT,
+                G_SKIP              => band_in_start(i) * C_WIDTH,
+                G_COUNT             => band_in_height(i) * C_WIDTH
+            )
+            port map(
+                clk => clk,
+                reset => reset_source,
+                data => asi_input_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i),
+                valid => asi_input_data_valid(i),
+                ready => asi_input_data_ready(i),
+                last => asi_input_data_eop(i)
+            );
+
+        AVS_SINK_i : entity work.avs_sink
+            generic map (
+                G_PACKET_SIZE       => C_WIDTH_OUT,
+                G_READY_PROB        => G_READY_PROB,
+                G_FILE_OUTPUT       => output_file(i),
+                G_FILE_OUTPUT_REF   => G_FILE_OUTPUT_REF,
+                G_DATA_FORMAT       => G_DATA_FORMAT,
+                G_SKIP              => band_out_start(i) * C_WIDTH_OUT
+            )
+            port map(
+                clk => clk,
+                reset => reset,
+                data => aso_output_data_data(C_DATA_WIDTH*(i+1)-1 downto C_DATA_WIDTH*i),
+                ready => aso_output_data_ready(i),
+                valid => aso_output_data_valid(i),
+                last => aso_output_data_endofpacket(i),
+                error_in_data => aso_output_data_data_err(i),
+                error_in_last => aso_output_data_last_err(i)
+            );
+    end generate LANES;
+
+    clk <= not clk after C_TCLK/2;
+    reset <= '0' after C_TCLK;
+
+    params_address <= std_logic_vector(to_unsigned(avmm_addr_wr, C_MM_ADDR_WIDTH));
+
+    -- Counts clock cycles from the moment the sources start streaming until
+    -- the last output pixel of the frame is accepted by the sinks
+    FRAME_CYCLES: process(clk) is
+        variable v_cycles : natural := 0;
+        variable v_pixels : natural := 0;
+    begin
+        if rising_edge(clk) then
+            if reset_source = '0' and v_pixels < C_WIDTH_OUT*C_HEIGHT_OUT then
+                v_cycles := v_cycles + 1;
+                for i in 0 to G_LANES-1 loop
+                    if aso_output_data_valid(i) = '1' and aso_output_data_ready(i) = '1' then
+                        v_pixels := v_pixels + 1;
+                    end if;
+                end loop;
+                if v_pixels = C_WIDTH_OUT*C_HEIGHT_OUT then
+                    report "Frame " & integer'image(C_WIDTH) & "x" & integer'image(C_HEIGHT) &
+                        " -> " & integer'image(C_WIDTH_OUT) & "x" & integer'image(C_HEIGHT_OUT) &
+                        " processed by " & integer'image(G_LANES) & " lanes in " & integer'image(v_cycles) &
+                        " cycles, " & real'image(real(v_pixels) / real(v_cycles)) & " output pixels per cycle";
+                end if;
+            end if;
+        end if;
+    end process FRAME_CYCLES;
+
+    process is
+        variable v_acked  : natural := 0;
+        variable v_ctl    : std_logic_vector(C_MM_DATA_WIDTH-1 downto 0);
+
+        -- Writes a register
+        procedure write_reg(address : in natural; value : in std_logic_vector(C_MM_DATA_WIDTH-1 downto 0)) is
+        begin
+            avmm_addr_wr <= address;
+            params_writedata <= value;
+            params_write <= '1';
+            wait for C_TCLK;
+            params_write <= '0';
+        end procedure write_reg;
+
+        -- Writes a 16-bit register
+        procedure write_reg16(address : in natural; value : in natural) is
+            variable v_value : std_logic_vector(2*C_MM_DATA_WIDTH-1 downto 0);
+        begin
+            v_value := std_logic_vector(to_unsigned(value, 2*C_MM_DATA_WIDTH));
+            write_reg(address, v_value(C_MM_DATA_WIDTH-1 downto 0));
+            write_reg(address+1, v_value(2*C_MM_DATA_WIDTH-1 downto C_MM_DATA_WIDTH));
+        end procedure write_reg16;
+    begin
+        assert G_LANES <= C_HEIGHT_OUT report "More lanes than output rows" severity failure;
+
+        wait until reset='0';
+        wait until rising_edge(clk);
+
+        -- Parameters common for all lanes
+        write_reg(C_LANE_ADDR, std_logic_vector(to_unsigned(C_LANE_ALL, C_MM_DATA_WIDTH)));
+        write_reg16(C_WIDTH_ADDR, C_WIDTH);
+        write_reg(C_SX_ADDR, C_SX_FIXED);
+        write_reg(C_SY_ADDR, C_SY_FIXED);
+        write_reg16(C_X_INC_ADDR, C_X_INC);
+        write_reg16(C_Y_INC_ADDR, C_Y_INC);
+        write_reg(C_CTL_ADDR, (C_CTL_IRQ_EN => '1', others => '0'));
+
+        -- Row band of every lane
+        for i in 0 to G_LANES-1 loop
+            write_reg(C_LANE_ADDR, std_logic_vector(to_unsigned(i, C_MM_DATA_WIDTH)));
+            write_reg16(C_HEIGHT_ADDR, band_in_height(i));
+            write_reg16(C_Y_PHASE_ADDR, band_phase(i));
+            write_reg16(C_HEIGHT_OUT_ADDR, band_out_start(i+1) - band_out_start(i));
+        end loop;
+
+        reset_source <= '0';
+
+        -- Lanes acknowledge their interrupts until all of them are done
+        while v_acked < G_LANES loop
+            if ins_done_irq = '0' then
+                wait until ins_done_irq = '1';
+            end if;
+            wait until rising_edge(clk);
+            for i in 0 to G_LANES-1 loop
+                write_reg(C_LANE_ADDR, std_logic_vector(to_unsigned(i, C_MM_DATA_WIDTH)));
+                avmm_addr_wr <= C_CTL_ADDR;
+                params_read <= '1';
+                wait for C_TCLK;
+                params_read <= '0';
+                wait for C_TCLK;
+                v_ctl := params_readdata;
+                avmm_addr_wr <= C_STATUS_ADDR;
+                params_read <= '1';
+                wait for C_TCLK;
+                params_read <= '0';
+                wait for C_TCLK;
+                if params_readdata(C_STATUS_DONE) = '1' and v_ctl(C_CTL_IRQ_EN) = '1' then
+                    write_reg(C_CTL_ADDR, (others => '0'));
+                    v_acked := v_acked + 1;
+                end if;
+            end loop;
+        end loop;
+
+        report "All lanes done";
+        wait;
+    end process;
+
+end architecture Test;
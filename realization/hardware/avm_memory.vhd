@@ -0,0 +1,142 @@
+library IEEE;
+use IEEE.STD_LOGIC_1164.ALL;
+use IEEE.NUMERIC_STD.ALL;
+use IEEE.MATH_REAL.ALL;
+use STD.TEXTIO.ALL;
+use IEEE.STD_LOGIC_TEXTIO.all;
+
+-- Behavioral SDRAM model with a burst read port and a write port. Waitrequest
+-- and read data gaps are random, read data follows the request after G_LATENCY
+-- cycles. Memory is loaded from a file on reset and dumped to a file on dump.
+entity avm_memory is
+    generic (
+        G_SIZE              : natural := 2**16;
+        G_LATENCY           : natural := 3;
+        G_WAIT_PROB         : real := 0.3;
+        G_FILE_INIT         : string := "input.txt";
+        G_INIT_ADDR         : natural := 0;
+        G_INIT_COUNT        : natural := 0;
+        G_FILE_DUMP         : string := "memory.txt";
+        G_DUMP_ADDR         : natural := 0;
+        G_DUMP_COUNT        : natural := 0
+    );
+    port (
+        clk                 : in  std_logic;
+        reset               : in  std_logic;
+
+        rd_address          : in  std_logic_vector;
+        rd_read             : in  std_logic;
+        rd_burstcount       : in  std_logic_vector;
+        rd_waitrequest      : out std_logic;
+        rd_readdata         : out std_logic_vector(7 downto 0);
+        rd_readdatavalid    : out std_logic;
+
+        wr_address          : in  std_logic_vector;
+        wr_write            : in  std_logic;
+        wr_writedata        : in  std_logic_vector(7 downto 0);
+        wr_waitrequest      : out std_logic;
+
+        dump                : in  std_logic
+    );
+end avm_memory;
+
+architecture Test of avm_memory is
+    type memory_t is array (0 to G_SIZE-1) of std_logic_vector(7 downto 0);
+
+    signal r_rd_wait    : std_logic;
+    signal r_wr_wait    : std_logic;
+begin
+    rd_waitrequest <= r_rd_wait;
+    wr_waitrequest <= r_wr_wait;
+
+    process(reset, clk)
+        variable v_memory       : memory_t;
+        file f_init             : text;
+        file f_dump             : text;
+        variable v_line         : line;
+        variable v_value        : std_logic_vector(7 downto 0);
+
+        -- Burst being returned, a single burst is served at a time
+        variable v_burst_addr   : natural;
+        variable v_burst_left   : natural;
+        variable v_delay        : natural;
+
+        variable seed1          : positive;
+        variable seed2          : positive;
+        variable rand           : real;
+    begin
+        if (reset = '1') then
+            r_rd_wait <= '1';
+            r_wr_wait <= '1';
+            rd_readdatavalid <= '0';
+            rd_readdata <= (others => '0');
+            v_burst_left := 0;
+            seed1 := 321;
+            seed2 := 654;
+
+            v_memory := (others => (others => '0'));
+            if G_INIT_COUNT > 0 then
+                file_open(f_init, G_FILE_INIT, read_mode);
+                for i in 0 to G_INIT_COUNT-1 loop
+                    readline(f_init, v_line);
+                    read(v_line, v_value);
+                    v_memory(G_INIT_ADDR + i) := v_value;
+                end loop;
+                file_close(f_init);
+            end if;
+
+        elsif (rising_edge(clk)) then
+
+            -- Write accepted
+            if wr_write = '1' and r_wr_wait = '0' then
+                v_memory(to_integer(unsigned(wr_address))) := wr_writedata;
+            end if;
+
+            -- Read data of the current burst
+            rd_readdatavalid <= '0';
+            if v_burst_left > 0 then
+                if v_delay > 0 then
+                    v_delay := v_delay - 1;
+                else
+                    uniform(seed1, seed2, rand);
+                    if rand >= G_WAIT_PROB then
+                        rd_readdata <= v_memory(v_burst_addr);
+                        rd_readdatavalid <= '1';
+                        v_burst_addr := v_burst_addr + 1;
+                        v_burst_left := v_burst_left - 1;
+                    end if;
+                end if;
+            end if;
+
+            -- Read accepted, the next one waits until this burst is returned
+            if rd_read = '1' and r_rd_wait = '0' then
+                v_burst_addr := to_integer(unsigned(rd_address));
+                v_burst_left := to_integer(unsigned(rd_burstcount));
+                v_delay := G_LATENCY;
+            end if;
+
+            uniform(seed1, seed2, rand);
+            if v_burst_left = 0 and not (rd_read = '1' and r_rd_wait = '0') and rand >= G_WAIT_PROB then
+                r_rd_wait <= '0';
+            else
+                r_rd_wait <= '1';
+            end if;
+            uniform(seed1, seed2, rand);
+            if rand >= G_WAIT_PROB then
+                r_wr_wait <= '0';
+            else
+                r_wr_wait <= '1';
+            end if;
+
+            if dump = '1' then
+                file_open(f_dump, G_FILE_DUMP, write_mode);
+                for i in 0 to G_DUMP_COUNT-1 loop
+                    write(v_line, v_memory(G_DUMP_ADDR + i));
+                    writeline(f_dump, v_line);
+                end loop;
+                file_close(f_dump);
+            end if;
+        end if;
+    end process;
+
+end Test;
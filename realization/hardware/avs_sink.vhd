@@ -11,7 +11,11 @@ entity avs_sink is
         G_READY_PROB        : real := 0.5;
         G_FILE_OUTPUT       : string := "output.txt";
         G_FILE_OUTPUT_REF   : string := "output_ref.txt";
-        G_DATA_FORMAT       : string := "bin"
+        -- "bin" and "hex" are text files with a vector per line, "raw" is a binary
+        -- file with the bytes of every vector, least significant byte first
+        G_DATA_FORMAT       : string := "bin";
+        -- Number of reference vectors skipped at the start of the file
+        G_SKIP              : natural := 0
     );
     port (
         clk             : in  std_logic;
@@ -26,6 +30,8 @@ entity avs_sink is
 end avs_sink;
 
 architecture Test of avs_sink is
+    type raw_file_t is file of character;
+
     signal c_packet_data : natural range 0 to G_PACKET_SIZE-1;
     signal r_expected_data : std_logic_vector(data'range);
     signal r_rand_ready  : std_logic;
@@ -34,11 +40,13 @@ begin
     ready <= r_rand_ready;
 
     process(reset, clk)
-        file f_output               : text open write_mode is G_FILE_OUTPUT;
+        file f_output               : text;
+        file f_output_raw           : raw_file_t;
         variable v_output_line      : line;
         variable v_output_value     : std_logic_vector(data'range);
 
-        file f_output_ref           : text open read_mode is G_FILE_OUTPUT_REF;
+        file f_output_ref           : text;
+        file f_output_ref_raw       : raw_file_t;
         variable v_output_ref_line  : line;
         variable v_output_ref_value : std_logic_vector(data'range);
 
@@ -47,6 +55,57 @@ begin
         variable rand               : real;
         variable started            : std_logic := '0';
 
+        -- Reads the next reference vector, there is a vector to read
+        procedure read_ref(vector : out std_logic_vector) is
+            variable v_char     : character;
+            variable v_vector   : std_logic_vector(data'length-1 downto 0);
+        begin
+            if G_DATA_FORMAT="raw" then
+                for i in 0 to data'length/8-1 loop
+                    read(f_output_ref_raw, v_char);
+                    v_vector(8*i+7 downto 8*i) := std_logic_vector(to_unsigned(character'pos(v_char), 8));
+                end loop;
+                vector := v_vector;
+            else
+                readline(f_output_ref, v_output_ref_line);
+                if G_DATA_FORMAT="bin" then
+                    read(v_output_ref_line, vector);
+                elsif G_DATA_FORMAT="hex" then
+                    hread(v_output_ref_line, vector);
+                else
+                    assert false report "Invalid data format" severity error;
+                end if;
+            end if;
+        end procedure read_ref;
+
+        impure function ref_left return boolean is
+        begin
+            if G_DATA_FORMAT="raw" then
+                return not endfile(f_output_ref_raw);
+            end if;
+            return not endfile(f_output_ref);
+        end function ref_left;
+
+        procedure write_output(vector : in std_logic_vector) is
+            variable v_vector   : std_logic_vector(data'length-1 downto 0);
+        begin
+            if G_DATA_FORMAT="raw" then
+                v_vector := vector;
+                for i in 0 to data'length/8-1 loop
+                    write(f_output_raw, character'val(to_integer(unsigned(v_vector(8*i+7 downto 8*i)))));
+                end loop;
+            else
+                if G_DATA_FORMAT="bin" then
+                    write(v_output_line, vector);
+                elsif G_DATA_FORMAT="hex" then
+                    hwrite(v_output_line, vector);
+                else
+                    assert false report "Invalid data format" severity error;
+                end if;
+                writeline(f_output, v_output_line);
+            end if;
+        end procedure write_output;
+
     begin
         if (reset = '1') then
             c_packet_data <= 0;
@@ -55,16 +114,18 @@ begin
             error_in_data <= '0';
 
             if started='0' then
-                if (not endfile(f_output_ref)) then
-                    readline(f_output_ref, v_output_ref_line);
-                    if G_DATA_FORMAT="bin" then
-                        read(v_output_ref_line, v_output_ref_value);
-                    elsif G_DATA_FORMAT="hex" then
-                        hread(v_output_ref_line, v_output_ref_value);
-                    else
-                        assert false report "Invalid data format" severity error;
-                    end if;
-
+                if G_DATA_FORMAT="raw" then
+                    file_open(f_output_raw, G_FILE_OUTPUT, write_mode);
+                    file_open(f_output_ref_raw, G_FILE_OUTPUT_REF, read_mode);
+                else
+                    file_open(f_output, G_FILE_OUTPUT, write_mode);
+                    file_open(f_output_ref, G_FILE_OUTPUT_REF, read_mode);
+                end if;
+                for i in 1 to G_SKIP loop
+                    read_ref(v_output_ref_value);
+                end loop;
+                if ref_left then
+                    read_ref(v_output_ref_value);
                     r_expected_data <= v_output_ref_value;
                 end if;
                 started := '1';
@@ -74,7 +135,7 @@ begin
 
         elsif (rising_edge(clk)) then
 
-            if (not endfile(f_output_ref)) then
+            if ref_left then
                 r_rand_valid <= '1';
             else
                 r_rand_valid <= '0';
@@ -89,15 +150,8 @@ begin
             end if;
 
             if (r_rand_ready = '1' and valid = '1') then
-                if (not endfile(f_output_ref)) then
-                    readline(f_output_ref, v_output_ref_line);
-                    if G_DATA_FORMAT="bin" then
-                        read(v_output_ref_line, v_output_ref_value);
-                    elsif G_DATA_FORMAT="hex" then
-                        hread(v_output_ref_line, v_output_ref_value);
-                    else
-                        assert false report "Invalid data format" severity error;
-                    end if;
+                if ref_left then
+                    read_ref(v_output_ref_value);
                     r_expected_data <= v_output_ref_value;
                 else
                     r_rand_valid <= '0';
@@ -124,14 +178,7 @@ begin
                 end if;
 
                 v_output_value := data;
-                if G_DATA_FORMAT="bin" then
-                    write(v_output_line, data);
-                elsif G_DATA_FORMAT="hex" then
-                    hwrite(v_output_line, data);
-                else
-                    assert false report "Invalid data format" severity error;
-                end if;
-                writeline(f_output, v_output_line);
+                write_output(v_output_value);
 
             end if;
 
@@ -10,7 +10,12 @@ entity avs_source is
         G_PACKET_SIZE       : natural := 4;
         G_VALID_PROB        : real := 0.5;
         G_FILE_TEST_VECTORS : string := "input.txt";
-        G_DATA_FORMAT       : string := "bin"
+        -- "bin" and "hex" are text files with a vector per line, "raw" is a binary
+        -- file with the bytes of every vector, least significant byte first
+        G_DATA_FORMAT       : string := "bin";
+        -- Number of vectors skipped at the start of the file, and sent (0 for all)
+        G_SKIP              : natural := 0;
+        G_COUNT             : natural := 0
     );
     port (
         clk     : in  std_logic;
@@ -23,6 +28,8 @@ entity avs_source is
 end avs_source;
 
 architecture Test of avs_source is
+    type raw_file_t is file of character;
+
     signal c_packet_data : natural range 0 to G_PACKET_SIZE-1;
     signal r_rand_valid  : std_logic;
     signal r_done_transmitting : std_logic;
@@ -31,11 +38,44 @@ begin
 
     process(reset, clk)
         file f_test_vectors     : text;
+        file f_raw              : raw_file_t;
         variable v_input_line   : line;
         variable v_test_vector  : std_logic_vector(data'range);
         variable seed1          : positive;
         variable seed2          : positive;
         variable rand           : real;
+        variable v_sent         : natural;
+
+        -- Reads the next vector, there is a vector to read
+        procedure read_vector(vector : out std_logic_vector) is
+            variable v_char     : character;
+            variable v_vector   : std_logic_vector(data'length-1 downto 0);
+        begin
+            if G_DATA_FORMAT="raw" then
+                for i in 0 to data'length/8-1 loop
+                    read(f_raw, v_char);
+                    v_vector(8*i+7 downto 8*i) := std_logic_vector(to_unsigned(character'pos(v_char), 8));
+                end loop;
+                vector := v_vector;
+            else
+                readline(f_test_vectors, v_input_line);
+                if G_DATA_FORMAT="bin" then
+                    read(v_input_line, vector);
+                elsif G_DATA_FORMAT="hex" then
+                    hread(v_input_line, vector);
+                else
+                    assert false report "Invalid data format" severity error;
+                end if;
+            end if;
+        end procedure read_vector;
+
+        impure function vectors_left return boolean is
+        begin
+            if G_DATA_FORMAT="raw" then
+                return not endfile(f_raw);
+            end if;
+            return not endfile(f_test_vectors);
+        end function vectors_left;
     begin
         if (reset = '1') then
             c_packet_data <= 0;
@@ -44,19 +84,20 @@ begin
             last <= '0';
             r_done_transmitting <= '0';
 
-            file_open(f_test_vectors, G_FILE_TEST_VECTORS, read_mode);
-            readline(f_test_vectors, v_input_line);
-            if G_DATA_FORMAT="bin" then
-                read(v_input_line, v_test_vector);
-            elsif G_DATA_FORMAT="hex" then
-                hread(v_input_line, v_test_vector);
+            if G_DATA_FORMAT="raw" then
+                file_open(f_raw, G_FILE_TEST_VECTORS, read_mode);
             else
-                assert false report "Invalid data format" severity error;
+                file_open(f_test_vectors, G_FILE_TEST_VECTORS, read_mode);
             end if;
+            for i in 1 to G_SKIP loop
+                read_vector(v_test_vector);
+            end loop;
+            read_vector(v_test_vector);
             data <= v_test_vector;
 
             seed1 := 123;
             seed2 := 456;
+            v_sent := 0;
 
         elsif (rising_edge(clk)) then
 
@@ -73,19 +114,14 @@ begin
 
             if (ready = '1' and r_rand_valid = '1') then
 
-                if (endfile(f_test_vectors)) then
+                v_sent := v_sent + 1;
+
+                if (not vectors_left or v_sent = G_COUNT) then
                     r_done_transmitting <= '1';
                 end if;
 
-                if (not endfile(f_test_vectors)) then
-                    readline(f_test_vectors, v_input_line);
-                    if G_DATA_FORMAT="bin" then
-                        read(v_input_line, v_test_vector);
-                    elsif G_DATA_FORMAT="hex" then
-                        hread(v_input_line, v_test_vector);
-                    else
-                        assert false report "Invalid data format" severity error;
-                    end if;
+                if (vectors_left and v_sent /= G_COUNT) then
+                    read_vector(v_test_vector);
                     data <= v_test_vector;
                 else
                     r_rand_valid <= '0';
@@ -0,0 +1,314 @@
+#!/usr/bin/env python3
+"""Throughput regression bench for acc_bilinear_scaling_TB.
+
+Sweeps image sizes, scaling factors and source/sink probabilities. Every run
+gets its golden output from the C software model (lib/libbilinear_scaling.so
+loaded with ctypes) and is simulated with GHDL. Frame cycles and cycles per
+output pixel are collected into a results table, and compared against a
+baseline when one is given, next to its frame cycles.
+
+Example:
+    ./regression.py --sizes 20x20,128x128,512x512 --scales 0.5,2,4 \\
+        --probs 1.0:1.0,0.5:0.5 --baseline baseline.csv
+
+Before and after numbers of a change, the results of the tree before it are
+the baseline of the tree with it:
+    ./regression.py --sizes 128x128 --scales 0.5,1,2,4 --probs 1.0:1.0 --csv before.csv
+    ./regression.py --sizes 128x128 --scales 0.5,1,2,4 --probs 1.0:1.0 --baseline before.csv
+
+Accelerator generics are swept too, e.g. two against three line buffers:
+    ./regression.py --sizes 128x128 --scales 0.5,1,2,4 --probs 1.0:1.0 --line-count 2,3
+
+or sink stalls against output FIFO depths:
+    ./regression.py --sizes 128x128 --scales 1,2 --fifo-depth 8,16 \\
+        --probs 1.0:0.5,1.0:0.6,1.0:0.7,1.0:0.8,1.0:0.9,1.0:1.0
+"""
+import argparse
+import csv
+import ctypes
+import itertools
+import os
+import re
+import struct
+import subprocess
+import sys
+
+HW_DIR = os.path.dirname(os.path.abspath(__file__))
+ROOT_DIR = os.path.abspath(os.path.join(HW_DIR, "..", ".."))
+
+# Analysis order, packages and components before the entities using them
+SOURCES = [
+    "acc_bilinear_scaling_PK.vhd",
+    "FIFO.vhd",
+    "RAM.vhd",
+    "RAM_line.vhd",
+    "RAM_writer.vhd",
+    "acc_bilinear_scaling.vhd",
+    "avs_source.vhd",
+    "avs_sink.vhd",
+    "acc_bilinear_scaling_TB.vhd",
+]
+TOP = "acc_bilinear_scaling_TB"
+
+# Same as the fixed point scaling factors of the accelerator (3.5)
+SCALE_FRAC = 5
+MAX_SCALE = 2**3 - 2**-SCALE_FRAC
+
+FRAME_RE = re.compile(r"processed in (\d+) cycles \(([-+.\deE]+) cycles per output pixel\)")
+
+FIELDS = ["width", "height", "sx", "sy", "valid_prob", "ready_prob", "line_count", "fifo_depth",
+          "width_out", "height_out", "frame_cycles", "cycles_per_pixel",
+          "baseline_cycles", "change", "status"]
+
+
+class Image(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.POINTER(ctypes.POINTER(ctypes.c_uint8))),
+        ("height", ctypes.c_uint32),
+        ("width", ctypes.c_uint32),
+    ]
+
+
+def load_model():
+    """Builds the software model libraries and loads them."""
+    subprocess.run(["make", "-C", ROOT_DIR, "lib/libutils.so", "lib/libbilinear_scaling.so"],
+                   check=True, stdout=subprocess.DEVNULL)
+    # bilinear_scaling uses the utils symbols, they must be global
+    utils = ctypes.CDLL(os.path.join(ROOT_DIR, "lib", "libutils.so"), mode=ctypes.RTLD_GLOBAL)
+    model = ctypes.CDLL(os.path.join(ROOT_DIR, "lib", "libbilinear_scaling.so"))
+
+    utils.bin2image.restype = Image
+    utils.bin2image.argtypes = [ctypes.c_char_p]
+    utils.save_to_bin.restype = None
+    utils.save_to_bin.argtypes = [ctypes.c_char_p, Image]
+    utils.image_free.restype = None
+    utils.image_free.argtypes = [Image]
+    model.bilinear_scaling_sw.restype = Image
+    model.bilinear_scaling_sw.argtypes = [Image, ctypes.c_float, ctypes.c_float]
+    return utils, model
+
+
+def read_bin(filename):
+    with open(filename, "rb") as f:
+        width, height = struct.unpack("<II", f.read(8))
+        return width, height, f.read()
+
+
+def write_bin(filename, width, height, pixels):
+    with open(filename, "wb") as f:
+        f.write(struct.pack("<II", width, height))
+        f.write(pixels)
+
+
+# G_DATA_FORMAT of the testbench, vector file extension and line format
+FORMATS = {
+    "raw": (".raw", None),
+    "hex": (".hex", "02X"),
+    "bin": (".txt", "08b"),
+}
+
+
+def write_vectors(filename, pixels, data_format):
+    """Test vector file in the given format, same as textualize.py."""
+    line_format = FORMATS[data_format][1]
+    with open(filename, "wb") as f:
+        if line_format is None:
+            f.write(pixels)
+        else:
+            f.write("".join(format(p, line_format) + "\n" for p in pixels).encode())
+
+
+def crop(source, width, height):
+    """Top left corner of the source image, tiled if the image is smaller."""
+    src_width, src_height, src = source
+    rows = []
+    for v in range(height):
+        row = src[(v % src_height)*src_width:(v % src_height + 1)*src_width]
+        rows.append(bytes(row[u % src_width] for u in range(width)))
+    return b"".join(rows)
+
+
+def golden(utils, model, run_dir, width, height, pixels, sx, sy):
+    """Scales the input with the software model, returns the output image."""
+    input_bin = os.path.join(run_dir, "input.bin").encode()
+    output_bin = os.path.join(run_dir, "output_ref.bin").encode()
+    write_bin(input_bin, width, height, pixels)
+
+    image_in = utils.bin2image(input_bin)
+    image_out = model.bilinear_scaling_sw(image_in, sx, sy)
+    utils.save_to_bin(output_bin, image_out)
+    utils.image_free(image_out)
+    utils.image_free(image_in)
+
+    return read_bin(output_bin)
+
+
+def analyze(ghdl, flags, work_dir):
+    os.makedirs(work_dir, exist_ok=True)
+    for source in SOURCES:
+        subprocess.run([ghdl, "-a", *flags, "--workdir=" + work_dir, os.path.join(HW_DIR, source)],
+                       check=True)
+
+
+def simulate(ghdl, flags, work_dir, run_dir, generics, stop_time):
+    cmd = [ghdl, "--elab-run", *flags, "--workdir=" + work_dir, TOP]
+    cmd += ["-g%s=%s" % item for item in generics.items()]
+    cmd += ["--assert-level=error", "--ieee-asserts=disable"]
+    if stop_time:
+        cmd += ["--stop-time=" + stop_time]
+    result = subprocess.run(cmd, cwd=run_dir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    with open(os.path.join(run_dir, "ghdl.log"), "w") as f:
+        f.write(result.stdout)
+    return result.returncode, result.stdout
+
+
+def fixed_scale(scale):
+    """Scaling factor as the accelerator sees it."""
+    return int(scale * 2**SCALE_FRAC) / 2**SCALE_FRAC
+
+
+def parse_list(text, conv):
+    return [conv(item) for item in text.split(",") if item]
+
+
+def parse_size(text):
+    width, height = text.lower().split("x")
+    return int(width), int(height)
+
+
+def parse_probs(text):
+    valid, ready = text.split(":")
+    return float(valid), float(ready)
+
+
+def run_key(row):
+    """Run parameters, generics left at their defaults are "-"."""
+    return tuple(str(row.get(f, "-")) for f in FIELDS[:8])
+
+
+def print_table(rows):
+    widths = [max(len(f), *(len(str(r[f])) for r in rows)) for f in FIELDS]
+    print(" | ".join(f.ljust(w) for f, w in zip(FIELDS, widths)))
+    print("-+-".join("-"*w for w in widths))
+    for r in rows:
+        print(" | ".join(str(r[f]).ljust(w) for f, w in zip(FIELDS, widths)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--image", default=os.path.join(ROOT_DIR, "test", "img", "lena.bin"),
+                        help="source image in the bin format, inputs are cut out of it")
+    parser.add_argument("--sizes", default="20x20,64x64,128x128", type=lambda t: parse_list(t, parse_size),
+                        help="comma separated WIDTHxHEIGHT list (lena is 512x512)")
+    parser.add_argument("--scales", default="0.5,1.5,4", type=lambda t: parse_list(t, float),
+                        help="comma separated scaling factors, used for both sx and sy")
+    parser.add_argument("--probs", default="1.0:1.0,0.5:0.5", type=lambda t: parse_list(t, parse_probs),
+                        help="comma separated VALID:READY source and sink probabilities")
+    parser.add_argument("--line-count", default=[None], type=lambda t: parse_list(t, int),
+                        help="comma separated G_LINE_COUNT list of the accelerator")
+    parser.add_argument("--fifo-depth", default=[None], type=lambda t: parse_list(t, int),
+                        help="comma separated G_OUT_FIFO_DEPTH list of the accelerator, deeper than its 4 pipeline stages")
+    parser.add_argument("--format", default="raw", choices=sorted(FORMATS),
+                        help="test vector format, raw is the fastest to read in simulation")
+    parser.add_argument("--ghdl", default="ghdl")
+    parser.add_argument("--ghdl-flags", default="", help="extra analysis, elaboration and run flags")
+    parser.add_argument("--stop-time", default="", help="simulation time limit of a single run, e.g. 1sec")
+    parser.add_argument("--work-dir", default=os.path.join(ROOT_DIR, "build", "regression"))
+    parser.add_argument("--csv", help="write the results table to this file")
+    parser.add_argument("--baseline", help="results of a previous run, cycles are compared against it")
+    parser.add_argument("--tolerance", type=float, default=0.02,
+                        help="allowed relative increase of frame cycles over the baseline")
+    args = parser.parse_args()
+
+    flags = args.ghdl_flags.split()
+    utils, model = load_model()
+    source = read_bin(args.image)
+
+    analyze(args.ghdl, flags, args.work_dir)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = {run_key(r): r for r in csv.DictReader(f)}
+
+    rows = []
+    failed = 0
+    for (width, height), scale, (valid, ready), line_count, fifo_depth in itertools.product(
+            args.sizes, args.scales, args.probs, args.line_count, args.fifo_depth):
+        scale = min(fixed_scale(scale), MAX_SCALE)
+        name = "%dx%d_s%g_v%g_r%g" % (width, height, scale, valid, ready)
+        if line_count is not None:
+            name += "_l%d" % line_count
+        if fifo_depth is not None:
+            name += "_f%d" % fifo_depth
+        run_dir = os.path.join(args.work_dir, name)
+        os.makedirs(run_dir, exist_ok=True)
+
+        pixels = crop(source, width, height)
+        width_out, height_out, pixels_out = golden(utils, model, run_dir, width, height, pixels, scale, scale)
+        extension = FORMATS[args.format][0]
+        input_file = os.path.join(run_dir, "input" + extension)
+        output_ref_file = os.path.join(run_dir, "output_ref" + extension)
+        write_vectors(input_file, pixels, args.format)
+        write_vectors(output_ref_file, pixels_out, args.format)
+
+        generics = {
+            "G_SX": "%.5f" % scale,
+            "G_SY": "%.5f" % scale,
+            "G_WIDTH": width,
+            "G_HEIGHT": height,
+            "G_VALID_PROB": "%.3f" % valid,
+            "G_READY_PROB": "%.3f" % ready,
+            "G_DATA_FORMAT": args.format,
+            "G_FILE_INPUT": input_file,
+            "G_FILE_OUTPUT_REF": output_ref_file,
+        }
+        if line_count is not None:
+            generics["G_LINE_COUNT"] = line_count
+        if fifo_depth is not None:
+            generics["G_OUT_FIFO_DEPTH"] = fifo_depth
+
+        print("Running %s..." % name, file=sys.stderr)
+        returncode, log = simulate(args.ghdl, flags, args.work_dir, run_dir, generics, args.stop_time)
+        match = FRAME_RE.search(log)
+
+        row = {
+            "width": width, "height": height, "sx": scale, "sy": scale,
+            "valid_prob": valid, "ready_prob": ready,
+            "line_count": line_count if line_count is not None else "-",
+            "fifo_depth": fifo_depth if fifo_depth is not None else "-",
+            "width_out": width_out, "height_out": height_out,
+            "frame_cycles": match.group(1) if match else "-",
+            "cycles_per_pixel": "%.3f" % float(match.group(2)) if match else "-",
+            "baseline_cycles": "-",
+            "change": "-",
+            "status": "PASS",
+        }
+        reference = baseline.get(run_key(row), {}).get("frame_cycles", "-")
+        if reference.isdigit():
+            row["baseline_cycles"] = reference
+            if match:
+                row["change"] = "%+.1f%%" % (100.0*(int(row["frame_cycles"]) - int(reference))/int(reference))
+        if returncode != 0 or not match or "Simulation done" not in log:
+            row["status"] = "FAIL"
+        elif reference.isdigit() and int(row["frame_cycles"]) > int(reference) * (1 + args.tolerance):
+            row["status"] = "SLOWER"
+        if row["status"] != "PASS":
+            failed += 1
+        rows.append(row)
+
+    print_table(rows)
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+
+    if failed:
+        print("%d of %d runs failed" % (failed, len(rows)), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
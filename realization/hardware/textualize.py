@@ -1,16 +1,75 @@
 #!/usr/bin/env python3
-import sys
-import struct
-import numpy as np
+"""Converts an image to testbench vectors.
 
-if len(sys.argv) <3:
-    raise RuntimeError
+Input is a .bin image (8 byte width and height header) or a binary PGM (P5).
+Output format is picked by the output file extension: .raw is the pixel bytes
+as they are (G_DATA_FORMAT "raw"), .hex is a hex value per line ("hex") and
+anything else a binary value per line ("bin").
+"""
+import argparse
+import os
 
-input_filename = sys.argv[1]
-output_filename = sys.argv[2]
+try:
+    import numpy as np
+except ImportError:
+    np = None
 
-with open(input_filename, "rb") as frref, open(output_filename, "w") as fwref:
-    _ = frref.read(8)
-    binary_image = frref.read()
 
-    [fwref.write(np.binary_repr(n, 8) + '\n') for n in struct.unpack(str(len(binary_image)) + "B", binary_image)]
+def read_image(filename):
+    with open(filename, "rb") as f:
+        content = f.read()
+
+    if content[:2] != b"P5":
+        return content[8:]
+
+    # Header is four whitespace separated fields, comments are skipped
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while content[pos:pos+1].isspace():
+            pos += 1
+        if content[pos:pos+1] == b"#":
+            pos = content.index(b"\n", pos)
+            continue
+        start = pos
+        while not content[pos:pos+1].isspace():
+            pos += 1
+        fields.append(content[start:pos])
+    width, height, maxval = (int(x) for x in fields[1:])
+    if maxval > 255:
+        raise RuntimeError("Only 8-bit PGM images are supported")
+    # Single whitespace character ends the header
+    return content[pos+1:pos+1+width*height]
+
+
+def to_lines(pixels, fmt):
+    """Every pixel as a fixed width line, looked up for all pixels at once."""
+    table = [(format(n, fmt) + "\n").encode() for n in range(256)]
+    if np is None:
+        return b"".join(table[p] for p in pixels)
+    table = np.frombuffer(b"".join(table), dtype=np.uint8).reshape(256, -1)
+    return table[np.frombuffer(pixels, dtype=np.uint8)].tobytes()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help=".bin or .pgm image")
+    parser.add_argument("output", help=".raw, .hex or text vector file")
+    args = parser.parse_args()
+
+    pixels = read_image(args.input)
+    extension = os.path.splitext(args.output)[1]
+
+    if extension == ".raw":
+        data = pixels
+    elif extension == ".hex":
+        data = to_lines(pixels, "02X")
+    else:
+        data = to_lines(pixels, "08b")
+
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+
+if __name__ == "__main__":
+    main()
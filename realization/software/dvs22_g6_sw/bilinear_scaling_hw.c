@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,11 +9,61 @@
 #include "altera_avalon_sgdma_regs.h"
 #include "io.h"
 #include "system.h"
+#include "sys/alt_irq.h"
 
 #include "bilinear_scaling_hw.h"
 #include "software_model/bilinear_scaling.h"
 #include "software_model/utils.h"
 
+/* Number of lanes done, counted by the accelerator done interrupt. */
+static volatile uint8_t acc_done = 0;
+
+/* CRC-32 of the output bytes of each lane, chained across strips. */
+static uint32_t acc_crc[ACC_BILINEAR_SCALING_LANES];
+
+/* Progress messages are printed, errors are printed regardless. */
+static uint8_t acc_verbose = 1;
+
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+static void acc_done_isr(void* context) {
+    for(uint8_t lane=0; lane<ACC_BILINEAR_SCALING_LANES; lane++) {
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+        if((IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR) & ACC_BILINEAR_SCALING_CTL_IRQ_EN_MSK) &&
+           (IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR) & ACC_BILINEAR_SCALING_STATUS_DONE_MSK)) {
+            /* Disable the interrupt, done stays set until the control reset. */
+            IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, 0x00);
+            acc_done++;
+        }
+    }
+    /* Read back so the interrupt is deasserted before returning. */
+    (void)IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR);
+}
+#endif
+
+
+void bilinear_scaling_hw_init() {
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+    alt_ic_isr_register(
+        ACC_BILINEAR_SCALING_IRQ_INTERRUPT_CONTROLLER_ID,
+        ACC_BILINEAR_SCALING_IRQ,
+        &acc_done_isr,
+        NULL,
+        NULL);
+#endif
+}
+
+
+void bilinear_scaling_hw_verbose(uint8_t verbose) {
+    acc_verbose = verbose;
+}
+
+
+uint16_t bilinear_scaling_hw_row(uint8_t lane) {
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+    return IORD_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_ROW_ADDR);
+}
+
+
 alt_sgdma_descriptor* descriptor_alloc(uint16_t number_of_buffers, void** allocated_memory) {
     alt_sgdma_descriptor* result;
     void* temp_ptr;
@@ -54,6 +105,33 @@ void create_transmit_descriptors(alt_sgdma_descriptor* descriptors, image_t imag
 }
 
 
+/* Row tag mode, only the listed rows are sent, each preceded by its 2 byte index. */
+void create_tagged_transmit_descriptors(alt_sgdma_descriptor* descriptors, image_t image, uint16_t* rows, uint32_t count) {
+    for(uint32_t i=0; i<count; i++) {
+        alt_avalon_sgdma_construct_mem_to_stream_desc(
+            &descriptors[2*i],          /* Current descriptor pointer. */
+            &descriptors[2*i+1],        /* Next descriptor pointer. */
+            (uint32_t*)&rows[i],        /* Row tag location, little endian. */
+            (uint16_t)sizeof(*rows),    /* Length of the row tag. */
+            0,                          /* Reads are not from a fixed location. */
+            0,                          /* Start-of-packet disabled. */
+            0,                          /* Row continues in the next descriptor. */
+            0                           /* One channel only. */
+        );
+        alt_avalon_sgdma_construct_mem_to_stream_desc(
+            &descriptors[2*i+1],            /* Current descriptor pointer. */
+            &descriptors[2*i+2],            /* Next descriptor pointer. */
+            (uint32_t*)image.data[rows[i]], /* Read buffer location. */
+            (uint16_t)image.width,          /* Length of the buffer. */
+            0,                              /* Reads are not from a fixed location. */
+            0,                              /* Start-of-packet disabled. */
+            1,                              /* End-of-packet enabled. */
+            0                               /* One channel only. */
+        );
+    }
+}
+
+
 void create_receive_descriptors(alt_sgdma_descriptor* descriptors, image_t image) {
     for(uint32_t i=0; i<image.height; i++) {
         alt_avalon_sgdma_construct_stream_to_mem_desc(
@@ -67,84 +145,445 @@ void create_receive_descriptors(alt_sgdma_descriptor* descriptors, image_t image
 }
 
 
-image_t bilinear_scaling_hw(
+/* Image being processed in the background, started by bilinear_scaling_hw_start
+ * and finished by bilinear_scaling_hw_wait. */
+static struct {
+    image_t input;
+    image_t output;
+    strip_t* strips;
+    uint32_t strip_count;
+    band_t bands[ACC_BILINEAR_SCALING_LANES];
+    uint16_t* rows[ACC_BILINEAR_SCALING_LANES];
+    uint32_t row_count[ACC_BILINEAR_SCALING_LANES];
+    uint32_t lanes;
+    alt_sgdma_dev** sgdma_in;
+    alt_sgdma_dev** sgdma_out;
+    volatile uint16_t* tx_done;
+    volatile uint16_t* rx_done;
+    /* Pointers to memory allocated for SGDMA descriptors of the running strip. */
+    void* transmit_alloc[ACC_BILINEAR_SCALING_LANES];
+    void* receive_alloc[ACC_BILINEAR_SCALING_LANES];
+} acc_job;
+
+
+/* Starts a single strip of the image, each lane processes its band of rows
+ * of the strip. Input and output columns and rows of the lanes are picked
+ * out by the SGDMA descriptors. Strip columns are in pixels. */
+static void bilinear_scaling_hw_strip_start(strip_t strip) {
+
+    /* Write strip params to all lanes. */
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, ACC_BILINEAR_SCALING_LANE_ALL);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_WIDTH_ADDR, strip.in_width);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_X_PHASE_ADDR, strip.phase_x);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_WIDTH_OUT_ADDR, strip.out_width);
+
+    acc_done = 0;
+
+    for(uint32_t lane=0; lane<acc_job.lanes; lane++) {
+        band_t band = acc_job.bands[lane];
+
+        /* Strip and band views of the images, shallow copies. */
+        image_t input_view = extract_segment(acc_job.input, band.in_start, strip.in_start*ACC_BILINEAR_SCALING_CHANNELS,
+                band.in_height, strip.in_width*ACC_BILINEAR_SCALING_CHANNELS);
+        image_t output_view = extract_segment(acc_job.output, band.out_start, strip.out_start*ACC_BILINEAR_SCALING_CHANNELS,
+                band.out_height, strip.out_width*ACC_BILINEAR_SCALING_CHANNELS);
+
+        /* Rows not sampled by the lane are skipped in row tag mode. */
+        uint8_t row_tag = acc_job.row_count[lane] < input_view.height;
+        uint32_t transmit_count = row_tag ? 2*acc_job.row_count[lane] : input_view.height;
+
+        /* Allocate SGDMA descriptors. */
+        alt_sgdma_descriptor* transmit_descriptors = descriptor_alloc(transmit_count, &acc_job.transmit_alloc[lane]);
+        alt_sgdma_descriptor* receive_descriptors = descriptor_alloc(output_view.height, &acc_job.receive_alloc[lane]);
+
+        /* Create SGDMA descriptors. */
+        if(row_tag) {
+            create_tagged_transmit_descriptors(transmit_descriptors, input_view, acc_job.rows[lane], acc_job.row_count[lane]);
+        }
+        else {
+            create_transmit_descriptors(transmit_descriptors, input_view);
+        }
+        create_receive_descriptors(receive_descriptors, output_view);
+
+        transmit_descriptors[transmit_count].control = 0x00;
+        receive_descriptors[output_view.height].control = 0x00;
+
+        free(input_view.data);
+        free(output_view.data);
+
+        /* Write band params to the lane. */
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_HEIGHT_ADDR, band.in_height);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_Y_PHASE_ADDR, band.phase_y);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_HEIGHT_OUT_ADDR, band.out_height);
+        IOWR_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CRC_ADDR, acc_crc[lane]);
+        uint8_t ctl = row_tag ? ACC_BILINEAR_SCALING_CTL_ROW_TAG_MSK : 0x00;
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+        ctl |= ACC_BILINEAR_SCALING_CTL_IRQ_EN_MSK;
+#endif
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, ctl);
+
+        /* Start SGDMAs. */
+        if(alt_avalon_sgdma_do_async_transfer(acc_job.sgdma_out[lane], &transmit_descriptors[0]) != 0)
+        {
+            printf("Writing the head of the transmit descriptor list to the DMA failed\n");
+        }
+        if(alt_avalon_sgdma_do_async_transfer(acc_job.sgdma_in[lane], &receive_descriptors[0]) != 0)
+        {
+            printf("Writing the head of the receive descriptor list to the DMA failed\n");
+        }
+    }
+}
+
+
+/* Waits for all lanes to finish the running strip. */
+static void bilinear_scaling_hw_strip_wait() {
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+    while(acc_done < acc_job.lanes);
+#else
+    for(uint32_t lane=0; lane<acc_job.lanes; lane++) {
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+        while(!(IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR) & ACC_BILINEAR_SCALING_STATUS_DONE_MSK));
+    }
+#endif
+    if(acc_verbose) printf("Accelerator done.\n");
+
+    for(uint32_t lane=0; lane<acc_job.lanes; lane++) {
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+        if(IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR) & ACC_BILINEAR_SCALING_STATUS_ERROR_MSK) {
+            printf("Accelerator lane %" PRIu32 " input row length didn't match the image width\n", lane);
+        }
+        acc_crc[lane] = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CRC_ADDR);
+
+        /* Wait for SGDMA interrupts to fire, input rows left are still being flushed. */
+        while(acc_job.tx_done[lane] == 0x0000);
+        while(acc_job.rx_done[lane] == 0x0000);
+
+        /* Reset flags. */
+        acc_job.rx_done[lane] = 0x0000;
+        acc_job.tx_done[lane] = 0x0000;
+
+        /* Stop SGDMAs. */
+        alt_avalon_sgdma_stop(acc_job.sgdma_in[lane]);
+        alt_avalon_sgdma_stop(acc_job.sgdma_out[lane]);
+
+        /* Free memory allocated for descripotrs. */
+        free(acc_job.transmit_alloc[lane]);
+        free(acc_job.receive_alloc[lane]);
+    }
+    if(acc_verbose) printf("Transmit and receive SGDMAs completed.\n");
+
+    /* Set done bit to reset system internally. */
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, ACC_BILINEAR_SCALING_LANE_ALL);
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, ACC_BILINEAR_SCALING_CTL_RESET_MSK);
+}
+
+
+/* Starts scaling input to fill output, the first output row at the y
+ * coordinate phase_y, and returns while the accelerator runs. Only the first
+ * strip of images wider than the line buffers runs in the background, the
+ * rest are processed by bilinear_scaling_hw_wait. */
+void bilinear_scaling_hw_start(
             image_t input,
+            image_t output,
             float sx_float,
             float sy_float,
-            alt_sgdma_dev* sgdma_in,
-            alt_sgdma_dev* sgdma_out,
+            uint16_t phase_y,
+            alt_sgdma_dev** sgdma_in,
+            alt_sgdma_dev** sgdma_out,
             volatile uint16_t* tx_done,
             volatile uint16_t* rx_done) {
 
-    /* Conversion to fixed point of the scaling factors. */
+    /* Fixed point codes of the scaling factors, for the registers. */
     uint8_t sx = to_fixed_point(sx_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
     uint8_t sy = to_fixed_point(sy_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
 
-    /* Corresponding float values of the scaling factors in fixed point. */
-    float sx_fx = from_fixed_point(sx, BILINEAR_SCALING_SF_NFRAC);
-    float sy_fx = from_fixed_point(sy, BILINEAR_SCALING_SF_NFRAC);
+    /* Widths of the pixels of all channels. */
+    uint32_t in_width = input.width/ACC_BILINEAR_SCALING_CHANNELS;
+    uint32_t out_width = output.width/ACC_BILINEAR_SCALING_CHANNELS;
 
-    /* Allocate output image memory. */
-    image_t output = image_alloc(input.height*sy_fx, input.width*sx_fx);
+    /* Input image coordinates increments, the output is allocated by the caller. */
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, in_width, sx_float, sy_float, NULL, NULL, &increment_x, &increment_y);
 
-    /* Input image coordinates increment. */
-    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
-    uint16_t increment_x = to_fixed_point(1/sx_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
-    uint16_t increment_y = to_fixed_point(1/sy_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
+    acc_job.input = input;
+    acc_job.output = output;
+    acc_job.sgdma_in = sgdma_in;
+    acc_job.sgdma_out = sgdma_out;
+    acc_job.tx_done = tx_done;
+    acc_job.rx_done = rx_done;
 
-    /* Pointers to memory allocated for SGDMA descriptors. */
-    void* transmit_alloc;
-    void* receive_alloc;
+    /* Nothing to scale into an empty output, bilinear_scaling_hw_wait
+     * returns at once. */
+    if(output.height == 0 || out_width == 0) {
+        acc_job.strips = NULL;
+        acc_job.strip_count = 0;
+        acc_job.lanes = 0;
+        return;
+    }
 
-    /* Allocate SGDMA descriptors. */
-    alt_sgdma_descriptor* transmit_descriptors = descriptor_alloc(input.height, &transmit_alloc);
-    alt_sgdma_descriptor* receive_descriptors = descriptor_alloc(output.height, &receive_alloc);
+    /* Images wider than the line buffers are processed in strips. */
+    acc_job.strip_count = bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, NULL);
+    acc_job.strips = malloc(acc_job.strip_count*sizeof(strip_t));
+    assert(acc_job.strips != NULL);
+    bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, acc_job.strips);
 
-    /* Create SGDMA descriptors. */
-    create_transmit_descriptors(transmit_descriptors, input);
-    create_receive_descriptors(receive_descriptors, output);
+    /* Rows are split across lanes, each lane gets at least one output row. */
+    acc_job.lanes = (output.height < ACC_BILINEAR_SCALING_LANES) ? output.height : ACC_BILINEAR_SCALING_LANES;
+    bilinear_scaling_bands(input.height, output.height, increment_y, phase_y, acc_job.lanes, acc_job.bands);
 
-    transmit_descriptors[input.height].control = 0x00;
-    receive_descriptors[output.height].control = 0x00;
+    /* Input rows sampled by each lane, relative to its band. */
+    for(uint32_t lane=0; lane<acc_job.lanes; lane++) {
+        band_t band = acc_job.bands[lane];
+        acc_job.row_count[lane] = bilinear_scaling_rows(band.in_height, band.out_height, increment_y, band.phase_y, NULL);
+        acc_job.rows[lane] = malloc(acc_job.row_count[lane]*sizeof(uint16_t));
+        assert(acc_job.rows[lane] != NULL);
+        bilinear_scaling_rows(band.in_height, band.out_height, increment_y, band.phase_y, acc_job.rows[lane]);
+        acc_crc[lane] = 0;
+    }
 
-    /* Write params to the peripheral. */
-    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_WIDTH_ADDR, input.width);
-    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_HEIGHT_ADDR, input.height);
+    /* Write params common for all strips to all lanes. */
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, ACC_BILINEAR_SCALING_LANE_ALL);
     IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SX_INV_ADDR, increment_x);
     IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SY_INV_ADDR, increment_y);
     IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SX_ADDR, sx);
     IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SY_ADDR, sy);
 
-    /* Start SGDMAs. */
-    if(alt_avalon_sgdma_do_async_transfer(sgdma_out, &transmit_descriptors[0]) != 0)
-    {
-        printf("Writing the head of the transmit descriptor list to the DMA failed\n");
+    bilinear_scaling_hw_strip_start(acc_job.strips[0]);
+}
+
+
+/* Finishes the image started by bilinear_scaling_hw_start. */
+void bilinear_scaling_hw_wait() {
+    for(uint32_t i=0; i<acc_job.strip_count; i++) {
+        /* The first strip was started by bilinear_scaling_hw_start. */
+        if(i > 0) {
+            bilinear_scaling_hw_strip_start(acc_job.strips[i]);
+        }
+        bilinear_scaling_hw_strip_wait();
     }
-    if(alt_avalon_sgdma_do_async_transfer(sgdma_in, &receive_descriptors[0]) != 0)
-    {
-        printf("Writing the head of the receive descriptor list to the DMA failed\n");
+
+    for(uint32_t lane=0; lane<acc_job.lanes; lane++) {
+        free(acc_job.rows[lane]);
     }
+    free(acc_job.strips);
+}
 
-    /* Wait for SGDMA interrupts to fire. */
-    while(*tx_done == 0x0000);
-    printf("Transmit SGDMA completed.\n");
-    while(*rx_done == 0x0000);
-    printf("Receive SGDMA completed.\n");
 
-    /* Set done bit to reset system internally. */
-    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, 0x01);
+image_t bilinear_scaling_hw(
+            image_t input,
+            float sx_float,
+            float sy_float,
+            alt_sgdma_dev** sgdma_in,
+            alt_sgdma_dev** sgdma_out,
+            volatile uint16_t* tx_done,
+            volatile uint16_t* rx_done) {
+
+    /* Output dimensions, of the pixels rather than the bytes of a row. */
+    uint32_t out_height, out_width;
+    bilinear_scaling_geometry(input.height, input.width/ACC_BILINEAR_SCALING_CHANNELS, sx_float, sy_float, &out_height, &out_width, NULL, NULL);
+
+    /* Allocate output image memory, widths of the pixels of all channels. */
+    image_t output = image_alloc(out_height, out_width*ACC_BILINEAR_SCALING_CHANNELS);
+
+    bilinear_scaling_hw_start(input, output, sx_float, sy_float, 0, sgdma_in, sgdma_out, tx_done, rx_done);
+    bilinear_scaling_hw_wait();
+
+    return output;
+}
+
+
+/* SGDMAs used by the accelerator as the band engine of hybrid processing. */
+static struct {
+    alt_sgdma_dev** sgdma_in;
+    alt_sgdma_dev** sgdma_out;
+    volatile uint16_t* tx_done;
+    volatile uint16_t* rx_done;
+} acc_engine;
+
+
+static void bilinear_scaling_hw_engine_start(image_t input, image_t output, float sx_float, float sy_float, uint16_t phase_y, void* context) {
+    bilinear_scaling_hw_start(input, output, sx_float, sy_float, phase_y,
+            acc_engine.sgdma_in, acc_engine.sgdma_out, acc_engine.tx_done, acc_engine.rx_done);
+}
+
+
+static void bilinear_scaling_hw_engine_wait(void* context) {
+    bilinear_scaling_hw_wait();
+}
+
+
+/* Accelerator as the band engine of bilinear_scaling_hybrid. */
+band_engine_t bilinear_scaling_hw_engine(
+            alt_sgdma_dev** sgdma_in,
+            alt_sgdma_dev** sgdma_out,
+            volatile uint16_t* tx_done,
+            volatile uint16_t* rx_done) {
+    band_engine_t engine = {
+        .start = &bilinear_scaling_hw_engine_start,
+        .wait = &bilinear_scaling_hw_engine_wait,
+        .context = NULL
+    };
+
+    acc_engine.sgdma_in = sgdma_in;
+    acc_engine.sgdma_out = sgdma_out;
+    acc_engine.tx_done = tx_done;
+    acc_engine.rx_done = rx_done;
+
+    return engine;
+}
+
+
+#if ACC_BILINEAR_SCALING_MM_MASTERS
+/* Scales the region of interest of an image allocated with image_alloc, the
+ * accelerator fetches the input rows and writes the output rows itself, so
+ * no descriptors are built. */
+image_t bilinear_scaling_hw_mm(
+            image_t image,
+            uint32_t start_row,
+            uint32_t start_col,
+            uint32_t rows,
+            uint32_t cols,
+            float sx_float,
+            float sy_float) {
+
+    /* Fixed point codes of the scaling factors, for the registers. */
+    uint8_t sx = to_fixed_point(sx_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
+    uint8_t sy = to_fixed_point(sy_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
+
+    /* Output dimensions and input image coordinates increments, of the
+     * pixels rather than the bytes of a row. */
+    uint32_t in_width = cols/ACC_BILINEAR_SCALING_CHANNELS;
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(rows, in_width, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory, rows are contiguous. */
+    image_t output = image_alloc(out_height, out_width*ACC_BILINEAR_SCALING_CHANNELS);
 
-    /* Reset flags. */
-    *rx_done = 0x0000;
-    *tx_done = 0x0000;
+    /* Regions wider than the line buffers are processed in strips. */
+    uint32_t strip_count = bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, NULL);
+    strip_t* strips = malloc(strip_count*sizeof(strip_t));
+    assert(strips != NULL);
+    bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, strips);
 
-    /* Stop SGDMAs. */
-    alt_avalon_sgdma_stop(sgdma_in);
-    alt_avalon_sgdma_stop(sgdma_out);
+    /* Write params common for all strips to the peripheral. */
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_HEIGHT_ADDR, rows);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_Y_PHASE_ADDR, 0);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_HEIGHT_OUT_ADDR, 0);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SX_INV_ADDR, increment_x);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SY_INV_ADDR, increment_y);
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SX_ADDR, sx);
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SY_ADDR, sy);
+
+    IOWR_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SRC_BASE_ADDR, (uint32_t)image.data[0]);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_SRC_STRIDE_ADDR, image.width);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_ROI_Y_ADDR, start_row);
+    IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_DST_STRIDE_ADDR, output.width);
 
-    /* Free memory allocated for descripotrs. */
-    free(transmit_alloc);
-    free(receive_alloc);
+    acc_crc[0] = 0;
+    for(uint32_t i=0; i<strip_count; i++) {
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_WIDTH_ADDR, strips[i].in_width);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_X_PHASE_ADDR, strips[i].phase_x);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_WIDTH_OUT_ADDR, strips[i].out_width);
+        IOWR_16DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_ROI_X_ADDR, start_col + strips[i].in_start*ACC_BILINEAR_SCALING_CHANNELS);
+        IOWR_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_DST_BASE_ADDR, (uint32_t)&output.data[0][strips[i].out_start*ACC_BILINEAR_SCALING_CHANNELS]);
+        IOWR_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CRC_ADDR, acc_crc[0]);
+
+        acc_done = 0;
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, ACC_BILINEAR_SCALING_CTL_IRQ_EN_MSK);
+#endif
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_DMA_CTL_ADDR, ACC_BILINEAR_SCALING_DMA_CTL_START_MSK);
+
+        /* Done interrupt is raised once the last output pixel is written. */
+#if ACC_BILINEAR_SCALING_IRQ >= 0
+        while(acc_done == 0);
+#else
+        while(!(IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR) & ACC_BILINEAR_SCALING_STATUS_DONE_MSK));
+        while(IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_DMA_STATUS_ADDR) & ACC_BILINEAR_SCALING_DMA_STATUS_WRITE_MSK);
+#endif
+
+        if(IORD_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_STATUS_ADDR) & ACC_BILINEAR_SCALING_STATUS_ERROR_MSK) {
+            printf("Accelerator input row length didn't match the image width\n");
+        }
+        acc_crc[0] = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CRC_ADDR);
+
+        /* Set done bit to reset system internally. */
+        IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_CTL_ADDR, ACC_BILINEAR_SCALING_CTL_RESET_MSK);
+    }
+    if(acc_verbose) printf("Accelerator done.\n");
+
+    free(strips);
 
     return output;
 }
+#endif
+
+
+acc_perf_t bilinear_scaling_hw_perf(uint8_t lane) {
+    acc_perf_t perf;
+
+    IOWR_8DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_LANE_ADDR, lane);
+
+    perf.busy = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_BUSY_ADDR);
+    perf.in_stall = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_IN_STALL_ADDR);
+    perf.out_stall = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_OUT_STALL_ADDR);
+    perf.row_switch = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_ROW_SWITCH_ADDR);
+    perf.pixels = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_PIXELS_ADDR);
+    perf.rows = IORD_32DIRECT(ACC_BILINEAR_SCALING_BASE, ACC_BILINEAR_SCALING_PERF_ROWS_ADDR);
+
+    return perf;
+}
+
+
+/* CRC-32 of the lane output of the last processed image. */
+uint32_t bilinear_scaling_hw_crc(uint8_t lane) {
+    return acc_crc[lane];
+}
+
+
+/* Expected CRC-32 of the lane output, computed from a reference output in
+ * the order the lane produces it, strip by strip over its band of rows. */
+uint32_t bilinear_scaling_hw_crc_ref(image_t input, image_t output, float sx_float, float sy_float, uint8_t lane) {
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width/ACC_BILINEAR_SCALING_CHANNELS, sx_float, sy_float, NULL, NULL, &increment_x, &increment_y);
+
+    uint32_t lanes = (output.height < ACC_BILINEAR_SCALING_LANES) ? output.height : ACC_BILINEAR_SCALING_LANES;
+    if(lane >= lanes) {
+        return 0;
+    }
+    band_t bands[ACC_BILINEAR_SCALING_LANES];
+    bilinear_scaling_bands(input.height, output.height, increment_y, 0, lanes, bands);
+
+    uint32_t in_width = input.width/ACC_BILINEAR_SCALING_CHANNELS;
+    uint32_t out_width = output.width/ACC_BILINEAR_SCALING_CHANNELS;
+    uint32_t strip_count = bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, NULL);
+    strip_t* strips = malloc(strip_count*sizeof(strip_t));
+    assert(strips != NULL);
+    bilinear_scaling_strips(in_width, out_width, increment_x, BILINEAR_SCALING_MAX_WIDTH, strips);
+
+    uint32_t crc = 0;
+    for(uint32_t i=0; i<strip_count; i++) {
+        image_t view = extract_segment(output, bands[lane].out_start, strips[i].out_start*ACC_BILINEAR_SCALING_CHANNELS,
+                bands[lane].out_height, strips[i].out_width*ACC_BILINEAR_SCALING_CHANNELS);
+        crc = image_crc32(crc, view);
+        free(view.data);
+    }
+    free(strips);
+
+    return crc;
+}
+
+
+void print_hw_perf(acc_perf_t perf) {
+    printf("Accelerator busy:       %" PRIu32 " cycles\n", perf.busy);
+    printf("Waiting for input rows: %" PRIu32 " cycles\n", perf.in_stall);
+    printf("Output stalled:         %" PRIu32 " cycles\n", perf.out_stall);
+    printf("Switching rows:         %" PRIu32 " cycles\n", perf.row_switch);
+    printf("Output pixels:          %" PRIu32 "\n", perf.pixels);
+    printf("Output rows:            %" PRIu32 "\n", perf.rows);
+    if (perf.pixels) {
+        printf("Cycles per pixel:       %.3f\n", (float)perf.busy/perf.pixels);
+    }
+}
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 
+#include "software_model/bilinear_scaling.h"
 #include "software_model/utils.h"
 
 #define ACC_BILINEAR_SCALING_SX_ADDR        (0x0)
@@ -12,14 +13,129 @@
 #define ACC_BILINEAR_SCALING_WIDTH_ADDR     (0x6)
 #define ACC_BILINEAR_SCALING_HEIGHT_ADDR    (0x8)
 #define ACC_BILINEAR_SCALING_CTL_ADDR       (0xa)
+#define ACC_BILINEAR_SCALING_STATUS_ADDR    (0xb)
+#define ACC_BILINEAR_SCALING_ROW_ADDR       (0xc)
+#define ACC_BILINEAR_SCALING_X_PHASE_ADDR   (0x28)
+#define ACC_BILINEAR_SCALING_WIDTH_OUT_ADDR (0x2a)
+#define ACC_BILINEAR_SCALING_Y_PHASE_ADDR   (0x2c)
+#define ACC_BILINEAR_SCALING_HEIGHT_OUT_ADDR (0x2e)
+#define ACC_BILINEAR_SCALING_LANE_ADDR      (0x30)
+#define ACC_BILINEAR_SCALING_CRC_ADDR       (0x34)
+
+/* Lane select value writing to all lanes. */
+#define ACC_BILINEAR_SCALING_LANE_ALL       (0xff)
+
+/* Number of accelerator lanes and the SGDMA pair of each lane. */
+#ifndef ACC_BILINEAR_SCALING_LANES
+#define ACC_BILINEAR_SCALING_LANES              (1)
+#define ACC_BILINEAR_SCALING_SGDMA_IN_NAMES     { SGDMA_IN_NAME }
+#define ACC_BILINEAR_SCALING_SGDMA_OUT_NAMES    { SGDMA_OUT_NAME }
+#endif
+
+/* Interleaved channels per pixel, image widths and columns are in bytes. */
+#ifndef ACC_BILINEAR_SCALING_CHANNELS
+#define ACC_BILINEAR_SCALING_CHANNELS           (1)
+#endif
+
+/* Accelerator has its own Avalon-MM masters instead of the SGDMA streams. */
+#ifndef ACC_BILINEAR_SCALING_MM_MASTERS
+#define ACC_BILINEAR_SCALING_MM_MASTERS         (0)
+#endif
+
+/* Avalon-MM master registers, base addresses 32-bit, strides and offsets 16-bit. */
+#define ACC_BILINEAR_SCALING_SRC_BASE_ADDR      (0x40)
+#define ACC_BILINEAR_SCALING_SRC_STRIDE_ADDR    (0x44)
+#define ACC_BILINEAR_SCALING_ROI_X_ADDR         (0x46)
+#define ACC_BILINEAR_SCALING_ROI_Y_ADDR         (0x48)
+#define ACC_BILINEAR_SCALING_DST_BASE_ADDR      (0x4c)
+#define ACC_BILINEAR_SCALING_DST_STRIDE_ADDR    (0x50)
+#define ACC_BILINEAR_SCALING_DMA_CTL_ADDR       (0x52)
+#define ACC_BILINEAR_SCALING_DMA_STATUS_ADDR    (0x53)
+
+#define ACC_BILINEAR_SCALING_DMA_CTL_START_MSK      (0x01)
+#define ACC_BILINEAR_SCALING_DMA_STATUS_READ_MSK    (0x01)
+#define ACC_BILINEAR_SCALING_DMA_STATUS_WRITE_MSK   (0x02)
+
+/* Control register bits. */
+#define ACC_BILINEAR_SCALING_CTL_RESET_MSK  (0x01)
+#define ACC_BILINEAR_SCALING_CTL_IRQ_EN_MSK (0x02)
+#define ACC_BILINEAR_SCALING_CTL_ROW_TAG_MSK (0x04)
+
+/* Status register bits. */
+#define ACC_BILINEAR_SCALING_STATUS_IDLE_MSK    (0x01)
+#define ACC_BILINEAR_SCALING_STATUS_BUSY_MSK    (0x02)
+#define ACC_BILINEAR_SCALING_STATUS_DONE_MSK    (0x04)
+#define ACC_BILINEAR_SCALING_STATUS_ERROR_MSK   (0x08)
+
+/* Read-only performance counters, 32-bit each. */
+#define ACC_BILINEAR_SCALING_PERF_BUSY_ADDR         (0x10)
+#define ACC_BILINEAR_SCALING_PERF_IN_STALL_ADDR     (0x14)
+#define ACC_BILINEAR_SCALING_PERF_OUT_STALL_ADDR    (0x18)
+#define ACC_BILINEAR_SCALING_PERF_ROW_SWITCH_ADDR   (0x1c)
+#define ACC_BILINEAR_SCALING_PERF_PIXELS_ADDR       (0x20)
+#define ACC_BILINEAR_SCALING_PERF_ROWS_ADDR         (0x24)
+
+/* Accelerator performance counters for the last processed image. */
+typedef struct {
+    uint32_t busy;          /* Cycles from the first input pixel until the last output pixel. */
+    uint32_t in_stall;      /* Cycles waiting for input rows. */
+    uint32_t out_stall;     /* Cycles the pipeline was stopped by the output stream. */
+    uint32_t row_switch;    /* Cycles spent between output rows. */
+    uint32_t pixels;        /* Output pixels produced. */
+    uint32_t rows;          /* Output rows produced. */
+} acc_perf_t;
+
+void bilinear_scaling_hw_init();
+
+void bilinear_scaling_hw_verbose(uint8_t verbose);
+
+uint16_t bilinear_scaling_hw_row(uint8_t lane);
+
+void bilinear_scaling_hw_start(
+        image_t input,
+        image_t output,
+        float sx_float,
+        float sy_float,
+        uint16_t phase_y,
+        alt_sgdma_dev** sgdma_in,
+        alt_sgdma_dev** sgdma_out,
+        volatile uint16_t* tx_done,
+        volatile uint16_t* rx_done);
+
+void bilinear_scaling_hw_wait();
 
 image_t bilinear_scaling_hw(
         image_t input,
         float sx_float,
         float sy_float,
-        alt_sgdma_dev* sgdma_in,
-        alt_sgdma_dev* sgdma_out,
+        alt_sgdma_dev** sgdma_in,
+        alt_sgdma_dev** sgdma_out,
+        volatile uint16_t* tx_done,
+        volatile uint16_t* rx_done);
+
+band_engine_t bilinear_scaling_hw_engine(
+        alt_sgdma_dev** sgdma_in,
+        alt_sgdma_dev** sgdma_out,
         volatile uint16_t* tx_done,
         volatile uint16_t* rx_done);
 
+#if ACC_BILINEAR_SCALING_MM_MASTERS
+image_t bilinear_scaling_hw_mm(
+        image_t image,
+        uint32_t start_row,
+        uint32_t start_col,
+        uint32_t rows,
+        uint32_t cols,
+        float sx_float,
+        float sy_float);
+#endif
+
+acc_perf_t bilinear_scaling_hw_perf(uint8_t lane);
+
+uint32_t bilinear_scaling_hw_crc(uint8_t lane);
+
+uint32_t bilinear_scaling_hw_crc_ref(image_t input, image_t output, float sx_float, float sy_float, uint8_t lane);
+
+void print_hw_perf(acc_perf_t perf);
+
 #endif
@@ -1,7 +1,13 @@
 #include <assert.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifdef SOFTWARE_MODEL_ONLY
+#include <time.h>
+#include <unistd.h>
+#endif
 
 #ifndef SOFTWARE_MODEL_ONLY
 #include "altera_avalon_performance_counter.h"
@@ -13,21 +19,70 @@
 #include "bilinear_scaling_hw.h"
 #endif
 #include "software_model/bilinear_scaling.h"
+#include "software_model/registry.h"
+#ifdef SOFTWARE_MODEL_ONLY
+#include "software_model/cache.h"
+#include "software_model/daemon.h"
+#include "software_model/pipeline.h"
+#include "software_model/shard.h"
+#include "software_model/split.h"
+#include "software_model/workpool.h"
+#endif
 #include "software_model/utils.h"
 
 #ifndef SOFTWARE_MODEL_ONLY
 #define PATH_PREPEND_LEN    (10)    /* Length of ALTERA_HOSTFS_NAME"/". */
+#define FILENAME_SCAN       "%244s" /* Filename after the hostfs name, fits MAX_STRLEN with it. */
 #define RESULT_HW_NAME      "result_hw"
 #else
 #define PATH_PREPEND_LEN    (0)
+#define FILENAME_SCAN       "%254s"
 #endif
 #define RESULT_SW_NAME      "result_sw"
+#ifdef SOFTWARE_MODEL_ONLY
+#define RESULT_CACHE_NAME   "result_cache"  /* Directory of the outputs kept across runs of job files. */
+#ifndef RESULT_CACHE_LIMIT
+#define RESULT_CACHE_LIMIT  (256ull << 20)  /* Bytes of cached outputs, least recently used go first. */
+#endif
+#endif
 #define MAX_STRLEN          (255)   /* Maximum string length, used for static memory allocation. */
+#ifndef IMAGE_BUDGET
+#ifdef SOFTWARE_MODEL_ONLY
+#define IMAGE_BUDGET        (16u << 20) /* Bytes of loaded images kept for later jobs, least recently used go first. */
+#else
+#define IMAGE_BUDGET        (1u << 20)  /* Same on the board, a few images so outputs and the heap keep the SDRAM. */
+#endif
+#endif
 #define SAME_AS_BEFORE      '@'     /* Character used to signal that the same image is being used from previous input. */
 #define SAVE_FORMAT_BIN     'b'     /* Character indicating output image save format is bin */
 #define SAVE_FORMAT_PGM     'p'     /* Character indicating output image save format is pgm */
+#define SAVE_FORMAT_CRC     'c'     /* Character indicating outputs are only compared by their CRC, nothing is saved */
+#define BATCH_MARK          '<'     /* Filename prefix switching to batch mode, job records are read from the named file, or the rest of stdin if none. */
+#define PIPELINE_MARK       '|'     /* Filename prefix running the job records of the named file on the pipelined executor with the result cache, host only. */
+#define DIRECTORY_MARK      '+'     /* Filename prefix scaling all images of the named directory on a thread pool, host only. */
+#define SHARD_MARK          '%'     /* Filename prefix splitting the job records of the named file across worker processes, host only. */
+#define SPLIT_MARK          '='     /* Filename prefix scaling the named image with a worker process per band of rows, host only. */
+#define DAEMON_MARK         '&'     /* Filename prefix running the scaling daemon on the named socket until a client stops it, host only. */
+#define FRAMES_MARK         '#'     /* Filename prefix scaling the images listed in the named file as frames of a video, host only. */
+#define PAN_MARK            '^'     /* Filename switching panning on or off, the following jobs are also scaled reusing the previous output, host only. */
+
+/* Batch mode, progress isn't printed and every job ends with a summary line. */
+static uint8_t batch = 0;
+
+#define PRINT_STEP(...)     do { if (!batch) printf(__VA_ARGS__); } while (0)
+
+/* Whether the image file can be read. It is opened rather than checked with
+ * access(), so the check is the same through the hostfs of the board. */
+static int image_readable(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fclose(file);
+    return 1;
+}
 
-void get_input(
+int get_input(
         char* input_filename,
         char* save_format,
         unsigned* ul_x,
@@ -37,6 +92,247 @@ void get_input(
         float* sx,
         float* sy);
 
+int get_job(
+        FILE* jobs,
+        char* input_filename,
+        char* save_format,
+        unsigned* ul_x,
+        unsigned* ul_y,
+        unsigned* dr_x,
+        unsigned* dr_y,
+        float* sx,
+        float* sy);
+
+#ifdef SOFTWARE_MODEL_ONLY
+/* Reads all job records of the file, returns the number of jobs or -1 if the
+ * file can't be opened. Output filenames are the same as in batch mode. */
+int read_jobs(const char* jobs_filename, job_t** jobs) {
+    FILE* jobs_file = fopen(jobs_filename, "r");
+    if (jobs_file == NULL) {
+        printf("Can't open job file %s.\n", jobs_filename);
+        return -1;
+    }
+
+    uint32_t count = 0;
+    uint32_t capacity = 16;
+    *jobs = malloc(capacity*sizeof(job_t));
+    assert(*jobs != NULL);
+
+    for (;;) {
+        if (count == capacity) {
+            capacity *= 2;
+            *jobs = realloc(*jobs, capacity*sizeof(job_t));
+            assert(*jobs != NULL);
+        }
+        job_t* job = &(*jobs)[count];
+        int record = get_job(jobs_file, job->input_filename, &job->save_format,
+                &job->ul_x, &job->ul_y, &job->dr_x, &job->dr_y, &job->sx, &job->sy);
+        if (record < 0) {
+            continue;
+        }
+        if (record == 0) {
+            break;
+        }
+        if (job->save_format == SAVE_FORMAT_BIN) {
+            sprintf(job->output_filename, "%s", RESULT_SW_NAME".bin");
+        }
+        else if (job->save_format == SAVE_FORMAT_PGM) {
+            sprintf(job->output_filename, "%s", RESULT_SW_NAME".pgm");
+        }
+        else {
+            job->output_filename[0] = '\0';
+        }
+        count++;
+    }
+    fclose(jobs_file);
+
+    return count;
+}
+
+/* Runs all job records of the file on the pipelined executor, every job
+ * overwriting the output of the previous one as in batch mode. */
+void run_pipeline(const char* jobs_filename) {
+    job_t* jobs;
+    int count = read_jobs(jobs_filename, &jobs);
+    if (count < 0) {
+        return;
+    }
+
+    /* Jobs run before, in this or an earlier session, are taken from the cache. */
+    cache_t cache;
+    int cached = cache_init(&cache, RESULT_CACHE_NAME, RESULT_CACHE_LIMIT) == 0;
+
+    pipeline_stats_t stats = pipeline_run(jobs, count, cached ? &cache : NULL);
+    pipeline_print_stats(stats);
+    if (cached) {
+        cache_print_stats(cache.stats);
+    }
+
+    free(jobs);
+}
+
+/* Sharded run of the job file, the shards share the directory named after
+ * it. The shard command is one of:
+ *
+ *   plan      writes the manifest splitting the jobs into the entered count of shards
+ *   <shard>   runs the jobs of the shard, on any machine seeing the directory
+ *   merge     checks that every job was done exactly once
+ *   all       plans, runs every shard in its own process here and merges
+ */
+void run_shards(const char* jobs_filename) {
+    char directory[MAX_STRLEN];
+    char command[MAX_STRLEN];
+    unsigned shards = 0;
+
+    snprintf(directory, MAX_STRLEN, "%s.shards", jobs_filename);
+    printf("\nEnter shard command: ");
+    if (scanf("%254s", command) != 1) {
+        return;
+    }
+
+    if ((strcmp(command, "plan") == 0) || (strcmp(command, "all") == 0)) {
+        printf("\nEnter shard count: ");
+        scanf("%u", &shards);
+        assert(shards > 0);
+
+        job_t* jobs;
+        int count = read_jobs(jobs_filename, &jobs);
+        if (count < 0) {
+            return;
+        }
+        int error = shard_plan(directory, jobs, count, shards);
+        free(jobs);
+        if (error) {
+            return;
+        }
+        printf("\nPlanned %d jobs on %u shards in %s.\n", count, shards, directory);
+
+        if (strcmp(command, "all") == 0 && shard_spawn(directory) == 0) {
+            shard_merge(directory);
+        }
+    }
+    else if (strcmp(command, "merge") == 0) {
+        shard_merge(directory);
+    }
+    else if (shard_work(directory, atoi(command)) == 0) {
+        printf("\nShard %d done.\n", atoi(command));
+    }
+}
+#endif
+
+#ifdef SOFTWARE_MODEL_ONLY
+/* Scales the frames listed in the file, one image filename per line. Only
+ * the output tiles depending on pixels changed since the previous frame are
+ * recomputed, outputs are saved numbered by frame. */
+void run_frames(const char* list_filename, char save_format, float sx, float sy) {
+    char frame_filename[MAX_STRLEN];
+    char output_filename[MAX_STRLEN];
+    uint64_t recomputed = 0, pixels = 0;
+    unsigned count = 0;
+    frames_t frames;
+
+    FILE* list = fopen(list_filename, "r");
+    if (list == NULL) {
+        printf("Can't open frame list %s.\n", list_filename);
+        return;
+    }
+
+    bilinear_scaling_frames_init(&frames);
+    while (fscanf(list, "%254s", frame_filename) == 1) {
+        if (access(frame_filename, R_OK) != 0) {
+            printf("Can't read frame %s.\n", frame_filename);
+            break;
+        }
+        image_t input = bin2image(frame_filename);
+
+        clock_t begin = clock();
+        image_t output = bilinear_scaling_frame(&frames, input, sx, sy);
+        double ms = (clock() - begin)*1000.0/CLOCKS_PER_SEC;
+
+        if (save_format == SAVE_FORMAT_PGM || save_format == SAVE_FORMAT_BIN) {
+            sprintf(output_filename, RESULT_SW_NAME"_%04u.%s", count, (save_format == SAVE_FORMAT_PGM) ? "pgm" : "bin");
+            if (save_format == SAVE_FORMAT_PGM) {
+                save_to_pgm(output_filename, output);
+            }
+            else {
+                save_to_bin(output_filename, output);
+            }
+        }
+
+        uint64_t frame_pixels = (uint64_t)output.height*output.width;
+        printf("Frame %u: %s, %.1f%% recomputed, %.3f ms, CRC 0x%08" PRIx32 "\n", count + 1, frame_filename,
+                frame_pixels ? 100.0*frames.recomputed/frame_pixels : 0.0, ms, image_crc32(0, output));
+        recomputed += frames.recomputed;
+        pixels += frame_pixels;
+        count++;
+
+        image_free(input);
+    }
+    fclose(list);
+    bilinear_scaling_frames_free(&frames);
+
+    printf("%u frames, %.1f%% of the output recomputed.\n", count, pixels ? 100.0*recomputed/pixels : 0.0);
+}
+#endif
+
+#ifdef SOFTWARE_MODEL_ONLY
+/* Scales the image with a worker process per band of output rows, every
+ * worker reads only the input rows of its band. */
+void run_split(const char* image_filename, float sx, float sy) {
+    unsigned workers = 0;
+
+    printf("\nEnter worker count: ");
+    scanf("%u", &workers);
+    assert(workers > 0);
+
+    if (split_image(image_filename, RESULT_SW_NAME".bin", sx, sy, workers) == 0) {
+        printf("\nImage %s saved.\n", RESULT_SW_NAME".bin");
+    }
+}
+#endif
+
+#ifdef SOFTWARE_MODEL_ONLY
+/* Serves scaling requests of other processes on the socket, until one of
+ * them stops the daemon. */
+void run_daemon(const char* socket_path) {
+    daemon_stats_t stats;
+    int listener = daemon_listen(socket_path);
+
+    if (listener >= 0) {
+        printf("Daemon listening on %s.\n", socket_path);
+        fflush(stdout);
+        daemon_serve(listener, IMAGE_BUDGET, &stats);
+        printf("Daemon served %llu requests, %llu computed, %llu coalesced.\n",
+                (unsigned long long)stats.requests, (unsigned long long)stats.computed,
+                (unsigned long long)stats.coalesced);
+        registry_print_stats(stats.images);
+    }
+}
+#endif
+
+#ifdef SOFTWARE_MODEL_ONLY
+/* Scales every image of the directory on all cores, for comparison with a
+ * static split of the images in their order, with a static split largest
+ * first, and with work stealing from the same largest first split. */
+void run_directory(const char* directory, char save_format, float sx, float sy) {
+    dir_image_t* images;
+    uint32_t count = workpool_scan(directory, sx, sy, &images);
+    uint32_t workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("Scanned %u images in %s.\n", count, directory);
+    if (count > 0) {
+        workpool_stats_t stats = workpool_run(images, count, sx, sy, workers, 0, 0, save_format, RESULT_SW_NAME"_");
+        workpool_print_stats("Static split", stats);
+        stats = workpool_run(images, count, sx, sy, workers, 1, 0, save_format, RESULT_SW_NAME"_");
+        workpool_print_stats("Sorted static split", stats);
+        stats = workpool_run(images, count, sx, sy, workers, 1, 1, save_format, RESULT_SW_NAME"_");
+        workpool_print_stats("Work stealing", stats);
+    }
+
+    free(images);
+}
+#endif
+
 #ifndef SOFTWARE_MODEL_ONLY
 void transmit_callback_function(void* context) {
     uint16_t* tx_done = (uint16_t*) context;
@@ -47,25 +343,35 @@ void receive_callback_function(void* context) {
     uint16_t* rx_done = (uint16_t*) context;
     *rx_done = 0x0001;
 }
+
+/* Time of a performance counter section in milliseconds. */
+double section_ms(int section) {
+    return perf_get_section_time((void *)PERFORMANCE_COUNTER_BASE, section)*1000.0/alt_get_cpu_freq();
+}
 #endif
 
 int main() {
 
 #ifndef SOFTWARE_MODEL_ONLY
-    volatile uint16_t tx_done = 0x0000;
-    volatile uint16_t rx_done = 0x0000;
+    volatile uint16_t tx_done[ACC_BILINEAR_SCALING_LANES] = { 0x0000 };
+    volatile uint16_t rx_done[ACC_BILINEAR_SCALING_LANES] = { 0x0000 };
 #endif
 
 #ifndef SOFTWARE_MODEL_ONLY
     /* Filename holders, prepended with hostfs name so that relative paths can be used. */
     char input_filename[MAX_STRLEN] = ALTERA_HOSTFS_NAME"/";
     char output_filename[MAX_STRLEN] = ALTERA_HOSTFS_NAME"/";
+    char jobs_filename[MAX_STRLEN] = ALTERA_HOSTFS_NAME"/";
 #else
     /* Filename holders. */
     char input_filename[MAX_STRLEN];
     char output_filename[MAX_STRLEN];
+    char jobs_filename[MAX_STRLEN];
 #endif
 
+    /* Job records in batch mode, NULL while reading the prompts. */
+    FILE* jobs = NULL;
+
     /* Output file format. */
     char save_format;
 
@@ -78,61 +384,199 @@ int main() {
     /* Number of jobs done. */
     unsigned num = 0;
 
-    image_t image_in;
+    image_t image_in = { .data = NULL, .height = 0, .width = 0 };
+
+    /* Images loaded so far, jobs going back to one of them don't load it again. */
+    registry_t images;
+    registry_init(&images, IMAGE_BUDGET);
+#ifdef SOFTWARE_MODEL_ONLY
+    /* File of the loaded image, the input filename may be SAME_AS_BEFORE. */
+    char image_filename[MAX_STRLEN] = "";
+
+    /* Previous job, jobs panning over the same image reuse its output. Jobs
+     * are only panned once switched on, bilinear_scaling_sw stays the
+     * baseline the panned output is timed and checked against. */
+    uint8_t panning = 0;
+    pan_t pan;
+    bilinear_scaling_pan_init(&pan);
+#endif
 
 #ifndef SOFTWARE_MODEL_ONLY
-    /* SGDMA device instances */
-    alt_sgdma_dev* sgdma_in = alt_avalon_sgdma_open(SGDMA_IN_NAME);
-    alt_sgdma_dev* sgdma_out = alt_avalon_sgdma_open(SGDMA_OUT_NAME);
-
-    /* Registering sgdma_out transmit callback function. */
-    alt_avalon_sgdma_register_callback(
-        sgdma_out,
-        &transmit_callback_function,
-        (ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK |
-         ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK |
-         ALTERA_AVALON_SGDMA_CONTROL_PARK_MSK),
-        (void*)&tx_done);
+    /* SGDMA device instances, one pair per accelerator lane. */
+    const char* sgdma_in_names[ACC_BILINEAR_SCALING_LANES] = ACC_BILINEAR_SCALING_SGDMA_IN_NAMES;
+    const char* sgdma_out_names[ACC_BILINEAR_SCALING_LANES] = ACC_BILINEAR_SCALING_SGDMA_OUT_NAMES;
+    alt_sgdma_dev* sgdma_in[ACC_BILINEAR_SCALING_LANES];
+    alt_sgdma_dev* sgdma_out[ACC_BILINEAR_SCALING_LANES];
+
+    for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+        sgdma_in[lane] = alt_avalon_sgdma_open(sgdma_in_names[lane]);
+        sgdma_out[lane] = alt_avalon_sgdma_open(sgdma_out_names[lane]);
+
+        /* Registering sgdma_out transmit callback function. */
+        alt_avalon_sgdma_register_callback(
+            sgdma_out[lane],
+            &transmit_callback_function,
+            (ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK |
+             ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK |
+             ALTERA_AVALON_SGDMA_CONTROL_PARK_MSK),
+            (void*)&tx_done[lane]);
+
+        /* Registering sgdma_in receive callback function. */
+        alt_avalon_sgdma_register_callback(
+            sgdma_in[lane],
+            &receive_callback_function,
+            (ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK |
+             ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK |
+             ALTERA_AVALON_SGDMA_CONTROL_PARK_MSK),
+            (void*)&rx_done[lane]);
+    }
 
-    /* Registering sgdma_in receive callback function. */
-    alt_avalon_sgdma_register_callback(
-        sgdma_in,
-        &receive_callback_function,
-        (ALTERA_AVALON_SGDMA_CONTROL_IE_GLOBAL_MSK |
-         ALTERA_AVALON_SGDMA_CONTROL_IE_CHAIN_COMPLETED_MSK |
-         ALTERA_AVALON_SGDMA_CONTROL_PARK_MSK),
-        (void*)&rx_done);
+    /* Registering accelerator done interrupt. */
+    bilinear_scaling_hw_init();
 #endif
 
-    /* Endless loop processing */
+    /* Processing loop, runs until the input ends. */
     for (;;) {
 
-        /* Populate required fields from stdin. */
-        get_input(
-            input_filename,
-            &save_format,
-            &ul_x,
-            &ul_y,
-            &dr_x,
-            &dr_y,
-            &sx,
-            &sy);
-
-        /* If the input filename is SAME_AS_BEFORE don't load the image again. */
-        if ((input_filename[PATH_PREPEND_LEN] != SAME_AS_BEFORE) || (num == 0)) {
-            if (!image_in.data) image_free(image_in);
-            printf("Loading image %s...\n", input_filename);
-            image_in = bin2image(input_filename);
-            printf("Image %s loaded.\n", input_filename);
+        /* Populate required fields from the job records in batch mode, from
+         * the prompts otherwise. Stop when there is no more input. */
+        if (jobs != NULL) {
+            int record = get_job(
+                    jobs,
+                    input_filename,
+                    &save_format,
+                    &ul_x,
+                    &ul_y,
+                    &dr_x,
+                    &dr_y,
+                    &sx,
+                    &sy);
+            if (record < 0) {
+                continue;
+            }
+            if (record == 0) {
+                if (jobs == stdin) {
+                    break;
+                }
+                /* Back to the prompts once the job file ends. */
+                fclose(jobs);
+                jobs = NULL;
+                batch = 0;
+#ifndef SOFTWARE_MODEL_ONLY
+                bilinear_scaling_hw_verbose(1);
+#endif
+                continue;
+            }
+        }
+        else {
+            if (!get_input(
+                    input_filename,
+                    &save_format,
+                    &ul_x,
+                    &ul_y,
+                    &dr_x,
+                    &dr_y,
+                    &sx,
+                    &sy)) {
+                break;
+            }
+
+#ifdef SOFTWARE_MODEL_ONLY
+            /* Job records of the file are loaded, scaled and saved by the pipeline stages. */
+            if (input_filename[PATH_PREPEND_LEN] == PIPELINE_MARK) {
+                run_pipeline(input_filename + PATH_PREPEND_LEN + 1);
+                continue;
+            }
+
+            if (input_filename[PATH_PREPEND_LEN] == PAN_MARK) {
+                panning = !panning;
+                printf("Panning %s.\n", panning ? "on" : "off");
+                continue;
+            }
+
+            if (input_filename[PATH_PREPEND_LEN] == FRAMES_MARK) {
+                run_frames(input_filename + PATH_PREPEND_LEN + 1, save_format, sx, sy);
+                continue;
+            }
+
+            /* Whole image, saved to the bin output right away. */
+            if (input_filename[PATH_PREPEND_LEN] == SPLIT_MARK) {
+                run_split(input_filename + PATH_PREPEND_LEN + 1, sx, sy);
+                continue;
+            }
+
+            if (input_filename[PATH_PREPEND_LEN] == SHARD_MARK) {
+                run_shards(input_filename + PATH_PREPEND_LEN + 1);
+                continue;
+            }
+
+            /* Serves other processes until stopped, then the prompts go on. */
+            if (input_filename[PATH_PREPEND_LEN] == DAEMON_MARK) {
+                run_daemon(input_filename + PATH_PREPEND_LEN + 1);
+                continue;
+            }
+
+            /* Whole images of the directory, the static split is run first as the baseline. */
+            if (input_filename[PATH_PREPEND_LEN] == DIRECTORY_MARK) {
+                run_directory(input_filename + PATH_PREPEND_LEN + 1, save_format, sx, sy);
+                continue;
+            }
+#endif
+
+            /* Switch to batch mode, job records follow. */
+            if (input_filename[PATH_PREPEND_LEN] == BATCH_MARK) {
+                if (input_filename[PATH_PREPEND_LEN + 1] == '\0') {
+                    jobs = stdin;
+                }
+                else {
+                    sprintf(jobs_filename + PATH_PREPEND_LEN, "%s", input_filename + PATH_PREPEND_LEN + 1);
+                    jobs = fopen(jobs_filename, "r");
+                    if (jobs == NULL) {
+                        printf("Can't open job file %s.\n", jobs_filename);
+                        continue;
+                    }
+                }
+                batch = 1;
+#ifndef SOFTWARE_MODEL_ONLY
+                bilinear_scaling_hw_verbose(0);
+#endif
+                continue;
+            }
+        }
+
+        /* Failed checks of the job. */
+        unsigned job_errors = 0;
+
+        /* If the input filename is SAME_AS_BEFORE don't load the image again.
+         * Jobs naming an image that can't be read are skipped, the image of
+         * the previous job stays loaded. */
+        if ((input_filename[PATH_PREPEND_LEN] != SAME_AS_BEFORE) || (image_in.data == NULL)) {
+            if (!image_readable(input_filename)) {
+                printf("Image %s can't be read, job skipped.\n", input_filename);
+                continue;
+            }
+            if (image_in.data) registry_release(&images, image_in);
+            PRINT_STEP("Loading image %s...\n", input_filename);
+            image_in = registry_acquire(&images, input_filename);
+#ifdef SOFTWARE_MODEL_ONLY
+            sprintf(image_filename, "%s", input_filename);
+#endif
+            PRINT_STEP("Image %s loaded.\n", input_filename);
         }
 
         /* Segment dimensions. */
         unsigned seg_width = dr_x - ul_x + 1;
         unsigned seg_height = dr_y - ul_y + 1;
 
+        /* Segments reaching past the image are skipped. */
+        if ((ul_x + seg_height > image_in.height) || (ul_y + seg_width > image_in.width)) {
+            printf("Segment %u %u %u %u out of image %s, job skipped.\n", ul_x, ul_y, dr_x, dr_y, input_filename);
+            continue;
+        }
+
         /* Extract segment from the input image. */
         image_t input_segment = extract_segment(image_in, ul_x, ul_y, seg_height, seg_width);
-        printf("Extracted segment.\n");
+        PRINT_STEP("Extracted segment.\n");
 
 #ifndef SOFTWARE_MODEL_ONLY
         /* Reset the performance counter unit. */
@@ -140,22 +584,59 @@ int main() {
         PERF_START_MEASURING(PERFORMANCE_COUNTER_BASE);
 #endif
 
-#ifndef SOFTWARE_MODEL_ONLY
         /* Software processing. */
+#ifndef SOFTWARE_MODEL_ONLY
         PERF_BEGIN(PERFORMANCE_COUNTER_BASE, 1);
+#else
+        clock_t sw_begin = clock();
 #endif
+#if !defined(SOFTWARE_MODEL_ONLY) && ACC_BILINEAR_SCALING_CHANNELS > 1
+        /* Pixels are interleaved channels, each channel is scaled on its own. */
+        image_t output_image_sw = bilinear_scaling_sw_channels(input_segment, sx, sy, ACC_BILINEAR_SCALING_CHANNELS);
+#else
         image_t output_image_sw = bilinear_scaling_sw(input_segment, sx, sy);
+#endif
 #ifndef SOFTWARE_MODEL_ONLY
         PERF_END(PERFORMANCE_COUNTER_BASE, 1);
+#else
+        double sw_ms = (clock() - sw_begin)*1000.0/CLOCKS_PER_SEC;
+#endif
+        PRINT_STEP("Image scaled (software).\n\n");
+
+#ifdef SOFTWARE_MODEL_ONLY
+        /* Panned output, must be the same as the baseline. */
+        double pan_ms = 0.0;
+        if (panning) {
+            clock_t pan_begin = clock();
+            image_t output_image_pan = bilinear_scaling_pan(&pan, image_filename, image_in, ul_x, ul_y, seg_height, seg_width, sx, sy);
+            pan_ms = (clock() - pan_begin)*1000.0/CLOCKS_PER_SEC;
+            if (image_equal(output_image_sw, output_image_pan)) {
+                PRINT_STEP("Image scaled (panning), output matches.\n\n");
+            }
+            else {
+                PRINT_STEP("Image scaled (panning), output differs!\n\n");
+                job_errors++;
+            }
+            image_free(output_image_pan);
+        }
 #endif
-        printf("Image scaled (software).\n\n");
 
 #ifndef SOFTWARE_MODEL_ONLY
         /* Hardware processing. */
         PERF_BEGIN(PERFORMANCE_COUNTER_BASE, 2);
-        image_t output_image_hw = bilinear_scaling_hw(input_segment, sx, sy, sgdma_in, sgdma_out, &tx_done, &rx_done);
+#if ACC_BILINEAR_SCALING_MM_MASTERS
+        image_t output_image_hw = bilinear_scaling_hw_mm(image_in, ul_x, ul_y, seg_height, seg_width, sx, sy);
+#else
+        image_t output_image_hw = bilinear_scaling_hw(input_segment, sx, sy, sgdma_in, sgdma_out, tx_done, rx_done);
+#endif
         PERF_END(PERFORMANCE_COUNTER_BASE, 2);
-        printf("Image scaled (hardware).\n\n");
+        PRINT_STEP("Image scaled (hardware).\n\n");
+
+        /* Counters hold their values until the next image is started. */
+        acc_perf_t acc_perf[ACC_BILINEAR_SCALING_LANES];
+        for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+            acc_perf[lane] = bilinear_scaling_hw_perf(lane);
+        }
 #endif
 
         if (save_format == SAVE_FORMAT_PGM) {
@@ -163,33 +644,119 @@ int main() {
 #ifndef SOFTWARE_MODEL_ONLY
             sprintf(output_filename + PATH_PREPEND_LEN, "%s", RESULT_HW_NAME".pgm");
             save_to_pgm(output_filename, output_image_hw);
-            printf("\nImage %s saved.\n", output_filename);
+            PRINT_STEP("\nImage %s saved.\n", output_filename);
 #endif
             sprintf(output_filename + PATH_PREPEND_LEN, "%s", RESULT_SW_NAME".pgm");
             save_to_pgm(output_filename, output_image_sw);
-            printf("\nImage %s saved.\n", output_filename);
+            PRINT_STEP("\nImage %s saved.\n", output_filename);
         }
         else if (save_format == SAVE_FORMAT_BIN) {
 #ifndef SOFTWARE_MODEL_ONLY
             sprintf(output_filename + PATH_PREPEND_LEN, "%s", RESULT_HW_NAME".bin");
             save_to_bin(output_filename, output_image_hw);
-            printf("\nImage %s saved.\n", output_filename);
+            PRINT_STEP("\nImage %s saved.\n", output_filename);
 #endif
             sprintf(output_filename + PATH_PREPEND_LEN, "%s", RESULT_SW_NAME".bin");
             save_to_bin(output_filename, output_image_sw);
-            printf("\nImage %s saved.\n", output_filename);
+            PRINT_STEP("\nImage %s saved.\n", output_filename);
+        }
+        else if (save_format == SAVE_FORMAT_CRC) {
+#ifndef SOFTWARE_MODEL_ONLY
+            /* Each lane checksums its own output, compare them lane by lane. */
+            unsigned crc_errors = 0;
+            for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+                uint32_t crc_hw = bilinear_scaling_hw_crc(lane);
+                uint32_t crc_sw = bilinear_scaling_hw_crc_ref(input_segment, output_image_sw, sx, sy, lane);
+                if (crc_hw != crc_sw) {
+                    PRINT_STEP("\nAccelerator lane %u CRC 0x%08" PRIx32 ", expected 0x%08" PRIx32 ".\n", lane, crc_hw, crc_sw);
+                    crc_errors++;
+                }
+            }
+            if (crc_errors == 0) {
+                PRINT_STEP("\nHardware output CRC matches software.\n");
+            }
+            else {
+                PRINT_STEP("\nHardware output CRC differs!\n");
+                job_errors++;
+            }
+#else
+            PRINT_STEP("\nSoftware output CRC 0x%08" PRIx32 ".\n", image_crc32(0, output_image_sw));
+#endif
         }
 
+#if !defined(SOFTWARE_MODEL_ONLY) && !ACC_BILINEAR_SCALING_MM_MASTERS
+        /* Hybrid processing, the accelerator and the CPU each scale a band of
+         * rows, split by the times both took for the whole segment so that
+         * they finish together. */
+        uint32_t hybrid_rows = bilinear_scaling_split_rows(
+                output_image_hw.height,
+                perf_get_section_time((void *)PERFORMANCE_COUNTER_BASE, 2),
+                perf_get_section_time((void *)PERFORMANCE_COUNTER_BASE, 1));
+        PERF_BEGIN(PERFORMANCE_COUNTER_BASE, 3);
+        image_t output_image_hybrid = bilinear_scaling_hybrid(input_segment, sx, sy, ACC_BILINEAR_SCALING_CHANNELS, hybrid_rows,
+                bilinear_scaling_hw_engine(sgdma_in, sgdma_out, tx_done, rx_done));
+        PERF_END(PERFORMANCE_COUNTER_BASE, 3);
+        PRINT_STEP("Image scaled (hybrid, %" PRIu32 " of %" PRIu32 " rows in hardware).\n\n", hybrid_rows, output_image_hw.height);
+        if (image_equal(output_image_hw, output_image_hybrid)) {
+            PRINT_STEP("Hybrid output matches.\n");
+        }
+        else {
+            PRINT_STEP("Hybrid output differs!\n");
+            job_errors++;
+        }
+        image_free(output_image_hybrid);
+#endif
+
 #ifndef SOFTWARE_MODEL_ONLY
         /* Print performance comparison results. */
-        perf_print_formatted_report(
-                (void *)PERFORMANCE_COUNTER_BASE,
-                alt_get_cpu_freq(),
-                2,
-                "Software",
-                "Hardware");
+        if (!batch) {
+#if ACC_BILINEAR_SCALING_MM_MASTERS
+            perf_print_formatted_report(
+                    (void *)PERFORMANCE_COUNTER_BASE,
+                    alt_get_cpu_freq(),
+                    2,
+                    "Software",
+                    "Hardware");
+#else
+            perf_print_formatted_report(
+                    (void *)PERFORMANCE_COUNTER_BASE,
+                    alt_get_cpu_freq(),
+                    3,
+                    "Software",
+                    "Hardware",
+                    "Hybrid");
+#endif
+            for (unsigned lane = 0; lane < ACC_BILINEAR_SCALING_LANES; lane++) {
+                printf("\nAccelerator lane %u:\n", lane);
+                print_hw_perf(acc_perf[lane]);
+            }
+        }
 #endif
 
+        /* One line per job in batch mode. */
+        if (batch) {
+            printf("Job %u: %s %ux%u -> %ux%u, software %.3f ms",
+                    num + 1,
+                    input_filename + PATH_PREPEND_LEN,
+                    seg_width,
+                    seg_height,
+                    (unsigned)output_image_sw.width,
+                    (unsigned)output_image_sw.height,
+#ifndef SOFTWARE_MODEL_ONLY
+                    section_ms(1));
+            printf(", hardware %.3f ms", section_ms(2));
+#if !ACC_BILINEAR_SCALING_MM_MASTERS
+            printf(", hybrid %.3f ms", section_ms(3));
+#endif
+#else
+                    sw_ms);
+            if (panning) {
+                printf(", panning %.3f ms", pan_ms);
+            }
+#endif
+            printf(", %s\n", (job_errors == 0) ? "ok" : "FAILED");
+        }
+
         /* Update number of jobs done */
         num++;
 
@@ -201,12 +768,23 @@ int main() {
         free(input_segment.data);     /* Input segment is a shallow copy. */
     }
 
+#ifdef SOFTWARE_MODEL_ONLY
+    uint64_t pan_pixels = pan.reused + pan.computed;
+    if (pan_pixels) {
+        printf("Panning reused %.1f%% of the output.\n", 100.0*pan.reused/pan_pixels);
+    }
+    bilinear_scaling_pan_free(&pan);
+#endif
+    if (image_in.data) registry_release(&images, image_in);
+    registry_print_stats(images.stats);
+    registry_free(&images);
+
     printf("Exiting.\n");
     return 0;
 }
 
 
-void get_input(
+int get_input(
         char* input_filename,
         char* save_format,
         unsigned* ul_x,
@@ -217,13 +795,78 @@ void get_input(
         float* sy) {
 
     printf("Enter input filename: ");
-    scanf("%s", input_filename + PATH_PREPEND_LEN);
+    if (scanf(FILENAME_SCAN, input_filename + PATH_PREPEND_LEN) != 1) {
+        printf("\n");
+        return 0;
+    }
+    /* Job records follow, requests come over the daemon socket, or panning is switched, the rest of the prompts are skipped. */
+    if ((input_filename[PATH_PREPEND_LEN] == BATCH_MARK) ||
+        (input_filename[PATH_PREPEND_LEN] == PIPELINE_MARK) ||
+        (input_filename[PATH_PREPEND_LEN] == SHARD_MARK) ||
+        (input_filename[PATH_PREPEND_LEN] == DAEMON_MARK) ||
+        (input_filename[PATH_PREPEND_LEN] == PAN_MARK)) {
+        return 1;
+    }
     printf("\nEnter output image format: ");
     scanf(" %c", save_format);
-    printf("\nEnter endpoint coordinates: ");
-    scanf("%u %u %u %u", ul_x, ul_y, dr_x, dr_y);
-    assert((*dr_x > *ul_x) && (*dr_y > *ul_y));
+    /* Whole images are scaled, there is no segment. */
+    if ((input_filename[PATH_PREPEND_LEN] != DIRECTORY_MARK) &&
+        (input_filename[PATH_PREPEND_LEN] != SPLIT_MARK) &&
+        (input_filename[PATH_PREPEND_LEN] != FRAMES_MARK)) {
+        printf("\nEnter endpoint coordinates: ");
+        scanf("%u %u %u %u", ul_x, ul_y, dr_x, dr_y);
+        assert((*dr_x > *ul_x) && (*dr_y > *ul_y));
+    }
     printf("\nEnter scaling factors: ");
     scanf("%f %f", sx, sy);
     assert((*sx > 0) && (*sy > 0));
+    return 1;
+}
+
+
+/* Reads a job record, the same fields as the prompts on a single line:
+ *
+ *   <input filename> <output format> <ul_x> <ul_y> <dr_x> <dr_y> <sx> <sy>
+ *
+ * Returns 1 for a job, 0 once the records end and -1 for a malformed record
+ * or one with an empty segment or scaling factor, which is reported and has
+ * to be skipped. Blank lines are skipped silently.
+ */
+int get_job(
+        FILE* jobs,
+        char* input_filename,
+        char* save_format,
+        unsigned* ul_x,
+        unsigned* ul_y,
+        unsigned* dr_x,
+        unsigned* dr_y,
+        float* sx,
+        float* sy) {
+
+    char record[2*MAX_STRLEN];
+    if (fgets(record, sizeof(record), jobs) == NULL) {
+        return 0;
+    }
+    /* Records are parsed a line at a time, so a malformed one can't take
+     * fields of the next. The rest of an overlong line goes with it. */
+    if (strchr(record, '\n') == NULL) {
+        int c;
+        while ((c = fgetc(jobs)) != '\n' && c != EOF);
+    }
+
+    int fields = sscanf(record, FILENAME_SCAN" %c %u %u %u %u %f %f",
+            input_filename + PATH_PREPEND_LEN, save_format, ul_x, ul_y, dr_x, dr_y, sx, sy);
+    if (fields == EOF) {
+        return -1;
+    }
+    if (fields != 8) {
+        printf("Invalid job record skipped.\n");
+        return -1;
+    }
+    if ((*dr_x <= *ul_x) || (*dr_y <= *ul_y) || (*sx <= 0) || (*sy <= 0)) {
+        printf("Job record %s %c %u %u %u %u %g %g skipped, empty segment or scaling factor.\n",
+                input_filename + PATH_PREPEND_LEN, *save_format, *ul_x, *ul_y, *dr_x, *dr_y, *sx, *sy);
+        return -1;
+    }
+    return 1;
 }
@@ -183,11 +183,11 @@
  *
  */
 
-#define ACC_BILINEAR_SCALING_BASE 0x4001110
-#define ACC_BILINEAR_SCALING_IRQ -1
-#define ACC_BILINEAR_SCALING_IRQ_INTERRUPT_CONTROLLER_ID -1
+#define ACC_BILINEAR_SCALING_BASE 0x4001140
+#define ACC_BILINEAR_SCALING_IRQ 3
+#define ACC_BILINEAR_SCALING_IRQ_INTERRUPT_CONTROLLER_ID 0
 #define ACC_BILINEAR_SCALING_NAME "/dev/acc_bilinear_scaling"
-#define ACC_BILINEAR_SCALING_SPAN 16
+#define ACC_BILINEAR_SCALING_SPAN 64
 #define ACC_BILINEAR_SCALING_TYPE "acc_bilinear_scaling"
 #define ALT_MODULE_CLASS_acc_bilinear_scaling acc_bilinear_scaling
 
@@ -1,4 +1,8 @@
+#include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "bilinear_scaling.h"
 #include "utils.h"
@@ -9,6 +13,34 @@
 
 image_t bilinear_scaling_sw(image_t input, float sx_float, float sy_float) {
 
+    /* Output dimensions and input image coordinates increments. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory. */
+    image_t output = image_alloc(out_height, out_width);
+
+    bilinear_scaling_window(input, output, increment_x, increment_y, 0, 0);
+
+    return output;
+}
+
+
+/* Output dimensions and input coordinate increments of an image, from the
+ * fixed point codes of the scaling factors. Every variant takes them from
+ * here, so they all agree with each other and with the accelerator. Results
+ * not needed may be NULL. */
+void bilinear_scaling_geometry(
+            uint32_t in_height,
+            uint32_t in_width,
+            float sx_float,
+            float sy_float,
+            uint32_t* out_height,
+            uint32_t* out_width,
+            uint16_t* increment_x,
+            uint16_t* increment_y) {
+
     /* Conversion to fixed point of the scaling factors. */
     uint8_t sx = to_fixed_point(sx_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
     uint8_t sy = to_fixed_point(sy_float, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC);
@@ -17,18 +49,23 @@ image_t bilinear_scaling_sw(image_t input, float sx_float, float sy_float) {
     float sx_fx = from_fixed_point(sx, BILINEAR_SCALING_SF_NFRAC);
     float sy_fx = from_fixed_point(sy, BILINEAR_SCALING_SF_NFRAC);
 
-    /* Allocate output image memory. */
-    image_t output = image_alloc(input.height*sy_fx, input.width*sx_fx);
+    if (out_height) *out_height = in_height*sy_fx;
+    if (out_width) *out_width = in_width*sx_fx;
 
-    /* Input image coordinates. */
     /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
-    uint32_t x = 0;
-    uint32_t y = 0;
+    if (increment_x) *increment_x = to_fixed_point(1/sx_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
+    if (increment_y) *increment_y = to_fixed_point(1/sy_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
+}
+
+
+/* Scales input to fill output, same as the accelerator does. Every output row
+ * starts at the input x coordinate phase_x, the first one at y coordinate phase_y. */
+void bilinear_scaling_window(image_t input, image_t output, uint16_t increment_x, uint16_t increment_y, uint16_t phase_x, uint16_t phase_y) {
 
-    /* Input image coordinates increment. */
+    /* Input image coordinates. */
     /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
-    uint16_t increment_x = to_fixed_point(1/sx_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
-    uint16_t increment_y = to_fixed_point(1/sy_fx, BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC);
+    uint32_t x = phase_x;
+    uint32_t y = phase_y;
 
     /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
     uint32_t alpha_x, alpha_y;
@@ -51,7 +88,7 @@ image_t bilinear_scaling_sw(image_t input, float sx_float, float sy_float) {
         /* Saturating if at the last row. */
         floor_y1 = (floor_y >= input.height-1) ? floor_y : floor_y+1;
 
-        x = 0;
+        x = phase_x;
         for(int u=0; u<output.width; u++) {
             /* Getting neccesary parameters. */
             alpha_x = GET_FRAC_UINT32_T(x, BILINEAR_SCALING_NFRAC);
@@ -74,6 +111,620 @@ image_t bilinear_scaling_sw(image_t input, float sx_float, float sy_float) {
         }
         y += increment_y;
     }
+}
+
+
+/* Splits the output columns into strips which need at most max_width input
+ * columns each. Every pixel group lies within a single strip, so scaling the
+ * strips separately gives the same result as scaling the whole image.
+ * Returns the number of strips, strips are only stored if strips isn't NULL. */
+uint32_t bilinear_scaling_strips(uint32_t in_width, uint32_t out_width, uint16_t increment_x, uint32_t max_width, strip_t* strips) {
+    uint32_t count = 0;
+    uint32_t u = 0;
+
+    /* At least a single pixel group has to fit in a strip. */
+    assert(max_width >= 2);
+
+    while (u < out_width) {
+        strip_t strip;
+        /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+        uint32_t x = u*increment_x;
+        /* Last input column used by the strip. */
+        uint32_t last = 0;
+
+        strip.out_start = u;
+        strip.in_start = GET_INT_UINT32_T(x, BILINEAR_SCALING_NFRAC);
+        strip.phase_x = GET_FRAC_UINT32_T(x, BILINEAR_SCALING_NFRAC);
+
+        for (; u < out_width; u++) {
+            x = u*increment_x;
+            uint32_t floor_x = GET_INT_UINT32_T(x, BILINEAR_SCALING_NFRAC);
+            /* Saturating if at the end of the row. */
+            uint32_t floor_x1 = (floor_x >= in_width-1) ? floor_x : floor_x+1;
+            if (floor_x1 - strip.in_start + 1 > max_width) break;
+            last = floor_x1;
+        }
+
+        strip.out_width = u - strip.out_start;
+        strip.in_width = last - strip.in_start + 1;
+
+        if (strips) strips[count] = strip;
+        count++;
+    }
+
+    return count;
+}
+
+
+/* Scales the image strip by strip, models the accelerator in strip mode. */
+image_t bilinear_scaling_sw_strips(image_t input, float sx_float, float sy_float, uint32_t max_width) {
+
+    /* Output dimensions and input image coordinates increments. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory. */
+    image_t output = image_alloc(out_height, out_width);
+
+    uint32_t count = bilinear_scaling_strips(input.width, output.width, increment_x, max_width, NULL);
+    strip_t* strips = malloc(count*sizeof(strip_t));
+    assert(strips != NULL);
+    bilinear_scaling_strips(input.width, output.width, increment_x, max_width, strips);
+
+    for (uint32_t i=0; i<count; i++) {
+        image_t strip_in = extract_segment(input, 0, strips[i].in_start, input.height, strips[i].in_width);
+        image_t strip_out = image_alloc(output.height, strips[i].out_width);
+
+        bilinear_scaling_window(strip_in, strip_out, increment_x, increment_y, strips[i].phase_x, 0);
+
+        /* Stitching the strip into the output image. */
+        for (uint32_t v=0; v<output.height; v++) {
+            memcpy(&output.data[v][strips[i].out_start], strip_out.data[v], strip_out.width);
+        }
+
+        free(strip_in.data);    /* Input strip is a shallow copy. */
+        image_free(strip_out);
+    }
+
+    free(strips);
 
     return output;
 }
+
+
+/* Band of the output rows out_start up to out_end, the first one at the y
+ * coordinate phase_y. The band carries the bottom row of its last pixel group. */
+static band_t bilinear_scaling_band(uint32_t in_height, uint16_t increment_y, uint16_t phase_y, uint32_t out_start, uint32_t out_end) {
+    band_t band;
+
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    uint32_t y = phase_y + out_start*increment_y;
+    /* Last row of the band. */
+    uint32_t y_last = (out_end > out_start) ? phase_y + (out_end-1)*increment_y : y;
+    uint32_t floor_y = GET_INT_UINT32_T(y_last, BILINEAR_SCALING_NFRAC);
+    /* Saturating if at the last row. */
+    uint32_t floor_y1 = (floor_y >= in_height-1) ? floor_y : floor_y+1;
+
+    band.out_start = out_start;
+    band.out_height = out_end - out_start;
+    band.in_start = GET_INT_UINT32_T(y, BILINEAR_SCALING_NFRAC);
+    band.in_height = floor_y1 - band.in_start + 1;
+    band.phase_y = GET_FRAC_UINT32_T(y, BILINEAR_SCALING_NFRAC);
+
+    return band;
+}
+
+
+/* Splits the output rows evenly into count bands, the first output row is at
+ * the y coordinate phase_y. Every band carries the bottom row of its last
+ * pixel group, so scaling the bands separately gives the same result as
+ * scaling the whole image. */
+void bilinear_scaling_bands(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint16_t phase_y, uint32_t count, band_t* bands) {
+    for (uint32_t i=0; i<count; i++) {
+        bands[i] = bilinear_scaling_band(in_height, increment_y, phase_y, i*out_height/count, (i+1)*out_height/count);
+    }
+}
+
+
+/* Splits the output rows into two bands, the first one of first_rows rows. */
+void bilinear_scaling_split(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint32_t first_rows, band_t* bands) {
+    assert(first_rows <= out_height);
+    bands[0] = bilinear_scaling_band(in_height, increment_y, 0, 0, first_rows);
+    bands[1] = bilinear_scaling_band(in_height, increment_y, 0, first_rows, out_height);
+}
+
+
+/* Output rows given to the engine so that it finishes together with the CPU,
+ * from the times both took for the whole image. */
+uint32_t bilinear_scaling_split_rows(uint32_t out_height, uint64_t engine_time, uint64_t cpu_time) {
+    if (engine_time + cpu_time == 0) {
+        return out_height/2;
+    }
+    return (uint64_t)out_height*cpu_time/(engine_time + cpu_time);
+}
+
+
+/* Scales the image band by band, models the multi-lane accelerator. */
+image_t bilinear_scaling_sw_bands(image_t input, float sx_float, float sy_float, uint32_t count) {
+
+    /* Output dimensions and input image coordinates increments. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory. */
+    image_t output = image_alloc(out_height, out_width);
+
+    band_t* bands = malloc(count*sizeof(band_t));
+    assert(bands != NULL);
+    bilinear_scaling_bands(input.height, output.height, increment_y, 0, count, bands);
+
+    for (uint32_t i=0; i<count; i++) {
+        /* Band views of the images, output rows are written in place. */
+        image_t band_in = extract_segment(input, bands[i].in_start, 0, bands[i].in_height, input.width);
+        image_t band_out = extract_segment(output, bands[i].out_start, 0, bands[i].out_height, output.width);
+
+        bilinear_scaling_window(band_in, band_out, increment_x, increment_y, 0, bands[i].phase_y);
+
+        free(band_in.data);     /* Band views are shallow copies. */
+        free(band_out.data);
+    }
+
+    free(bands);
+
+    return output;
+}
+
+
+/* Finds the input rows sampled by the y coordinate walk, when downscaling the
+ * rows in between are never used. Row indices are in increasing order.
+ * Returns the number of rows, rows are only stored if rows isn't NULL. */
+uint32_t bilinear_scaling_rows(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint16_t phase_y, uint16_t* rows) {
+    uint32_t count = 0;
+    /* First row not listed yet. */
+    uint32_t next = 0;
+
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    uint32_t y = phase_y;
+
+    for (uint32_t v=0; v<out_height; v++) {
+        uint32_t floor_y = GET_INT_UINT32_T(y, BILINEAR_SCALING_NFRAC);
+        /* Saturating if at the last row. */
+        uint32_t floor_y1 = (floor_y >= in_height-1) ? floor_y : floor_y+1;
+
+        if (floor_y >= next) {
+            if (rows) rows[count] = floor_y;
+            count++;
+        }
+        if (floor_y1 > floor_y && floor_y1 >= next) {
+            if (rows) rows[count] = floor_y1;
+            count++;
+        }
+        next = floor_y1 + 1;
+
+        y += increment_y;
+    }
+
+    return count;
+}
+
+
+/* Scales the image using only the rows the y coordinate walk samples, models
+ * the accelerator in row tag mode. Rows not transferred are left zeroed. */
+image_t bilinear_scaling_sw_rows(image_t input, float sx_float, float sy_float) {
+
+    /* Output dimensions and input image coordinates increments. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory. */
+    image_t output = image_alloc(out_height, out_width);
+
+    uint32_t count = bilinear_scaling_rows(input.height, output.height, increment_y, 0, NULL);
+    uint16_t* rows = malloc(count*sizeof(uint16_t));
+    assert(rows != NULL);
+    bilinear_scaling_rows(input.height, output.height, increment_y, 0, rows);
+
+    /* Line buffers receive only the tagged rows. */
+    image_t received = image_alloc(input.height, input.width);
+    for (uint32_t v=0; v<received.height; v++) {
+        memset(received.data[v], 0, received.width);
+    }
+    for (uint32_t i=0; i<count; i++) {
+        memcpy(received.data[rows[i]], input.data[rows[i]], input.width);
+    }
+
+    bilinear_scaling_window(received, output, increment_x, increment_y, 0, 0);
+
+    image_free(received);
+    free(rows);
+
+    return output;
+}
+
+
+/* Scales input to fill output the same as bilinear_scaling_window, for images
+ * of interleaved channels with widths in bytes. Every channel is scaled on its
+ * own with the same coordinates. */
+static void bilinear_scaling_window_channels(image_t input, image_t output, uint16_t increment_x, uint16_t increment_y, uint16_t phase_y, uint32_t channels) {
+    assert(input.width % channels == 0 && output.width % channels == 0);
+
+    if (channels == 1) {
+        bilinear_scaling_window(input, output, increment_x, increment_y, 0, phase_y);
+        return;
+    }
+
+    image_t plane = image_alloc(input.height, input.width/channels);
+    image_t plane_out = image_alloc(output.height, output.width/channels);
+
+    for (uint32_t c=0; c<channels; c++) {
+        for (uint32_t v=0; v<plane.height; v++) {
+            for (uint32_t u=0; u<plane.width; u++) {
+                plane.data[v][u] = input.data[v][u*channels + c];
+            }
+        }
+
+        bilinear_scaling_window(plane, plane_out, increment_x, increment_y, 0, phase_y);
+
+        for (uint32_t v=0; v<plane_out.height; v++) {
+            for (uint32_t u=0; u<plane_out.width; u++) {
+                output.data[v][u*channels + c] = plane_out.data[v][u];
+            }
+        }
+    }
+
+    image_free(plane);
+    image_free(plane_out);
+}
+
+
+/* Scales an image of interleaved channels, width of the image is in bytes.
+ * Models the accelerator streaming multi-channel pixels. */
+image_t bilinear_scaling_sw_channels(image_t input, float sx_float, float sy_float, uint32_t channels) {
+
+    /* Output dimensions and input image coordinates increments, of the
+     * pixels rather than the bytes of a row. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width/channels, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory, widths of the pixels of all channels. */
+    image_t output = image_alloc(out_height, out_width*channels);
+
+    bilinear_scaling_window_channels(input, output, increment_x, increment_y, 0, channels);
+
+    return output;
+}
+
+
+/* Scales a band of rows of an image of interleaved channels, the first output
+ * row at the y coordinate phase_y. Output holds the band output rows. */
+void bilinear_scaling_sw_band(image_t input, image_t output, float sx_float, float sy_float, uint16_t phase_y, uint32_t channels) {
+
+    /* Input image coordinates increments, the output dimensions are the band's. */
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width/channels, sx_float, sy_float, NULL, NULL, &increment_x, &increment_y);
+
+    bilinear_scaling_window_channels(input, output, increment_x, increment_y, phase_y, channels);
+}
+
+
+/* Scales the image with two engines at once. The first engine_rows output
+ * rows are started on the engine, the CPU scales the rest meanwhile and then
+ * waits for the engine to finish. */
+image_t bilinear_scaling_hybrid(image_t input, float sx_float, float sy_float, uint32_t channels, uint32_t engine_rows, band_engine_t engine) {
+
+    /* Output dimensions and input image coordinates increments, of the
+     * pixels rather than the bytes of a row. */
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width/channels, sx_float, sy_float, &out_height, &out_width, &increment_x, &increment_y);
+
+    /* Allocate output image memory, widths of the pixels of all channels. */
+    image_t output = image_alloc(out_height, out_width*channels);
+
+    /* Engine band first, CPU band second. */
+    band_t bands[2];
+    bilinear_scaling_split(input.height, output.height, increment_y, engine_rows, bands);
+
+    /* Band views of the images, output rows are written in place. Empty bands
+     * are skipped, their input rows may be past the end of the image. */
+    image_t band_in[2], band_out[2];
+    for (uint32_t i=0; i<2; i++) {
+        if (bands[i].out_height) {
+            band_in[i] = extract_segment(input, bands[i].in_start, 0, bands[i].in_height, input.width);
+            band_out[i] = extract_segment(output, bands[i].out_start, 0, bands[i].out_height, output.width);
+        }
+    }
+
+    if (bands[0].out_height) {
+        engine.start(band_in[0], band_out[0], sx_float, sy_float, bands[0].phase_y, engine.context);
+    }
+    if (bands[1].out_height) {
+        bilinear_scaling_sw_band(band_in[1], band_out[1], sx_float, sy_float, bands[1].phase_y, channels);
+    }
+    if (bands[0].out_height) {
+        engine.wait(engine.context);
+    }
+
+    for (uint32_t i=0; i<2; i++) {
+        if (bands[i].out_height) {
+            free(band_in[i].data);      /* Band views are shallow copies. */
+            free(band_out[i].data);
+        }
+    }
+
+    return output;
+}
+
+
+void bilinear_scaling_pan_init(pan_t* pan) {
+    pan->output.data = NULL;
+    pan->output.height = 0;
+    pan->output.width = 0;
+    pan->image[0] = '\0';
+    pan->reused = 0;
+    pan->computed = 0;
+}
+
+
+void bilinear_scaling_pan_free(pan_t* pan) {
+    if (pan->output.data) image_free(pan->output);
+    pan->output.data = NULL;
+    pan->image[0] = '\0';
+}
+
+
+/* Output pixels along one axis a pan of offset input pixels can reuse, output
+ * pixel i samples the input where pixel i + shift of the previous output did.
+ * This only holds if the offset is a whole number of increments. Pixels past
+ * the last input pixel, saturated at the segment end, are only reused if they
+ * are saturated in neither output. Reusable pixels are [*first, *end), there
+ * are none if *end is *first. */
+static void bilinear_scaling_reuse(int32_t offset, uint32_t in_size, uint32_t out_size, uint16_t increment, uint32_t* first, uint32_t* end, int32_t* shift) {
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    int64_t distance = (int64_t)offset*ONE_NFRAC;
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    int64_t last = (int64_t)(in_size - 1) << BILINEAR_SCALING_NFRAC;
+
+    *first = 0;
+    *end = 0;
+    *shift = 0;
+    if (distance % increment != 0) {
+        return;
+    }
+    *shift = distance/increment;
+
+    /* First saturated pixel, sampling past the last input pixel. */
+    int64_t saturated = last/increment + 1;
+    if (saturated > out_size) saturated = out_size;
+
+    int64_t lo = (*shift < 0) ? -*shift : 0;
+    int64_t hi = saturated;
+    if (hi > saturated - *shift) hi = saturated - *shift;
+    if (hi > (int64_t)out_size - *shift) hi = (int64_t)out_size - *shift;
+    if (hi > lo) {
+        *first = lo;
+        *end = hi;
+    }
+}
+
+
+/* Scales output rows [v_first, v_end) and columns [u_first, u_end) of the
+ * whole output of input. The input view runs to the end of input, so the
+ * same pixels saturate as scaling the whole output does. */
+static void bilinear_scaling_rect(image_t input, image_t output, uint16_t increment_x, uint16_t increment_y,
+        uint32_t v_first, uint32_t v_end, uint32_t u_first, uint32_t u_end) {
+    if (v_end <= v_first || u_end <= u_first) {
+        return;
+    }
+
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    uint32_t x = u_first*increment_x;
+    uint32_t y = v_first*increment_y;
+    uint32_t floor_x = GET_INT_UINT32_T(x, BILINEAR_SCALING_NFRAC);
+    uint32_t floor_y = GET_INT_UINT32_T(y, BILINEAR_SCALING_NFRAC);
+
+    image_t rect_in = extract_segment(input, floor_y, floor_x, input.height - floor_y, input.width - floor_x);
+    image_t rect_out = extract_segment(output, v_first, u_first, v_end - v_first, u_end - u_first);
+
+    bilinear_scaling_window(rect_in, rect_out, increment_x, increment_y,
+            GET_FRAC_UINT32_T(x, BILINEAR_SCALING_NFRAC), GET_FRAC_UINT32_T(y, BILINEAR_SCALING_NFRAC));
+
+    free(rect_in.data);     /* Views are shallow copies. */
+    free(rect_out.data);
+}
+
+
+/* Scales the segment of the image loaded from the file, the same as
+ * bilinear_scaling_sw does. If the previous job was a segment of the same
+ * file, size and scaling factors, panned by whole increments, the
+ * overlapping output is copied from its output and only the newly exposed
+ * strips are computed. Anything else is computed in full. The output is
+ * kept in pan for the next job. */
+image_t bilinear_scaling_pan(pan_t* pan, const char* filename, image_t image, uint32_t start_x, uint32_t start_y, uint32_t rows, uint32_t cols, float sx, float sy) {
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(rows, cols, sx, sy, &out_height, &out_width, &increment_x, &increment_y);
+
+    image_t input = extract_segment(image, start_x, start_y, rows, cols);
+    image_t output = image_alloc(out_height, out_width);
+
+    /* Reused rows and columns of the output. */
+    uint32_t v_first = 0, v_end = 0, u_first = 0, u_end = 0;
+    int32_t shift_v = 0, shift_u = 0;
+    if (pan->output.data != NULL && strcmp(pan->image, filename) == 0 &&
+        pan->rows == rows && pan->cols == cols &&
+        pan->increment_x == increment_x && pan->increment_y == increment_y) {
+        bilinear_scaling_reuse((int32_t)(start_x - pan->start_x), rows, out_height, increment_y, &v_first, &v_end, &shift_v);
+        bilinear_scaling_reuse((int32_t)(start_y - pan->start_y), cols, out_width, increment_x, &u_first, &u_end, &shift_u);
+    }
+
+    if (v_end > v_first && u_end > u_first) {
+        for (uint32_t v=v_first; v<v_end; v++) {
+            memcpy(&output.data[v][u_first], &pan->output.data[v + shift_v][u_first + shift_u], u_end - u_first);
+        }
+
+        /* Exposed rows above and below the reused ones, then the exposed
+         * columns left and right of them. */
+        bilinear_scaling_rect(input, output, increment_x, increment_y, 0, v_first, 0, out_width);
+        bilinear_scaling_rect(input, output, increment_x, increment_y, v_end, out_height, 0, out_width);
+        bilinear_scaling_rect(input, output, increment_x, increment_y, v_first, v_end, 0, u_first);
+        bilinear_scaling_rect(input, output, increment_x, increment_y, v_first, v_end, u_end, out_width);
+
+        pan->reused += (uint64_t)(v_end - v_first)*(u_end - u_first);
+        pan->computed += (uint64_t)out_height*out_width - (uint64_t)(v_end - v_first)*(u_end - u_first);
+    }
+    else {
+        bilinear_scaling_window(input, output, increment_x, increment_y, 0, 0);
+        pan->computed += (uint64_t)out_height*out_width;
+    }
+    free(input.data);     /* Segment is a shallow copy. */
+
+    /* Own copy of the output, the caller frees the returned one. */
+    if (pan->output.data == NULL || pan->output.height != out_height || pan->output.width != out_width) {
+        if (pan->output.data) image_free(pan->output);
+        pan->output = image_alloc(out_height, out_width);
+    }
+    for (uint32_t v=0; v<out_height; v++) {
+        memcpy(pan->output.data[v], output.data[v], out_width);
+    }
+    snprintf(pan->image, BILINEAR_SCALING_MAX_STRLEN, "%s", filename);
+    pan->start_x = start_x;
+    pan->start_y = start_y;
+    pan->rows = rows;
+    pan->cols = cols;
+    pan->increment_x = increment_x;
+    pan->increment_y = increment_y;
+
+    return output;
+}
+
+
+void bilinear_scaling_frames_init(frames_t* frames) {
+    frames->input.data = NULL;
+    frames->output.data = NULL;
+    frames->dirty = NULL;
+    frames->recomputed = 0;
+}
+
+
+void bilinear_scaling_frames_free(frames_t* frames) {
+    if (frames->input.data) image_free(frames->input);
+    if (frames->output.data) image_free(frames->output);
+    free(frames->dirty);
+    bilinear_scaling_frames_init(frames);
+}
+
+
+/* Output pixels along one axis depending on input pixels [first, last]. An
+ * output pixel samples the input pixel at its coordinate and the next one.
+ * Returns the pixels as [*out_first, *out_end). */
+static void bilinear_scaling_affected(uint32_t first, uint32_t last, uint32_t out_size, uint16_t increment, uint32_t* out_first, uint32_t* out_end) {
+    /* Fixed point representation (BILINEAR_SCALING_NINT, BILINEAR_SCALING_NFRAC) */
+    uint64_t low = (uint64_t)(first ? first - 1 : 0)*ONE_NFRAC;
+    uint64_t high = (uint64_t)(last + 1)*ONE_NFRAC;
+
+    uint64_t begin = (low + increment - 1)/increment;
+    uint64_t end = (high + increment - 1)/increment;
+    *out_first = (begin < out_size) ? begin : out_size;
+    *out_end = (end < out_size) ? end : out_size;
+}
+
+
+/* Scales the next frame of a sequence, the same as bilinear_scaling_sw does.
+ * Input tiles are compared with the previous frame, and only the output tiles
+ * depending on changed input tiles are recomputed, the rest of the output is
+ * kept. The first frame, and any frame of another size or scaling factors,
+ * is computed in full. The output belongs to frames and stays valid until
+ * the next frame. */
+image_t bilinear_scaling_frame(frames_t* frames, image_t input, float sx, float sy) {
+    uint32_t out_height, out_width;
+    uint16_t increment_x, increment_y;
+    bilinear_scaling_geometry(input.height, input.width, sx, sy, &out_height, &out_width, &increment_x, &increment_y);
+
+    const uint32_t tile = BILINEAR_SCALING_FRAME_TILE;
+    uint32_t tile_rows = (out_height + tile - 1)/tile;
+    uint32_t tile_cols = (out_width + tile - 1)/tile;
+
+    if (frames->output.data == NULL ||
+        frames->input.height != input.height || frames->input.width != input.width ||
+        frames->increment_x != increment_x || frames->increment_y != increment_y ||
+        frames->output.height != out_height || frames->output.width != out_width) {
+        bilinear_scaling_frames_free(frames);
+
+        frames->input = image_alloc(input.height, input.width);
+        for (uint32_t v=0; v<input.height; v++) {
+            memcpy(frames->input.data[v], input.data[v], input.width);
+        }
+        frames->output = image_alloc(out_height, out_width);
+        frames->increment_x = increment_x;
+        frames->increment_y = increment_y;
+        frames->dirty = malloc(tile_rows*tile_cols + 1);
+        assert(frames->dirty != NULL);
+
+        bilinear_scaling_window(frames->input, frames->output, increment_x, increment_y, 0, 0);
+        frames->recomputed = (uint64_t)out_height*out_width;
+        return frames->output;
+    }
+
+    memset(frames->dirty, 0, tile_rows*tile_cols);
+
+    for (uint32_t in_v=0; in_v<input.height; in_v+=tile) {
+        uint32_t in_v_end = (in_v + tile < input.height) ? in_v + tile : input.height;
+
+        for (uint32_t in_u=0; in_u<input.width; in_u+=tile) {
+            uint32_t in_u_end = (in_u + tile < input.width) ? in_u + tile : input.width;
+
+            /* Rows of the tile are compared with memcmp, vectorized by the C library. */
+            uint32_t v = in_v;
+            while (v < in_v_end && memcmp(&frames->input.data[v][in_u], &input.data[v][in_u], in_u_end - in_u) == 0) {
+                v++;
+            }
+            if (v == in_v_end) {
+                continue;
+            }
+            for (; v<in_v_end; v++) {
+                memcpy(&frames->input.data[v][in_u], &input.data[v][in_u], in_u_end - in_u);
+            }
+
+            uint32_t out_v, out_v_end, out_u, out_u_end;
+            bilinear_scaling_affected(in_v, in_v_end - 1, out_height, increment_y, &out_v, &out_v_end);
+            bilinear_scaling_affected(in_u, in_u_end - 1, out_width, increment_x, &out_u, &out_u_end);
+            if (out_v == out_v_end || out_u == out_u_end) {
+                continue;
+            }
+            for (uint32_t ty=out_v/tile; ty<=(out_v_end - 1)/tile; ty++) {
+                memset(&frames->dirty[ty*tile_cols + out_u/tile], 1, (out_u_end - 1)/tile - out_u/tile + 1);
+            }
+        }
+    }
+
+    /* Runs of dirty tiles in a row of tiles are scaled together. */
+    frames->recomputed = 0;
+    for (uint32_t ty=0; ty<tile_rows; ty++) {
+        uint32_t v = ty*tile;
+        uint32_t v_end = (v + tile < out_height) ? v + tile : out_height;
+        uint32_t tx = 0;
+
+        while (tx < tile_cols) {
+            if (!frames->dirty[ty*tile_cols + tx]) {
+                tx++;
+                continue;
+            }
+            uint32_t run = tx;
+            while (tx < tile_cols && frames->dirty[ty*tile_cols + tx]) {
+                tx++;
+            }
+            uint32_t u = run*tile;
+            uint32_t u_end = (tx*tile < out_width) ? tx*tile : out_width;
+
+            bilinear_scaling_rect(frames->input, frames->output, increment_x, increment_y, v, v_end, u, u_end);
+            frames->recomputed += (uint64_t)(v_end - v)*(u_end - u);
+        }
+    }
+
+    return frames->output;
+}
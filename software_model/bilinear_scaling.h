@@ -16,6 +16,102 @@
 #define GET_FRAC_UINT32_T(x, nfrac) ((uint32_t)x & (uint32_t)((1 << nfrac) - 1))
 #define GET_INT_UINT32_T(x, nfrac) ((uint32_t)x & (UINT32_MAX & ~((uint32_t)((1 << nfrac) - 1)))) >> nfrac
 
+/* Maximum input row length held by the accelerator line buffers. */
+#define BILINEAR_SCALING_MAX_WIDTH (4096)
+
+/* Maximum length of the image filename kept by a pan. */
+#define BILINEAR_SCALING_MAX_STRLEN (255)
+
+/* Side of the square input tiles compared between frames, and of the output
+ * tiles recomputed, in pixels. */
+#define BILINEAR_SCALING_FRAME_TILE (32)
+
+/* Vertical strip of an image processed on its own in strip mode. */
+typedef struct {
+    uint32_t in_start;      /* First input column. */
+    uint32_t in_width;      /* Number of input columns. */
+    uint32_t out_start;     /* First output column. */
+    uint32_t out_width;     /* Number of output columns. */
+    uint16_t phase_x;       /* Starting x coordinate relative to in_start. */
+} strip_t;
+
+/* Band of rows of an image processed by a single accelerator lane. */
+typedef struct {
+    uint32_t in_start;      /* First input row. */
+    uint32_t in_height;     /* Number of input rows. */
+    uint32_t out_start;     /* First output row. */
+    uint32_t out_height;    /* Number of output rows. */
+    uint16_t phase_y;       /* Starting y coordinate relative to in_start. */
+} band_t;
+
+/* Previous job of a viewport panning over an image, parts of its output are
+ * reused by the next job at the same size and scaling factors. */
+typedef struct {
+    image_t output;         /* Output of the previous job, empty before the first one. */
+    char image[BILINEAR_SCALING_MAX_STRLEN];    /* File of the image the previous segment was taken from. */
+    uint32_t start_x;       /* First row of the previous segment. */
+    uint32_t start_y;       /* First column of the previous segment. */
+    uint32_t rows, cols;
+    uint16_t increment_x, increment_y;
+    uint64_t reused;        /* Output pixels copied from previous jobs... */
+    uint64_t computed;      /* ...and computed, over all jobs. */
+} pan_t;
+
+/* Previous frame of a sequence, only the output tiles depending on input
+ * tiles changed since are recomputed for the next frame. */
+typedef struct {
+    image_t input;          /* Copy of the previous frame. */
+    image_t output;         /* Output of the previous frame, updated in place. */
+    uint16_t increment_x, increment_y;
+    uint8_t* dirty;         /* Output tiles to recompute, one per tile. */
+    uint64_t recomputed;    /* Output pixels recomputed for the last frame. */
+} frames_t;
+
+/* Engine scaling a band of rows in the background, started with the band
+ * input and output views and the y coordinate of the first output row. */
+typedef struct {
+    void (*start)(image_t input, image_t output, float sx, float sy, uint16_t phase_y, void* context);
+    void (*wait)(void* context);
+    void* context;
+} band_engine_t;
+
 image_t bilinear_scaling_sw(image_t input, float sx, float sy);
 
+void bilinear_scaling_geometry(uint32_t in_height, uint32_t in_width, float sx, float sy,
+        uint32_t* out_height, uint32_t* out_width, uint16_t* increment_x, uint16_t* increment_y);
+
+void bilinear_scaling_window(image_t input, image_t output, uint16_t increment_x, uint16_t increment_y, uint16_t phase_x, uint16_t phase_y);
+
+uint32_t bilinear_scaling_strips(uint32_t in_width, uint32_t out_width, uint16_t increment_x, uint32_t max_width, strip_t* strips);
+
+image_t bilinear_scaling_sw_strips(image_t input, float sx, float sy, uint32_t max_width);
+
+void bilinear_scaling_bands(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint16_t phase_y, uint32_t count, band_t* bands);
+
+void bilinear_scaling_split(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint32_t first_rows, band_t* bands);
+
+uint32_t bilinear_scaling_split_rows(uint32_t out_height, uint64_t engine_time, uint64_t cpu_time);
+
+image_t bilinear_scaling_sw_bands(image_t input, float sx, float sy, uint32_t count);
+
+uint32_t bilinear_scaling_rows(uint32_t in_height, uint32_t out_height, uint16_t increment_y, uint16_t phase_y, uint16_t* rows);
+
+image_t bilinear_scaling_sw_rows(image_t input, float sx, float sy);
+
+image_t bilinear_scaling_sw_channels(image_t input, float sx, float sy, uint32_t channels);
+
+void bilinear_scaling_sw_band(image_t input, image_t output, float sx, float sy, uint16_t phase_y, uint32_t channels);
+
+image_t bilinear_scaling_hybrid(image_t input, float sx, float sy, uint32_t channels, uint32_t engine_rows, band_engine_t engine);
+
+void bilinear_scaling_pan_init(pan_t* pan);
+void bilinear_scaling_pan_free(pan_t* pan);
+
+image_t bilinear_scaling_pan(pan_t* pan, const char* filename, image_t image, uint32_t start_x, uint32_t start_y, uint32_t rows, uint32_t cols, float sx, float sy);
+
+void bilinear_scaling_frames_init(frames_t* frames);
+void bilinear_scaling_frames_free(frames_t* frames);
+
+image_t bilinear_scaling_frame(frames_t* frames, image_t input, float sx, float sy);
+
 #endif
@@ -0,0 +1,299 @@
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bilinear_scaling.h"
+#include "cache.h"
+#include "utils.h"
+
+/* Offset of the first output pixel in an entry file, after the width and
+ * height. The check hash of the input follows the output pixels. */
+#define HEADER_SIZE (2*DIM_BYTE_COUNT)
+#define CHECK_SIZE  (sizeof(uint64_t))
+
+/* 64-bit FNV prime and offset basis. */
+#define HASH_PRIME  (0x100000001b3ull)
+#define HASH_BASIS  (0xcbf29ce484222325ull)
+
+/* xxHash64 primes, for the check hash. */
+#define CHECK_PRIME_1   (0x9e3779b185ebca87ull)
+#define CHECK_PRIME_2   (0xc2b2ae3d27d4eb4full)
+#define CHECK_PRIME_3   (0x165667b19e3779f9ull)
+#define CHECK_PRIME_5   (0x27d4eb2f165667c5ull)
+
+#define ROTATE_LEFT(x, r)   (((x) << (r)) | ((x) >> (64 - (r))))
+
+/* Cache file with the time it was last used, for eviction. */
+typedef struct {
+    char filename[2*CACHE_MAX_STRLEN];
+    uint64_t bytes;
+    struct timespec used;
+} entry_t;
+
+
+static int used_earlier(const void* a, const void* b) {
+    const struct timespec* used_a = &((const entry_t*) a)->used;
+    const struct timespec* used_b = &((const entry_t*) b)->used;
+    if (used_a->tv_sec != used_b->tv_sec) {
+        return (used_a->tv_sec > used_b->tv_sec) - (used_a->tv_sec < used_b->tv_sec);
+    }
+    return (used_a->tv_nsec > used_b->tv_nsec) - (used_a->tv_nsec < used_b->tv_nsec);
+}
+
+
+static int entry_filename(char* filename, const cache_t* cache, cache_key_t key) {
+    return snprintf(filename, 2*CACHE_MAX_STRLEN, "%s/%016llx_%ux%u_%02x_%02x.bin", cache->directory,
+            (unsigned long long)key.hash, key.height, key.width, key.sx, key.sy) >= 2*CACHE_MAX_STRLEN ? -1 : 0;
+}
+
+
+/* Deletes the least recently used files until the rest take at most limit
+ * bytes, and takes their size as the byte total. Files being written by a
+ * store are left alone. */
+static void trim(cache_t* cache, uint64_t limit, int count_evictions) {
+    DIR* dir = opendir(cache->directory);
+    uint32_t count = 0;
+    uint32_t capacity = 16;
+    uint64_t total = 0;
+
+    if (dir == NULL) {
+        return;
+    }
+    entry_t* entries = malloc(capacity*sizeof(entry_t));
+    assert(entries != NULL);
+
+    struct dirent* file;
+    while ((file = readdir(dir)) != NULL) {
+        size_t length = strlen(file->d_name);
+        if (length < 4 || strcmp(file->d_name + length - 4, ".bin") != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity*sizeof(entry_t));
+            assert(entries != NULL);
+        }
+
+        entry_t* entry = &entries[count];
+        struct stat status;
+        if (snprintf(entry->filename, 2*CACHE_MAX_STRLEN, "%s/%s", cache->directory, file->d_name) >= 2*CACHE_MAX_STRLEN ||
+            stat(entry->filename, &status) != 0) {
+            continue;
+        }
+        entry->bytes = status.st_size;
+        entry->used = status.st_mtim;
+        total += entry->bytes;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > limit) {
+        qsort(entries, count, sizeof(entry_t), &used_earlier);
+        for (uint32_t i=0; i<count && total > limit; i++) {
+            /* Another process may have evicted it already. */
+            if (unlink(entries[i].filename) == 0 && count_evictions) {
+                cache->stats.evictions++;
+            }
+            total -= entries[i].bytes;
+        }
+    }
+    cache->bytes = total;
+
+    free(entries);
+}
+
+
+/* Writes the output as a bin image followed by the check hash of its input. */
+static int save_entry(const char* filename, cache_key_t key, image_t output) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fwrite(&output.width, sizeof(uint32_t), 1, file);
+    fwrite(&output.height, sizeof(uint32_t), 1, file);
+    for (uint32_t v=0; v<output.height; v++) {
+        fwrite(output.data[v], 1, output.width, file);
+    }
+    fwrite(&key.check, CHECK_SIZE, 1, file);
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+
+/* Uses the directory, made unless it exists, for the cache. Outputs stored
+ * by earlier runs are kept, as far as the limit allows. */
+int cache_init(cache_t* cache, const char* directory, uint64_t limit) {
+    snprintf(cache->directory, CACHE_MAX_STRLEN, "%s", directory);
+    cache->limit = limit;
+    cache->bytes = 0;
+    memset(&cache->stats, 0, sizeof(cache->stats));
+
+    mkdir(directory, 0777);
+    if (access(directory, W_OK) != 0) {
+        return -1;
+    }
+    trim(cache, limit, 0);
+    return 0;
+}
+
+
+/* Deletes all outputs of the cache. */
+void cache_clear(cache_t* cache) {
+    trim(cache, 0, 0);
+}
+
+
+/* Key of the output of the segment. The pixels are hashed a word at a time,
+ * FNV-1a style with the high half folded down after each multiply, so every
+ * input bit reaches the low bits of the hash. The check hash is taken in the
+ * same pass with xxHash64 rounds, independent of the first, and the two make
+ * a 128-bit digest of the pixels. */
+cache_key_t cache_key(image_t segment, float sx, float sy) {
+    cache_key_t key = {
+        .hash = HASH_BASIS,
+        .check = CHECK_PRIME_5,
+        .height = segment.height,
+        .width = segment.width,
+        .sx = to_fixed_point(sx, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC),
+        .sy = to_fixed_point(sy, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC)
+    };
+
+    for (uint32_t v=0; v<segment.height; v++) {
+        const uint8_t* row = segment.data[v];
+        uint32_t u = 0;
+        for (; u + sizeof(uint64_t) <= segment.width; u += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, row + u, sizeof(word));
+            key.hash = (key.hash ^ word)*HASH_PRIME;
+            key.hash ^= key.hash >> 32;
+            key.check += word*CHECK_PRIME_2;
+            key.check = ROTATE_LEFT(key.check, 31)*CHECK_PRIME_1;
+        }
+        for (; u<segment.width; u++) {
+            key.hash = (key.hash ^ row[u])*HASH_PRIME;
+            key.check ^= row[u]*CHECK_PRIME_5;
+            key.check = ROTATE_LEFT(key.check, 11)*CHECK_PRIME_1;
+        }
+    }
+
+    /* Final avalanche of xxHash64. */
+    key.check ^= key.check >> 33;
+    key.check *= CHECK_PRIME_2;
+    key.check ^= key.check >> 29;
+    key.check *= CHECK_PRIME_3;
+    key.check ^= key.check >> 32;
+
+    return key;
+}
+
+
+/* Maps the stored output of the key, returns 1 on a hit. The entry only
+ * hits if its check hash is the one of the key too, so inputs whose first
+ * hashes collide don't share an output. Output rows are read from the file
+ * mapping, copied only once written to, and the output has to be released
+ * with cache_release. */
+int cache_lookup(cache_t* cache, cache_key_t key, image_t* output) {
+    char filename[2*CACHE_MAX_STRLEN];
+    struct stat status;
+    uint32_t header[2];
+    uint64_t check;
+
+    int file = (entry_filename(filename, cache, key) == 0) ? open(filename, O_RDONLY) : -1;
+    if (file < 0 || fstat(file, &status) != 0 ||
+        pread(file, header, HEADER_SIZE, 0) != HEADER_SIZE || header[0] == 0 || header[1] == 0) {
+        if (file >= 0) close(file);
+        cache->stats.misses++;
+        return 0;
+    }
+
+    uint64_t bytes = HEADER_SIZE + (uint64_t)header[0]*header[1];
+    if (bytes + CHECK_SIZE != status.st_size ||
+        pread(file, &check, CHECK_SIZE, bytes) != CHECK_SIZE || check != key.check) {
+        close(file);
+        cache->stats.misses++;
+        return 0;
+    }
+
+    uint8_t* mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        cache->stats.misses++;
+        return 0;
+    }
+
+    output->width = header[0];
+    output->height = header[1];
+    output->data = malloc(output->height*sizeof(uint8_t*));
+    assert(output->data != NULL);
+    for (uint32_t v=0; v<output->height; v++) {
+        output->data[v] = mapping + HEADER_SIZE + (size_t)v*output->width;
+    }
+
+    /* Used now, last to be evicted. */
+    utimensat(AT_FDCWD, filename, NULL, 0);
+    cache->stats.hits++;
+    return 1;
+}
+
+
+void cache_release(image_t output) {
+    munmap(output.data[0] - HEADER_SIZE, HEADER_SIZE + (size_t)output.height*output.width);
+    free(output.data);
+}
+
+
+/* Stores the output of the key, evicting older outputs once the byte total
+ * passes the limit. The total only counts the stores of this process
+ * between scans, so the directory is scanned again then. Empty outputs and
+ * entries over the limit on their own aren't stored. */
+void cache_store(cache_t* cache, cache_key_t key, image_t output) {
+    char filename[2*CACHE_MAX_STRLEN];
+    char temporary[3*CACHE_MAX_STRLEN];
+    struct stat status;
+    uint64_t bytes = HEADER_SIZE + (uint64_t)output.height*output.width + CHECK_SIZE;
+    uint64_t replaced = 0;
+
+    if (output.height == 0 || output.width == 0 || bytes > cache->limit ||
+        entry_filename(filename, cache, key) != 0) {
+        return;
+    }
+
+    /* Written under a temporary name and renamed once complete, lookups of
+     * other processes never see a partial file. */
+    sprintf(temporary, "%s.tmp.%d", filename, (int)getpid());
+    if (save_entry(temporary, key, output) != 0) {
+        remove(temporary);
+        return;
+    }
+    /* An entry of the same key is replaced, its bytes leave the total. */
+    if (stat(filename, &status) == 0) {
+        replaced = status.st_size;
+    }
+    if (rename(temporary, filename) != 0) {
+        remove(temporary);
+        return;
+    }
+    cache->stats.stores++;
+    cache->bytes = cache->bytes + bytes - (cache->bytes >= replaced ? replaced : cache->bytes);
+
+    if (cache->bytes > cache->limit) {
+        trim(cache, cache->limit, 1);
+    }
+}
+
+
+void cache_print_stats(cache_stats_t stats) {
+    uint64_t lookups = stats.hits + stats.misses;
+    printf("Result cache: %llu hits, %llu misses, %.1f%% hit rate, %llu stores, %llu evictions\n",
+            (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+            lookups ? 100.0*stats.hits/lookups : 0.0,
+            (unsigned long long)stats.stores, (unsigned long long)stats.evictions);
+}
@@ -0,0 +1,49 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdint.h>
+
+#include "utils.h"
+
+#define CACHE_MAX_STRLEN    (255)
+
+/* Identifies an output, the scaling factors are their fixed point codes, so
+ * factors quantized to the same code share the entry. */
+typedef struct {
+    uint64_t hash;                  /* Of the input segment pixels, names the entry... */
+    uint64_t check;                 /* ...and an independent one, confirms a hit. */
+    uint32_t height, width;         /* Of the input segment. */
+    uint8_t sx, sy;
+} cache_key_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+} cache_stats_t;
+
+/* Outputs kept as bin images in a directory, one file per key, each
+ * followed by the check hash of its input segment so a hit isn't trusted to
+ * the hash naming the file alone. Files are complete once visible, so
+ * several processes may share the directory. The least recently
+ * used outputs are deleted once the files take more than the limit. */
+typedef struct {
+    char directory[CACHE_MAX_STRLEN];
+    uint64_t limit;                 /* Bytes of the files kept. */
+    uint64_t bytes;                 /* Of the files, as of the last scan plus the stores since. */
+    cache_stats_t stats;
+} cache_t;
+
+int cache_init(cache_t* cache, const char* directory, uint64_t limit);
+void cache_clear(cache_t* cache);
+
+cache_key_t cache_key(image_t segment, float sx, float sy);
+
+int cache_lookup(cache_t* cache, cache_key_t key, image_t* output);
+void cache_release(image_t output);
+void cache_store(cache_t* cache, cache_key_t key, image_t output);
+
+void cache_print_stats(cache_stats_t stats);
+
+#endif
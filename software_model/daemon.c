@@ -0,0 +1,594 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bilinear_scaling.h"
+#include "daemon.h"
+#include "registry.h"
+#include "utils.h"
+
+/* Seals of the shared memory passed between client and daemon, the size and
+ * the pixels can't change once sent, so mapping it can't fault. */
+#define SHARED_SEALS    (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+/* Request being computed, identical requests arriving meanwhile wait for
+ * its output instead of computing it again. */
+typedef struct flight {
+    daemon_request_t request;
+    int32_t status;
+    int output;                 /* Shared memory of the output. */
+    uint32_t height, width;
+    int done;
+    uint32_t holders;           /* Requests still to be answered with the output. */
+    pthread_cond_t finished;
+    struct flight* next;
+} flight_t;
+
+typedef struct {
+    int listener;
+    int wake[2];                /* Written on a stop request, ends the accept loop. */
+    pthread_mutex_t lock;       /* Guards the flights, counters and active. */
+    pthread_mutex_t images_lock;
+    pthread_cond_t idle;
+    uint32_t active;            /* Connections being served. */
+    registry_t images;          /* Images named in requests, kept loaded within the budget. */
+    flight_t* flights;
+    uint64_t requests, computed, coalesced;
+} daemon_t;
+
+typedef struct {
+    daemon_t* daemon;
+    int connection;
+} client_t;
+
+
+/* Sends a message, with a file descriptor attached unless fd is negative. */
+static int send_message(int connection, const void* data, size_t size, int fd) {
+    struct iovec iov = { .iov_base = (void*) data, .iov_len = size };
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    if (fd >= 0) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(header), &fd, sizeof(int));
+    }
+
+    return sendmsg(connection, &message, MSG_NOSIGNAL) == size ? 0 : -1;
+}
+
+
+/* Receives a message of the given size, fd is the attached file descriptor or
+ * -1 if there is none. */
+static int receive_message(int connection, void* data, size_t size, int* fd) {
+    struct iovec iov = { .iov_base = data, .iov_len = size };
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+
+    *fd = -1;
+    ssize_t received = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+    for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            memcpy(fd, CMSG_DATA(header), sizeof(int));
+        }
+    }
+
+    return received == size ? 0 : -1;
+}
+
+
+/* Image with its rows in a shared memory mapping of height*width pixels. */
+static image_t map_image(uint8_t* pixels, uint32_t height, uint32_t width) {
+    image_t image = {
+        .data = malloc((height + 1)*sizeof(uint8_t*)),
+        .height = height,
+        .width = width
+    };
+    assert(image.data != NULL);
+
+    for (uint32_t v=0; v<height; v++) {
+        image.data[v] = pixels + (size_t)v*width;
+    }
+    return image;
+}
+
+
+/* Scales the segment of the request into a new shared memory. The segment is
+ * taken the same way the main application takes it. */
+static int32_t scale_segment(image_t image, const daemon_request_t* request, int* output, uint32_t* height, uint32_t* width) {
+    uint32_t seg_width = request->dr_x - request->ul_x + 1;
+    uint32_t seg_height = request->dr_y - request->ul_y + 1;
+    uint16_t increment_x, increment_y;
+
+    if (request->dr_x <= request->ul_x || request->dr_y <= request->ul_y ||
+        (uint64_t)request->ul_x + seg_height > image.height || (uint64_t)request->ul_y + seg_width > image.width ||
+        !(request->sx > 0) || !(request->sy > 0)) {
+        return DAEMON_BAD_REQUEST;
+    }
+    bilinear_scaling_geometry(seg_height, seg_width, request->sx, request->sy, height, width, &increment_x, &increment_y);
+
+    size_t size = (size_t)*height * *width;
+    *output = memfd_create("bilinear_scaling_output", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (*output < 0 || ftruncate(*output, size) != 0) {
+        if (*output >= 0) close(*output);
+        *output = -1;
+        return DAEMON_NO_MEMORY;
+    }
+    if (size == 0) {
+        return fcntl(*output, F_ADD_SEALS, SHARED_SEALS) == 0 ? DAEMON_OK : DAEMON_NO_MEMORY;
+    }
+
+    uint8_t* pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *output, 0);
+    if (pixels == MAP_FAILED) {
+        close(*output);
+        *output = -1;
+        return DAEMON_NO_MEMORY;
+    }
+
+    /* Output rows are written straight into the memory the client maps. */
+    image_t segment = extract_segment(image, request->ul_x, request->ul_y, seg_height, seg_width);
+    image_t scaled = map_image(pixels, *height, *width);
+    bilinear_scaling_window(segment, scaled, increment_x, increment_y, 0, 0);
+    free(segment.data);     /* Segment is a shallow copy. */
+    free(scaled.data);
+    munmap(pixels, size);
+
+    /* Clients sharing the output can't truncate it under each other. */
+    if (fcntl(*output, F_ADD_SEALS, SHARED_SEALS) != 0) {
+        close(*output);
+        *output = -1;
+        return DAEMON_NO_MEMORY;
+    }
+
+    return DAEMON_OK;
+}
+
+
+/* Image of the file from the registry, loaded unless it is resident. The
+ * image has to be released once scaled. */
+static image_t acquire_image(daemon_t* daemon, const char* filename) {
+    image_t image = { .data = NULL, .height = 0, .width = 0 };
+
+    pthread_mutex_lock(&daemon->images_lock);
+    /* bin2image asserts on a missing file, a bad request mustn't stop the daemon. */
+    if (access(filename, R_OK) == 0) {
+        image = registry_acquire(&daemon->images, filename);
+    }
+    pthread_mutex_unlock(&daemon->images_lock);
+
+    return image;
+}
+
+
+static void release_image(daemon_t* daemon, image_t image) {
+    pthread_mutex_lock(&daemon->images_lock);
+    registry_release(&daemon->images, image);
+    pthread_mutex_unlock(&daemon->images_lock);
+}
+
+
+/* Requests are the same if they scale the same segment with the same
+ * geometry, factors quantized to the same fixed point codes give the same
+ * output. */
+static int same_request(const daemon_request_t* a, const daemon_request_t* b) {
+    if (strcmp(a->input_filename, b->input_filename) != 0 ||
+        a->ul_x != b->ul_x || a->ul_y != b->ul_y || a->dr_x != b->dr_x || a->dr_y != b->dr_y ||
+        (a->sx > 0) != (b->sx > 0) || (a->sy > 0) != (b->sy > 0)) {
+        return 0;
+    }
+
+    uint32_t seg_width = a->dr_x - a->ul_x + 1;
+    uint32_t seg_height = a->dr_y - a->ul_y + 1;
+    uint32_t height_a, width_a, height_b, width_b;
+    uint16_t increment_x_a, increment_y_a, increment_x_b, increment_y_b;
+    bilinear_scaling_geometry(seg_height, seg_width, a->sx, a->sy, &height_a, &width_a, &increment_x_a, &increment_y_a);
+    bilinear_scaling_geometry(seg_height, seg_width, b->sx, b->sy, &height_b, &width_b, &increment_x_b, &increment_y_b);
+
+    return height_a == height_b && width_a == width_b &&
+           increment_x_a == increment_x_b && increment_y_a == increment_y_b;
+}
+
+
+/* Output of a request naming an image. If an identical request is being
+ * computed its output is shared, otherwise the request is computed and
+ * shared with the identical ones arriving meanwhile. The flight has to be
+ * left once the reply is sent. */
+static flight_t* join_flight(daemon_t* daemon, const daemon_request_t* request, daemon_reply_t* reply) {
+    flight_t* flight;
+
+    pthread_mutex_lock(&daemon->lock);
+    for (flight = daemon->flights; flight != NULL; flight = flight->next) {
+        if (same_request(&flight->request, request)) {
+            break;
+        }
+    }
+
+    if (flight != NULL) {
+        flight->holders++;
+        daemon->coalesced++;
+        while (!flight->done) {
+            pthread_cond_wait(&flight->finished, &daemon->lock);
+        }
+        reply->shared = 1;
+    }
+    else {
+        flight = malloc(sizeof(flight_t));
+        assert(flight != NULL);
+        flight->request = *request;
+        flight->output = -1;
+        flight->height = 0;
+        flight->width = 0;
+        flight->done = 0;
+        flight->holders = 1;
+        pthread_cond_init(&flight->finished, NULL);
+        flight->next = daemon->flights;
+        daemon->flights = flight;
+        daemon->computed++;
+        pthread_mutex_unlock(&daemon->lock);
+
+        image_t image = acquire_image(daemon, request->input_filename);
+        if (image.data != NULL) {
+            flight->status = scale_segment(image, request, &flight->output, &flight->height, &flight->width);
+            release_image(daemon, image);
+        }
+        else {
+            flight->status = DAEMON_NO_IMAGE;
+        }
+
+        /* Requests arriving from now on compute the output again. */
+        pthread_mutex_lock(&daemon->lock);
+        flight_t** link = &daemon->flights;
+        while (*link != flight) {
+            link = &(*link)->next;
+        }
+        *link = flight->next;
+        flight->done = 1;
+        pthread_cond_broadcast(&flight->finished);
+        reply->shared = flight->holders > 1;
+    }
+
+    reply->status = flight->status;
+    reply->height = flight->height;
+    reply->width = flight->width;
+    pthread_mutex_unlock(&daemon->lock);
+
+    return flight;
+}
+
+
+/* The last request answered closes the output. */
+static void leave_flight(daemon_t* daemon, flight_t* flight) {
+    pthread_mutex_lock(&daemon->lock);
+    uint32_t holders = --flight->holders;
+    pthread_mutex_unlock(&daemon->lock);
+
+    if (holders == 0) {
+        if (flight->output >= 0) close(flight->output);
+        pthread_cond_destroy(&flight->finished);
+        free(flight);
+    }
+}
+
+
+/* Output of a request with the input pixels in shared memory. The memory
+ * must be sealed against shrinking and writes, otherwise the client could
+ * truncate it while mapped and fault the daemon. */
+static int32_t scale_shared(const daemon_request_t* request, int input, int* output, daemon_reply_t* reply) {
+    size_t size = (size_t)request->in_height*request->in_width;
+    struct stat status;
+
+    if (input < 0 || size == 0) {
+        return DAEMON_BAD_REQUEST;
+    }
+    int seals = fcntl(input, F_GET_SEALS);
+    if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE) ||
+        fstat(input, &status) != 0 || (size_t)status.st_size < size) {
+        return DAEMON_BAD_REQUEST;
+    }
+    uint8_t* pixels = mmap(NULL, size, PROT_READ, MAP_SHARED, input, 0);
+    if (pixels == MAP_FAILED) {
+        return DAEMON_BAD_REQUEST;
+    }
+
+    /* Input is only read, never written. */
+    image_t image = map_image(pixels, request->in_height, request->in_width);
+    int32_t result = scale_segment(image, request, output, &reply->height, &reply->width);
+    free(image.data);
+    munmap(pixels, size);
+
+    return result;
+}
+
+
+static void* serve_client(void* context) {
+    client_t* client = (client_t*) context;
+    daemon_t* daemon = client->daemon;
+    daemon_request_t request;
+    daemon_reply_t reply = { .status = DAEMON_BAD_REQUEST, .height = 0, .width = 0, .shared = 0 };
+    flight_t* flight = NULL;
+    int input, output = -1;
+
+    if (receive_message(client->connection, &request, sizeof(request), &input) == 0) {
+        request.input_filename[DAEMON_MAX_STRLEN - 1] = '\0';
+
+        if (!request.stop) {
+            pthread_mutex_lock(&daemon->lock);
+            daemon->requests++;
+            pthread_mutex_unlock(&daemon->lock);
+        }
+
+        if (request.stop) {
+            reply.status = (write(daemon->wake[1], "", 1) == 1) ? DAEMON_OK : DAEMON_BAD_REQUEST;
+        }
+        else if (request.input_filename[0] == '\0') {
+            reply.status = scale_shared(&request, input, &output, &reply);
+        }
+        else {
+            flight = join_flight(daemon, &request, &reply);
+            output = flight->output;
+        }
+    }
+
+    send_message(client->connection, &reply, sizeof(reply), reply.status == DAEMON_OK ? output : -1);
+
+    if (flight != NULL) {
+        leave_flight(daemon, flight);
+    }
+    else if (output >= 0) {
+        close(output);
+    }
+    if (input >= 0) close(input);
+    close(client->connection);
+    free(client);
+
+    pthread_mutex_lock(&daemon->lock);
+    if (--daemon->active == 0) {
+        pthread_cond_broadcast(&daemon->idle);
+    }
+    pthread_mutex_unlock(&daemon->lock);
+
+    return NULL;
+}
+
+
+/* Makes the listening socket of the daemon, a stale socket file left by a
+ * previous daemon is replaced. Returns the socket or -1. */
+int daemon_listen(const char* socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        printf("Socket path %s is too long.\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    unlink(socket_path);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+        listen(listener, DAEMON_BACKLOG) != 0) {
+        printf("Can't listen on %s.\n", socket_path);
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+
+/* Serves requests on the socket, every connection on its own thread, until a
+ * stop request. Named images stay loaded as long as they fit the budget.
+ * Requests being served are finished first, then the images are dropped and
+ * the socket file removed. */
+int daemon_serve(int listener, uint64_t budget, daemon_stats_t* stats) {
+    daemon_t daemon = {
+        .listener = listener,
+        .active = 0,
+        .flights = NULL,
+        .requests = 0,
+        .computed = 0,
+        .coalesced = 0
+    };
+
+    if (listener < 0 || pipe(daemon.wake) != 0) {
+        return -1;
+    }
+    pthread_mutex_init(&daemon.lock, NULL);
+    pthread_mutex_init(&daemon.images_lock, NULL);
+    registry_init(&daemon.images, budget);
+    pthread_cond_init(&daemon.idle, NULL);
+
+    for (;;) {
+        struct pollfd events[2] = {
+            { .fd = listener, .events = POLLIN },
+            { .fd = daemon.wake[0], .events = POLLIN }
+        };
+        if (poll(events, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (events[1].revents) {
+            break;
+        }
+
+        int connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if (connection < 0) {
+            continue;
+        }
+
+        client_t* client = malloc(sizeof(client_t));
+        assert(client != NULL);
+        client->daemon = &daemon;
+        client->connection = connection;
+
+        pthread_mutex_lock(&daemon.lock);
+        daemon.active++;
+        pthread_mutex_unlock(&daemon.lock);
+
+        pthread_t thread;
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attributes, &serve_client, client) != 0) {
+            close(connection);
+            free(client);
+            pthread_mutex_lock(&daemon.lock);
+            daemon.active--;
+            pthread_mutex_unlock(&daemon.lock);
+        }
+        pthread_attr_destroy(&attributes);
+    }
+
+    pthread_mutex_lock(&daemon.lock);
+    while (daemon.active > 0) {
+        pthread_cond_wait(&daemon.idle, &daemon.lock);
+    }
+    pthread_mutex_unlock(&daemon.lock);
+
+    stats->requests = daemon.requests;
+    stats->computed = daemon.computed;
+    stats->coalesced = daemon.coalesced;
+    stats->images = daemon.images.stats;
+    registry_free(&daemon.images);
+
+    struct sockaddr_un address;
+    socklen_t length = sizeof(address);
+    if (getsockname(listener, (struct sockaddr*) &address, &length) == 0 && address.sun_path[0] != '\0') {
+        unlink(address.sun_path);
+    }
+    close(listener);
+    close(daemon.wake[0]);
+    close(daemon.wake[1]);
+    pthread_cond_destroy(&daemon.idle);
+    pthread_mutex_destroy(&daemon.images_lock);
+    pthread_mutex_destroy(&daemon.lock);
+
+    return 0;
+}
+
+
+static int connect_daemon(const char* socket_path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (connection >= 0 && connect(connection, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        close(connection);
+        return -1;
+    }
+    return connection;
+}
+
+
+/* Has the daemon scale the request. If the request names no image, the
+ * input image is handed over in shared memory. The output rows are mapped
+ * from the shared memory of the reply, copied only once written to, and the
+ * output has to be released with daemon_release. Returns the reply status. */
+int daemon_scale(const char* socket_path, const daemon_request_t* request, image_t input, image_t* output, daemon_reply_t* reply) {
+    daemon_request_t shared_request = *request;
+    int shared_input = -1, shared_output = -1;
+
+    int connection = connect_daemon(socket_path);
+    if (connection < 0) {
+        return DAEMON_NO_DAEMON;
+    }
+
+    if (request->input_filename[0] == '\0' && input.data != NULL) {
+        shared_request.in_height = input.height;
+        shared_request.in_width = input.width;
+        shared_input = memfd_create("bilinear_scaling_input", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        for (uint32_t v=0; v<input.height && shared_input >= 0; v++) {
+            if (write(shared_input, input.data[v], input.width) != input.width) {
+                close(shared_input);
+                shared_input = -1;
+            }
+        }
+        /* The daemon only maps sealed input. */
+        if (shared_input >= 0 && fcntl(shared_input, F_ADD_SEALS, SHARED_SEALS) != 0) {
+            close(shared_input);
+            shared_input = -1;
+        }
+        if (shared_input < 0) {
+            close(connection);
+            return DAEMON_NO_MEMORY;
+        }
+    }
+
+    if (send_message(connection, &shared_request, sizeof(shared_request), shared_input) != 0 ||
+        receive_message(connection, reply, sizeof(*reply), &shared_output) != 0) {
+        reply->status = DAEMON_NO_DAEMON;
+    }
+    if (shared_input >= 0) close(shared_input);
+    close(connection);
+
+    if (reply->status == DAEMON_OK) {
+        size_t size = (size_t)reply->height*reply->width;
+        uint8_t* pixels = NULL;
+        if (size > 0) {
+            pixels = (shared_output < 0) ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, shared_output, 0);
+            if (pixels == MAP_FAILED) {
+                reply->status = DAEMON_NO_MEMORY;
+            }
+        }
+        if (reply->status == DAEMON_OK) {
+            *output = map_image(pixels, reply->height, reply->width);
+        }
+    }
+    if (shared_output >= 0) close(shared_output);
+
+    return reply->status;
+}
+
+
+void daemon_release(image_t output) {
+    if (output.height > 0 && output.width > 0) {
+        munmap(output.data[0], (size_t)output.height*output.width);
+    }
+    free(output.data);
+}
+
+
+/* Stops the daemon, returns once it has taken the request. */
+int daemon_stop(const char* socket_path) {
+    daemon_request_t request = { .input_filename = "", .stop = 1 };
+    daemon_reply_t reply;
+    image_t none = { .data = NULL, .height = 0, .width = 0 };
+    image_t output;
+
+    int status = daemon_scale(socket_path, &request, none, &output, &reply);
+    if (status == DAEMON_OK) {
+        daemon_release(output);
+    }
+    return status;
+}
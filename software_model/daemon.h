@@ -0,0 +1,54 @@
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include <stdint.h>
+
+#include "registry.h"
+#include "utils.h"
+
+#define DAEMON_MAX_STRLEN   (255)
+
+/* Pending connections the daemon socket queues up. */
+#define DAEMON_BACKLOG      (16)
+
+/* Reply status codes. */
+#define DAEMON_OK           (0)
+#define DAEMON_BAD_REQUEST  (-1)     /* Segment out of the image, or no input, or input not sealed. */
+#define DAEMON_NO_IMAGE     (-2)     /* Named image can't be read. */
+#define DAEMON_NO_MEMORY    (-3)     /* Shared memory of the input or output can't be made. */
+#define DAEMON_NO_DAEMON    (-4)     /* No daemon on the socket, or the connection broke. */
+
+/* Scaling request, the same fields as the prompts of the main application.
+ * The input is the named bin image, kept loaded by the daemon, or if no
+ * name is given the raw pixels of the shared memory sent along with the
+ * request, sealed against shrinking and writes. */
+typedef struct {
+    char input_filename[DAEMON_MAX_STRLEN];
+    uint32_t in_height, in_width;       /* Dimensions of the shared memory input. */
+    unsigned ul_x, ul_y, dr_x, dr_y;
+    float sx, sy;
+    uint32_t stop;                      /* Stops the daemon, once the requests being served are done. */
+} daemon_request_t;
+
+/* Reply, the output pixels are in the shared memory sent along with it. */
+typedef struct {
+    int32_t status;
+    uint32_t height, width;
+    uint32_t shared;                    /* Output was computed once for this and an identical concurrent request. */
+} daemon_reply_t;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t computed;                  /* Requests naming an image that were computed... */
+    uint64_t coalesced;                 /* ...and those answered with the output of an identical one. */
+    registry_stats_t images;            /* Images named in requests, at the stop. */
+} daemon_stats_t;
+
+int daemon_listen(const char* socket_path);
+int daemon_serve(int listener, uint64_t budget, daemon_stats_t* stats);
+
+int daemon_scale(const char* socket_path, const daemon_request_t* request, image_t input, image_t* output, daemon_reply_t* reply);
+void daemon_release(image_t output);
+int daemon_stop(const char* socket_path);
+
+#endif
@@ -0,0 +1,273 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bilinear_scaling.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "utils.h"
+
+#define STAGE_LOAD  (0)
+#define STAGE_SCALE (1)
+#define STAGE_STORE (2)
+
+/* Checks of a ring index before the waiting side goes to sleep. */
+#define RING_SPINS  (1000)
+
+/* Job on its way through the stages, passed by pointer through the rings. */
+typedef struct {
+    const job_t* job;
+    uint32_t index;
+    image_t segment;                /* Own copy, the input image may be replaced by the loader meanwhile. */
+    image_t output;
+    int cached;                     /* Output is mapped from the result cache. */
+    double seconds[PIPELINE_STAGES];
+} work_t;
+
+typedef struct {
+    const job_t* jobs;
+    uint32_t count;
+    cache_t* cache;                 /* Outputs of earlier runs, none if NULL. */
+    ring_t loaded;                  /* Loader to scaler. */
+    ring_t scaled;                  /* Scaler to writer. */
+    pipeline_stats_t stats;
+} pipeline_t;
+
+
+static double seconds_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec/1e9;
+}
+
+
+void ring_init(ring_t* ring) {
+    ring->head = 0;
+    ring->pop_waiting = 0;
+    ring->tail = 0;
+    ring->push_waiting = 0;
+}
+
+
+/* Waits while the index of the other side is the value, spinning first and
+ * then sleeping on the index. The waiting flag is set before the index is
+ * checked again, and the other side checks the flag after it moves the
+ * index, so either this side sees the move or the other side the flag. */
+static void ring_wait(uint32_t* index, uint32_t value, uint32_t* waiting) {
+    for (uint32_t i=0; i<RING_SPINS; i++) {
+        if (__atomic_load_n(index, __ATOMIC_ACQUIRE) != value) {
+            return;
+        }
+    }
+    for (;;) {
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(index, __ATOMIC_SEQ_CST) != value) {
+            return;
+        }
+        syscall(SYS_futex, index, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+    }
+}
+
+
+/* Moves the index of this side and wakes the other side if it sleeps on it. */
+static void ring_advance(uint32_t* index, uint32_t value, uint32_t* waiting) {
+    __atomic_store_n(index, value, __ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(waiting, 0, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, index, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+
+/* Waits while the ring is full. The item is stored before the head is
+ * released, so the consumer never sees a slot before it is written. */
+void ring_push(ring_t* ring, void* item) {
+    uint32_t head = ring->head;
+    ring_wait(&ring->tail, head - PIPELINE_RING_SIZE, &ring->push_waiting);
+    ring->items[head % PIPELINE_RING_SIZE] = item;
+    ring_advance(&ring->head, head + 1, &ring->pop_waiting);
+}
+
+
+/* Waits while the ring is empty. */
+void* ring_pop(ring_t* ring) {
+    uint32_t tail = ring->tail;
+    ring_wait(&ring->head, tail, &ring->pop_waiting);
+    void* item = ring->items[tail % PIPELINE_RING_SIZE];
+    ring_advance(&ring->tail, tail + 1, &ring->push_waiting);
+    return item;
+}
+
+
+/* Reads the input images ahead of the scaler, as far as the ring allows.
+ * NULL marks the end of the jobs. */
+static void* loader(void* context) {
+    pipeline_t* pipeline = (pipeline_t*) context;
+    image_t image = { .data = NULL, .height = 0, .width = 0 };
+
+    for (uint32_t i=0; i<pipeline->count; i++) {
+        const job_t* job = &pipeline->jobs[i];
+        double begin = seconds_now();
+
+        if (job->input_filename[0] != '@' || image.data == NULL) {
+            if (access(job->input_filename, R_OK) != 0) {
+                printf("Job %u: image %s can't be read, skipped.\n", i + 1, job->input_filename);
+                continue;
+            }
+            if (image.data) image_free(image);
+            image = bin2image(job->input_filename);
+        }
+
+        uint32_t height = job->dr_y - job->ul_y + 1;
+        uint32_t width = job->dr_x - job->ul_x + 1;
+        if (job->ul_x + height > image.height || job->ul_y + width > image.width) {
+            printf("Job %u: segment out of image %s, skipped.\n", i + 1, job->input_filename);
+            continue;
+        }
+
+        work_t* work = malloc(sizeof(work_t));
+        assert(work != NULL);
+        work->job = job;
+        work->index = i;
+        work->segment = image_alloc(height, width);
+        for (uint32_t v=0; v<height; v++) {
+            memcpy(work->segment.data[v], &image.data[job->ul_x + v][job->ul_y], width);
+        }
+
+        work->seconds[STAGE_LOAD] = seconds_now() - begin;
+        pipeline->stats.busy[STAGE_LOAD] += work->seconds[STAGE_LOAD];
+        ring_push(&pipeline->loaded, work);
+    }
+    ring_push(&pipeline->loaded, NULL);
+
+    if (image.data) image_free(image);
+    return NULL;
+}
+
+
+static void* scaler(void* context) {
+    pipeline_t* pipeline = (pipeline_t*) context;
+
+    for (;;) {
+        work_t* work = ring_pop(&pipeline->loaded);
+        if (work == NULL) break;
+
+        double begin = seconds_now();
+        work->cached = 0;
+        if (pipeline->cache != NULL) {
+            cache_key_t key = cache_key(work->segment, work->job->sx, work->job->sy);
+            work->cached = cache_lookup(pipeline->cache, key, &work->output);
+            if (!work->cached) {
+                work->output = bilinear_scaling_sw(work->segment, work->job->sx, work->job->sy);
+                cache_store(pipeline->cache, key, work->output);
+            }
+        }
+        else {
+            work->output = bilinear_scaling_sw(work->segment, work->job->sx, work->job->sy);
+        }
+        image_free(work->segment);
+        work->seconds[STAGE_SCALE] = seconds_now() - begin;
+        pipeline->stats.busy[STAGE_SCALE] += work->seconds[STAGE_SCALE];
+
+        ring_push(&pipeline->scaled, work);
+    }
+    ring_push(&pipeline->scaled, NULL);
+
+    return NULL;
+}
+
+
+/* Saves the outputs and prints a summary line per job, in job order. */
+static void* writer(void* context) {
+    pipeline_t* pipeline = (pipeline_t*) context;
+
+    for (;;) {
+        work_t* work = ring_pop(&pipeline->scaled);
+        if (work == NULL) break;
+
+        const job_t* job = work->job;
+        double begin = seconds_now();
+        if (job->output_filename[0] != '\0') {
+            if (job->save_format == 'p') {
+                save_to_pgm(job->output_filename, work->output);
+            }
+            else if (job->save_format == 'b') {
+                save_to_bin(job->output_filename, work->output);
+            }
+        }
+        /* Outputs of the CRC format aren't saved, the CRC is all there is of them. */
+        uint32_t crc = (job->save_format == 'c') ? image_crc32(0, work->output) : 0;
+        work->seconds[STAGE_STORE] = seconds_now() - begin;
+        pipeline->stats.busy[STAGE_STORE] += work->seconds[STAGE_STORE];
+
+        printf("Job %u: %s %ux%u -> %ux%u, load %.3f ms, scale %.3f ms, store %.3f ms",
+                work->index + 1,
+                job->input_filename,
+                job->dr_x - job->ul_x + 1,
+                job->dr_y - job->ul_y + 1,
+                work->output.width,
+                work->output.height,
+                work->seconds[STAGE_LOAD]*1000,
+                work->seconds[STAGE_SCALE]*1000,
+                work->seconds[STAGE_STORE]*1000);
+        if (job->save_format == 'c') {
+            printf(", CRC 0x%08" PRIx32, crc);
+        }
+        printf("\n");
+
+        if (work->cached) {
+            cache_release(work->output);
+        }
+        else {
+            image_free(work->output);
+        }
+        free(work);
+        pipeline->stats.jobs++;
+    }
+
+    return NULL;
+}
+
+
+/* Runs the jobs on a loader, a scaler and a writer thread connected by
+ * rings, so reading and writing the images overlaps with scaling. With a
+ * cache the scaler takes the outputs computed before from it, and stores
+ * the ones it computes. */
+pipeline_stats_t pipeline_run(const job_t* jobs, uint32_t count, cache_t* cache) {
+    pipeline_t pipeline = { .jobs = jobs, .count = count, .cache = cache };
+    pthread_t threads[PIPELINE_STAGES];
+    void* (*stages[PIPELINE_STAGES])(void*) = { &loader, &scaler, &writer };
+
+    ring_init(&pipeline.loaded);
+    ring_init(&pipeline.scaled);
+
+    double begin = seconds_now();
+    for (int i=0; i<PIPELINE_STAGES; i++) {
+        int error = pthread_create(&threads[i], NULL, stages[i], &pipeline);
+        assert(error == 0);
+    }
+    for (int i=0; i<PIPELINE_STAGES; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pipeline.stats.total = seconds_now() - begin;
+
+    return pipeline.stats;
+}
+
+
+void pipeline_print_stats(pipeline_stats_t stats) {
+    const char* names[PIPELINE_STAGES] = { "Loader", "Scaler", "Writer" };
+
+    printf("Pipeline: %u jobs in %.3f ms\n", stats.jobs, stats.total*1000);
+    for (int i=0; i<PIPELINE_STAGES; i++) {
+        printf("%s busy:   %10.3f ms, %5.1f%%\n", names[i], stats.busy[i]*1000,
+                stats.total > 0 ? 100*stats.busy[i]/stats.total : 0);
+    }
+}
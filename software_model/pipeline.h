@@ -0,0 +1,55 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdint.h>
+
+#include "cache.h"
+#include "utils.h"
+
+/* Images in flight between two stages, the loader runs at most this many jobs ahead of the scaler. */
+#define PIPELINE_RING_SIZE  (4)
+
+#define PIPELINE_MAX_STRLEN (255)
+
+/* Bytes of a cache line, ring indices written by different threads are kept this far apart. */
+#define PIPELINE_CACHE_LINE (64)
+
+/* Loader, scaler and writer. */
+#define PIPELINE_STAGES     (3)
+
+/* Scaling job, the same fields as the prompts of the main application. */
+typedef struct {
+    char input_filename[PIPELINE_MAX_STRLEN];   /* '@' is the same image as the previous job. */
+    char output_filename[PIPELINE_MAX_STRLEN];  /* Nothing is saved if empty. */
+    char save_format;                           /* 'b' saves a bin image, 'p' a PGM, 'c' prints the CRC. */
+    unsigned ul_x, ul_y, dr_x, dr_y;
+    float sx, sy;
+} job_t;
+
+/* Bounded single producer, single consumer ring. Each index is only written
+ * by one side, so no locks are needed, and sits on its own cache line so
+ * the sides don't invalidate each other's. A side waiting on the other
+ * spins a while, then sleeps on the index until the other side wakes it. */
+typedef struct {
+    void* items[PIPELINE_RING_SIZE];
+    uint32_t head __attribute__((aligned(PIPELINE_CACHE_LINE)));   /* Items pushed, written by the producer. */
+    uint32_t pop_waiting;       /* Consumer sleeps on the head, set by it and cleared by the producer. */
+    uint32_t tail __attribute__((aligned(PIPELINE_CACHE_LINE)));   /* Items popped, written by the consumer. */
+    uint32_t push_waiting;      /* Producer sleeps on the tail, set by it and cleared by the consumer. */
+} ring_t;
+
+typedef struct {
+    double busy[PIPELINE_STAGES];   /* Seconds each stage spent working, not waiting on the rings. */
+    double total;                   /* Seconds of the whole run. */
+    uint32_t jobs;
+} pipeline_stats_t;
+
+void ring_init(ring_t* ring);
+void ring_push(ring_t* ring, void* item);
+void* ring_pop(ring_t* ring);
+
+pipeline_stats_t pipeline_run(const job_t* jobs, uint32_t count, cache_t* cache);
+
+void pipeline_print_stats(pipeline_stats_t stats);
+
+#endif
@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "registry.h"
+#include "utils.h"
+
+
+void registry_init(registry_t* registry, uint64_t budget) {
+    registry->newest = NULL;
+    registry->oldest = NULL;
+    registry->budget = budget;
+    memset(&registry->stats, 0, sizeof(registry->stats));
+}
+
+
+static void unlink_entry(registry_t* registry, registry_entry_t* entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else registry->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else registry->oldest = entry->newer;
+}
+
+
+static void push_newest(registry_t* registry, registry_entry_t* entry) {
+    entry->newer = NULL;
+    entry->older = registry->newest;
+    if (registry->newest) registry->newest->newer = entry;
+    else registry->oldest = entry;
+    registry->newest = entry;
+}
+
+
+static void drop_entry(registry_t* registry, registry_entry_t* entry) {
+    unlink_entry(registry, entry);
+    registry->stats.bytes -= entry->bytes;
+    registry->stats.entries--;
+    image_free(entry->image);
+    free(entry);
+}
+
+
+/* Evicts the least recently used images not in use until the rest fits the
+ * budget. Images in use are kept even over the budget. */
+static void evict(registry_t* registry) {
+    registry_entry_t* entry = registry->oldest;
+
+    while (entry != NULL && registry->stats.bytes > registry->budget) {
+        registry_entry_t* newer = entry->newer;
+        if (entry->references == 0) {
+            drop_entry(registry, entry);
+            registry->stats.evictions++;
+        }
+        entry = newer;
+    }
+}
+
+
+/* Drops all images, none may be in use. */
+void registry_free(registry_t* registry) {
+    while (registry->oldest != NULL) {
+        assert(registry->oldest->references == 0);
+        drop_entry(registry, registry->oldest);
+    }
+}
+
+
+/* Image of the file, loaded unless it already is. An image loaded before
+ * the file was rewritten isn't served, it is dropped unless in use and the
+ * file is loaded again. Files that can't be stat'ed match by name alone.
+ * The image has to be released once no longer used. */
+image_t registry_acquire(registry_t* registry, const char* filename) {
+    registry_entry_t* entry = registry->newest;
+    struct stat status;
+
+    if (stat(filename, &status) != 0) {
+        status.st_mtime = 0;
+        status.st_size = -1;
+    }
+
+    while (entry != NULL) {
+        registry_entry_t* older = entry->older;
+        if (strcmp(entry->filename, filename) == 0) {
+            if (status.st_size < 0 ||
+                (entry->modified == status.st_mtime && entry->size == status.st_size)) {
+                break;
+            }
+            if (entry->references == 0) {
+                drop_entry(registry, entry);
+            }
+        }
+        entry = older;
+    }
+
+    if (entry != NULL) {
+        unlink_entry(registry, entry);
+        registry->stats.hits++;
+    }
+    else {
+        entry = malloc(sizeof(registry_entry_t));
+        assert(entry != NULL);
+        snprintf(entry->filename, REGISTRY_MAX_STRLEN, "%s", filename);
+        entry->modified = status.st_mtime;
+        entry->size = status.st_size;
+        entry->image = bin2image(filename);
+        entry->bytes = (uint64_t)entry->image.height*(entry->image.width + sizeof(*entry->image.data));
+        entry->references = 0;
+        registry->stats.bytes += entry->bytes;
+        registry->stats.entries++;
+        registry->stats.misses++;
+    }
+    entry->references++;
+    push_newest(registry, entry);
+    evict(registry);
+
+    return entry->image;
+}
+
+
+void registry_release(registry_t* registry, image_t image) {
+    registry_entry_t* entry;
+
+    for (entry = registry->newest; entry != NULL; entry = entry->older) {
+        if (entry->image.data == image.data) {
+            break;
+        }
+    }
+    assert(entry != NULL && entry->references > 0);
+
+    entry->references--;
+    evict(registry);
+}
+
+
+void registry_print_stats(registry_stats_t stats) {
+    uint64_t requests = stats.hits + stats.misses;
+    printf("Image registry: %llu hits, %llu misses, %.1f%% hit rate, %llu evictions, %u images in %.3f MB\n",
+            (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+            requests ? 100.0*stats.hits/requests : 0.0, (unsigned long long)stats.evictions,
+            stats.entries, stats.bytes/1e6);
+}
@@ -0,0 +1,50 @@
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "utils.h"
+
+#define REGISTRY_MAX_STRLEN (255)
+
+/* Loaded image, kept after its last release until evicted. The file is told
+ * apart from a later version under the same name by its modification time
+ * and size. */
+typedef struct registry_entry {
+    char filename[REGISTRY_MAX_STRLEN];
+    time_t modified;
+    off_t size;
+    image_t image;
+    uint64_t bytes;                 /* Pixels and row pointers of the image. */
+    uint32_t references;            /* Acquired and not yet released, never evicted while nonzero. */
+    struct registry_entry* newer;
+    struct registry_entry* older;
+} registry_entry_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;                /* Images loaded from their files. */
+    uint64_t evictions;
+    uint64_t bytes;
+    uint32_t entries;
+} registry_stats_t;
+
+/* Loaded images by filename, least recently used first to go once the
+ * images take more than the budget. Not thread safe, callers serialize. */
+typedef struct {
+    registry_entry_t* newest;
+    registry_entry_t* oldest;
+    uint64_t budget;                /* Bytes of images kept. */
+    registry_stats_t stats;
+} registry_t;
+
+void registry_init(registry_t* registry, uint64_t budget);
+void registry_free(registry_t* registry);
+
+image_t registry_acquire(registry_t* registry, const char* filename);
+void registry_release(registry_t* registry, image_t image);
+
+void registry_print_stats(registry_stats_t stats);
+
+#endif
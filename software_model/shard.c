@@ -0,0 +1,333 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bilinear_scaling.h"
+#include "pipeline.h"
+#include "shard.h"
+#include "utils.h"
+
+/* Job of the manifest with the shard it belongs to. */
+typedef struct {
+    job_t job;
+    uint32_t shard;
+} shard_job_t;
+
+
+/* Files are written under a temporary name and renamed once complete, so
+ * readers on the shared storage never see a partial file. */
+static FILE* open_temporary(const char* filename, char* temporary) {
+    sprintf(temporary, "%s.tmp.%d", filename, (int)getpid());
+    return fopen(temporary, "w");
+}
+
+
+static int commit_temporary(FILE* file, const char* temporary, const char* filename) {
+    if (fclose(file) != 0) {
+        return -1;
+    }
+    return rename(temporary, filename);
+}
+
+
+static void output_filename(char* filename, const char* directory, uint32_t index, char save_format) {
+    sprintf(filename, "%s/job_%06u.%s", directory, index, (save_format == 'p') ? "pgm" : "bin");
+}
+
+
+static void marker_filename(char* filename, const char* directory, uint32_t shard) {
+    sprintf(filename, "%s/shard_%04u.done", directory, shard);
+}
+
+
+/* Reads the manifest, returns the number of jobs or -1 if it can't be read. */
+static int read_manifest(const char* directory, shard_job_t** jobs, uint32_t* shards) {
+    char filename[2*PIPELINE_MAX_STRLEN];
+    uint32_t count;
+
+    sprintf(filename, "%s/%s", directory, SHARD_MANIFEST_NAME);
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fscanf(file, "jobs %u shards %u", &count, shards) != 2) {
+        fclose(file);
+        return -1;
+    }
+
+    *jobs = malloc((count + 1)*sizeof(shard_job_t));
+    assert(*jobs != NULL);
+    for (uint32_t i=0; i<count; i++) {
+        shard_job_t* entry = &(*jobs)[i];
+        uint32_t index;
+        if (fscanf(file, "%u %u %254s %c %u %u %u %u %f %f", &index, &entry->shard, entry->job.input_filename,
+                    &entry->job.save_format, &entry->job.ul_x, &entry->job.ul_y, &entry->job.dr_x, &entry->job.dr_y,
+                    &entry->job.sx, &entry->job.sy) != 10 || index != i) {
+            free(*jobs);
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+
+    return count;
+}
+
+
+/* Writes the manifest of the jobs, job i goes to shard i % shards. Jobs
+ * using the previous image get its filename, as the previous job may be on
+ * another shard. */
+int shard_plan(const char* directory, const job_t* jobs, uint32_t count, uint32_t shards) {
+    char filename[2*PIPELINE_MAX_STRLEN];
+    char temporary[3*PIPELINE_MAX_STRLEN];
+    const char* previous = NULL;
+
+    assert(shards > 0);
+    mkdir(directory, 0777);
+
+    sprintf(filename, "%s/%s", directory, SHARD_MANIFEST_NAME);
+    FILE* file = open_temporary(filename, temporary);
+    if (file == NULL) {
+        printf("Can't write the manifest %s.\n", filename);
+        return -1;
+    }
+
+    fprintf(file, "jobs %u shards %u\n", count, shards);
+    for (uint32_t i=0; i<count; i++) {
+        const job_t* job = &jobs[i];
+        if (job->input_filename[0] != '@') {
+            previous = job->input_filename;
+        }
+        if (previous == NULL) {
+            printf("Job %u uses the previous image, but there is none.\n", i + 1);
+            fclose(file);
+            remove(temporary);
+            return -1;
+        }
+        /* Scaling factors are printed with all their digits, workers read back the same values. */
+        fprintf(file, "%u %u %s %c %u %u %u %u %.9g %.9g\n", i, i % shards, previous, job->save_format,
+                job->ul_x, job->ul_y, job->dr_x, job->dr_y, job->sx, job->sy);
+    }
+
+    return commit_temporary(file, temporary, filename);
+}
+
+
+/* Runs the jobs of the shard and writes its completion marker, with the
+ * index and output CRC-32 of every job done. Jobs whose image can't be read
+ * or whose segment reaches past it are marked skipped instead. Outputs are
+ * saved in the directory named after the job index. */
+int shard_work(const char* directory, uint32_t shard) {
+    shard_job_t* jobs;
+    uint32_t shards;
+    char filename[2*PIPELINE_MAX_STRLEN];
+    char temporary[3*PIPELINE_MAX_STRLEN];
+    image_t image = { .data = NULL, .height = 0, .width = 0 };
+    const char* loaded = "";
+
+    int count = read_manifest(directory, &jobs, &shards);
+    if (count < 0) {
+        printf("Can't read the manifest in %s.\n", directory);
+        return -1;
+    }
+    if (shard >= shards) {
+        printf("Shard %u out of %u shards.\n", shard, shards);
+        free(jobs);
+        return -1;
+    }
+
+    marker_filename(filename, directory, shard);
+    FILE* marker = open_temporary(filename, temporary);
+    if (marker == NULL) {
+        printf("Can't write the marker %s.\n", filename);
+        free(jobs);
+        return -1;
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        const job_t* job = &jobs[i].job;
+        if (jobs[i].shard != shard) {
+            continue;
+        }
+
+        if (strcmp(job->input_filename, loaded) != 0) {
+            if (access(job->input_filename, R_OK) != 0) {
+                printf("Job %u: image %s can't be read, skipped.\n", i + 1, job->input_filename);
+                fprintf(marker, "%u skipped\n", i);
+                continue;
+            }
+            if (image.data) image_free(image);
+            image = bin2image(job->input_filename);
+            loaded = job->input_filename;
+        }
+
+        uint32_t height = job->dr_y - job->ul_y + 1;
+        uint32_t width = job->dr_x - job->ul_x + 1;
+        if (job->ul_x + height > image.height || job->ul_y + width > image.width) {
+            printf("Job %u: segment out of image %s, skipped.\n", i + 1, job->input_filename);
+            fprintf(marker, "%u skipped\n", i);
+            continue;
+        }
+
+        image_t segment = extract_segment(image, job->ul_x, job->ul_y, height, width);
+        image_t output = bilinear_scaling_sw(segment, job->sx, job->sy);
+        free(segment.data);     /* Segment is a shallow copy. */
+
+        if (job->save_format == 'b' || job->save_format == 'p') {
+            char output_name[2*PIPELINE_MAX_STRLEN];
+            char output_temporary[3*PIPELINE_MAX_STRLEN];
+            output_filename(output_name, directory, i, job->save_format);
+            sprintf(output_temporary, "%s.tmp.%d", output_name, (int)getpid());
+            if (job->save_format == 'p') {
+                save_to_pgm(output_temporary, output);
+            }
+            else {
+                save_to_bin(output_temporary, output);
+            }
+            rename(output_temporary, output_name);
+        }
+
+        fprintf(marker, "%u 0x%08" PRIx32 "\n", i, image_crc32(0, output));
+        image_free(output);
+    }
+
+    if (image.data) image_free(image);
+    free(jobs);
+
+    return commit_temporary(marker, temporary, filename);
+}
+
+
+/* Runs every shard of the manifest in its own process on this machine. */
+int shard_spawn(const char* directory) {
+    shard_job_t* jobs;
+    uint32_t shards;
+    int errors = 0;
+
+    if (read_manifest(directory, &jobs, &shards) < 0) {
+        printf("Can't read the manifest in %s.\n", directory);
+        return -1;
+    }
+    free(jobs);
+
+    pid_t* workers = malloc(shards*sizeof(pid_t));
+    assert(workers != NULL);
+
+    fflush(stdout);
+    for (uint32_t shard=0; shard<shards; shard++) {
+        workers[shard] = fork();
+        if (workers[shard] == 0) {
+            int error = shard_work(directory, shard);
+            fflush(stdout);     /* Messages of the worker, _exit doesn't flush them. */
+            _exit(error == 0 ? 0 : 1);
+        }
+        if (workers[shard] < 0) {
+            printf("Can't start the worker of shard %u.\n", shard);
+            errors++;
+        }
+    }
+    for (uint32_t shard=0; shard<shards; shard++) {
+        int status;
+        if (workers[shard] > 0 && (waitpid(workers[shard], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+            printf("Worker of shard %u failed.\n", shard);
+            errors++;
+        }
+    }
+    free(workers);
+
+    return errors ? -1 : 0;
+}
+
+
+/* Checks the completion markers of all shards, every job of the manifest
+ * must be done or skipped exactly once, by its own shard. Saved bin outputs
+ * are read back and checked against the CRC-32 of the marker. Returns the
+ * number of errors found. */
+int shard_merge(const char* directory) {
+    shard_job_t* jobs;
+    uint32_t shards;
+    char filename[2*PIPELINE_MAX_STRLEN];
+    int errors = 0;
+    uint32_t skipped = 0;
+
+    int count = read_manifest(directory, &jobs, &shards);
+    if (count < 0) {
+        printf("Can't read the manifest in %s.\n", directory);
+        return 1;
+    }
+
+    uint32_t* done = calloc(count + 1, sizeof(uint32_t));
+    uint32_t* crcs = calloc(count + 1, sizeof(uint32_t));
+    uint8_t* skips = calloc(count + 1, sizeof(uint8_t));
+    assert(done != NULL && crcs != NULL && skips != NULL);
+
+    for (uint32_t shard=0; shard<shards; shard++) {
+        marker_filename(filename, directory, shard);
+        FILE* marker = fopen(filename, "r");
+        if (marker == NULL) {
+            printf("Shard %u isn't done.\n", shard);
+            errors++;
+            continue;
+        }
+        /* Either the output CRC-32 of the job or skipped. */
+        uint32_t index, crc = 0;
+        char result[16];
+        while (fscanf(marker, "%u %15s", &index, result) == 2) {
+            int skip = strcmp(result, "skipped") == 0;
+            if ((!skip && sscanf(result, "0x%" SCNx32, &crc) != 1) || index >= count || jobs[index].shard != shard) {
+                printf("Shard %u did job %u, which isn't its own.\n", shard, index + 1);
+                errors++;
+                continue;
+            }
+            done[index]++;
+            crcs[index] = crc;
+            skips[index] = skip;
+        }
+        fclose(marker);
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        if (done[i] != 1) {
+            printf("Job %u done %u times.\n", i + 1, done[i]);
+            errors++;
+            continue;
+        }
+        if (skips[i]) {
+            skipped++;
+            continue;
+        }
+        if (jobs[i].job.save_format == 'b' || jobs[i].job.save_format == 'p') {
+            output_filename(filename, directory, i, jobs[i].job.save_format);
+            if (access(filename, R_OK) != 0) {
+                printf("Job %u output %s is missing.\n", i + 1, filename);
+                errors++;
+            }
+            else if (jobs[i].job.save_format == 'b') {
+                image_t output = bin2image(filename);
+                if (image_crc32(0, output) != crcs[i]) {
+                    printf("Job %u output %s doesn't match its CRC.\n", i + 1, filename);
+                    errors++;
+                }
+                image_free(output);
+            }
+        }
+    }
+
+    if (errors == 0) {
+        printf("Merged %u jobs of %u shards, every job done exactly once, %u skipped.\n", count, shards, skipped);
+    }
+
+    free(done);
+    free(crcs);
+    free(skips);
+    free(jobs);
+
+    return errors;
+}
@@ -0,0 +1,18 @@
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#include <stdint.h>
+
+#include "pipeline.h"
+
+#define SHARD_MANIFEST_NAME "manifest"
+
+int shard_plan(const char* directory, const job_t* jobs, uint32_t count, uint32_t shards);
+
+int shard_work(const char* directory, uint32_t shard);
+
+int shard_spawn(const char* directory);
+
+int shard_merge(const char* directory);
+
+#endif
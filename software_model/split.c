@@ -0,0 +1,141 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bilinear_scaling.h"
+#include "split.h"
+#include "utils.h"
+
+/* Offset of the first pixel in a bin image, after the width and height. */
+#define HEADER_SIZE (2*DIM_BYTE_COUNT)
+
+
+static int read_header(int file, uint32_t* height, uint32_t* width) {
+    uint32_t header[2];
+    if (pread(file, header, HEADER_SIZE, 0) != HEADER_SIZE) {
+        return -1;
+    }
+    *width = header[0];
+    *height = header[1];
+    return 0;
+}
+
+
+/* Scales one of count bands of output rows. Only the input rows of the band
+ * are read, the bottom row of its last pixel group included, and the band is
+ * written in place into the output file made by split_image. */
+int split_work(const char* input_filename, const char* output_filename, float sx, float sy, uint32_t count, uint32_t band) {
+    uint32_t in_height, in_width, out_height, out_width;
+    uint16_t increment_x, increment_y;
+    int error = 0;
+
+    int input = open(input_filename, O_RDONLY);
+    int output = open(output_filename, O_WRONLY);
+    if (input < 0 || output < 0 || read_header(input, &in_height, &in_width) != 0) {
+        printf("Can't open the images of band %u.\n", band);
+        if (input >= 0) close(input);
+        if (output >= 0) close(output);
+        return -1;
+    }
+    bilinear_scaling_geometry(in_height, in_width, sx, sy, &out_height, &out_width, &increment_x, &increment_y);
+
+    band_t* bands = malloc(count*sizeof(band_t));
+    assert(bands != NULL);
+    bilinear_scaling_bands(in_height, out_height, increment_y, 0, count, bands);
+    band_t rows = bands[band];
+    free(bands);
+
+    /* More bands than output rows, nothing to do. */
+    if (rows.out_height == 0) {
+        close(input);
+        close(output);
+        return 0;
+    }
+
+    image_t band_in = image_alloc(rows.in_height, in_width);
+    image_t band_out = image_alloc(rows.out_height, out_width);
+
+    for (uint32_t v=0; v<band_in.height && !error; v++) {
+        off_t offset = HEADER_SIZE + (off_t)(rows.in_start + v)*in_width;
+        error = pread(input, band_in.data[v], in_width, offset) != in_width;
+    }
+
+    if (!error) {
+        bilinear_scaling_window(band_in, band_out, increment_x, increment_y, 0, rows.phase_y);
+    }
+
+    for (uint32_t v=0; v<band_out.height && !error; v++) {
+        off_t offset = HEADER_SIZE + (off_t)(rows.out_start + v)*out_width;
+        error = pwrite(output, band_out.data[v], out_width, offset) != out_width;
+    }
+    if (error) {
+        printf("Reading or writing band %u failed.\n", band);
+    }
+
+    image_free(band_in);
+    image_free(band_out);
+    close(input);
+    close(output);
+
+    return error ? -1 : 0;
+}
+
+
+/* Scales a bin image into a bin output file with one process per band of
+ * output rows. The output file is made at its full size first, every
+ * worker then writes its own rows of it. */
+int split_image(const char* input_filename, const char* output_filename, float sx, float sy, uint32_t workers) {
+    uint32_t in_height, in_width, out_height, out_width;
+    uint16_t increment_x, increment_y;
+    int errors = 0;
+
+    int input = open(input_filename, O_RDONLY);
+    if (input < 0 || read_header(input, &in_height, &in_width) != 0) {
+        printf("Can't read image %s.\n", input_filename);
+        if (input >= 0) close(input);
+        return -1;
+    }
+    close(input);
+    bilinear_scaling_geometry(in_height, in_width, sx, sy, &out_height, &out_width, &increment_x, &increment_y);
+
+    int output = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    uint32_t header[2] = { out_width, out_height };
+    if (output < 0 ||
+        pwrite(output, header, HEADER_SIZE, 0) != HEADER_SIZE ||
+        ftruncate(output, HEADER_SIZE + (off_t)out_height*out_width) != 0) {
+        printf("Can't create image %s.\n", output_filename);
+        if (output >= 0) close(output);
+        return -1;
+    }
+    close(output);
+
+    pid_t* pids = malloc(workers*sizeof(pid_t));
+    assert(pids != NULL);
+
+    fflush(stdout);
+    for (uint32_t band=0; band<workers; band++) {
+        pids[band] = fork();
+        if (pids[band] == 0) {
+            _exit(split_work(input_filename, output_filename, sx, sy, workers, band) == 0 ? 0 : 1);
+        }
+        if (pids[band] < 0) {
+            printf("Can't start the worker of band %u.\n", band);
+            errors++;
+        }
+    }
+    for (uint32_t band=0; band<workers; band++) {
+        int status;
+        if (pids[band] > 0 && (waitpid(pids[band], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+            printf("Worker of band %u failed.\n", band);
+            errors++;
+        }
+    }
+    free(pids);
+
+    return errors ? -1 : 0;
+}
@@ -0,0 +1,10 @@
+#ifndef __SPLIT_H__
+#define __SPLIT_H__
+
+#include <stdint.h>
+
+int split_work(const char* input_filename, const char* output_filename, float sx, float sy, uint32_t count, uint32_t band);
+
+int split_image(const char* input_filename, const char* output_filename, float sx, float sy, uint32_t workers);
+
+#endif
@@ -28,5 +28,10 @@ void save_to_pgm(const char* filename, image_t image);
 void save_to_bin(const char* filename, image_t image);
 
 image_t invert_image(image_t image);
+int image_equal(image_t a, image_t b);
+
+uint32_t crc32_update_bitwise(uint32_t crc, const uint8_t* data, uint32_t length);
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t length);
+uint32_t image_crc32(uint32_t crc, image_t image);
 
 #endif
@@ -0,0 +1,283 @@
+#include <assert.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bilinear_scaling.h"
+#include "utils.h"
+#include "workpool.h"
+
+/* Images queued on a worker, taken from the head by the worker itself and
+ * from the tail by the others once they run out. */
+typedef struct {
+    uint32_t* items;
+    uint32_t head;
+    uint32_t tail;
+    uint64_t remaining;     /* Estimated cost of the queued images. */
+    pthread_mutex_t lock;
+} deque_t;
+
+typedef struct {
+    const dir_image_t* images;
+    float sx, sy;
+    int steal;
+    char save_format;
+    const char* output_prefix;
+    uint32_t workers;
+    deque_t deques[WORKPOOL_MAX_WORKERS];
+    uint64_t pixels[WORKPOOL_MAX_WORKERS];
+    uint32_t steals[WORKPOOL_MAX_WORKERS];
+    double busy[WORKPOOL_MAX_WORKERS];
+} workpool_t;
+
+typedef struct {
+    workpool_t* pool;
+    uint32_t id;
+} worker_t;
+
+
+static double seconds_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec/1e9;
+}
+
+
+/* Image index with its cost, for ordering the images by cost. */
+typedef struct {
+    uint64_t cost;
+    uint32_t index;
+} order_t;
+
+
+static int cost_descending(const void* a, const void* b) {
+    const order_t* order_a = (const order_t*) a;
+    const order_t* order_b = (const order_t*) b;
+    return (order_a->cost < order_b->cost) - (order_a->cost > order_b->cost);
+}
+
+
+/* Lists the .bin images of the directory in directory order, only the
+ * headers are read. Returns the number of images, the list is allocated and
+ * has to be freed. */
+uint32_t workpool_scan(const char* directory, float sx, float sy, dir_image_t** images) {
+    DIR* dir = opendir(directory);
+    uint32_t count = 0;
+    uint32_t capacity = 16;
+
+    *images = malloc(capacity*sizeof(dir_image_t));
+    assert(*images != NULL);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 4, ".bin") != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            *images = realloc(*images, capacity*sizeof(dir_image_t));
+            assert(*images != NULL);
+        }
+
+        dir_image_t* image = &(*images)[count];
+        if (snprintf(image->filename, WORKPOOL_MAX_STRLEN, "%s/%s", directory, entry->d_name) >= WORKPOOL_MAX_STRLEN) {
+            continue;
+        }
+
+        /* Dimensions are the first DIM_BYTE_COUNT bytes each, width first. */
+        uint32_t header[2];
+        FILE* file = fopen(image->filename, "r");
+        if (file == NULL) {
+            continue;
+        }
+        size_t read = fread(header, DIM_BYTE_COUNT, 2, file);
+        fclose(file);
+        if (read != 2) {
+            continue;
+        }
+        image->width = header[0];
+        image->height = header[1];
+        image->cost = (uint64_t)(image->width*sx)*(uint64_t)(image->height*sy);
+        count++;
+    }
+    closedir(dir);
+
+    return count;
+}
+
+
+static int take(deque_t* deque, uint32_t* index, const dir_image_t* images, int from_tail) {
+    int taken = 0;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *index = from_tail ? deque->items[--deque->tail] : deque->items[deque->head++];
+        __atomic_fetch_sub(&deque->remaining, images[*index].cost, __ATOMIC_RELAXED);
+        taken = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return taken;
+}
+
+
+/* Steals from the worker with the most estimated work left. Nothing is ever
+ * added to the queues, so once all of them are empty the run is over. */
+static int steal(workpool_t* pool, uint32_t id, uint32_t* index) {
+    for (;;) {
+        uint32_t victim = id;
+        uint64_t most = 0;
+        for (uint32_t i=0; i<pool->workers; i++) {
+            uint64_t remaining = __atomic_load_n(&pool->deques[i].remaining, __ATOMIC_RELAXED);
+            if (i != id && remaining > most) {
+                most = remaining;
+                victim = i;
+            }
+        }
+        if (victim == id) {
+            return 0;
+        }
+        if (take(&pool->deques[victim], index, pool->images, 1)) {
+            return 1;
+        }
+    }
+}
+
+
+static void* worker(void* context) {
+    workpool_t* pool = ((worker_t*) context)->pool;
+    uint32_t id = ((worker_t*) context)->id;
+    char output_filename[WORKPOOL_MAX_STRLEN];
+
+    for (;;) {
+        uint32_t index;
+        if (!take(&pool->deques[id], &index, pool->images, 0)) {
+            if (!pool->steal || !steal(pool, id, &index)) {
+                break;
+            }
+            pool->steals[id]++;
+        }
+
+        double begin = seconds_now();
+        const dir_image_t* image = &pool->images[index];
+        image_t input = bin2image(image->filename);
+        image_t output = bilinear_scaling_sw(input, pool->sx, pool->sy);
+
+        if (pool->output_prefix != NULL && (pool->save_format == 'b' || pool->save_format == 'p')) {
+            /* Output is named after the input, without the directory. */
+            const char* name = strrchr(image->filename, '/');
+            name = name ? name + 1 : image->filename;
+            snprintf(output_filename, WORKPOOL_MAX_STRLEN, "%s%.*s.%s", pool->output_prefix,
+                    (int)strlen(name) - 4, name, pool->save_format == 'p' ? "pgm" : "bin");
+            if (pool->save_format == 'p') {
+                save_to_pgm(output_filename, output);
+            }
+            else {
+                save_to_bin(output_filename, output);
+            }
+        }
+
+        pool->pixels[id] += (uint64_t)output.height*output.width;
+        image_free(input);
+        image_free(output);
+        pool->busy[id] += seconds_now() - begin;
+    }
+
+    return NULL;
+}
+
+
+/* Scales all images on a pool of workers. Unsorted, every worker gets a
+ * contiguous share of the list, the same number of images each. Sorted, the
+ * images are dealt out in turn, largest first. Without stealing every worker
+ * works off its share on its own, with stealing idle workers take images
+ * still queued on the others. */
+workpool_stats_t workpool_run(const dir_image_t* images, uint32_t count, float sx, float sy,
+        uint32_t workers, int sorted, int steal, char save_format, const char* output_prefix) {
+    workpool_t pool = {
+        .images = images,
+        .sx = sx,
+        .sy = sy,
+        .steal = steal,
+        .save_format = save_format,
+        .output_prefix = output_prefix,
+        .workers = (workers > WORKPOOL_MAX_WORKERS) ? WORKPOOL_MAX_WORKERS : workers
+    };
+    pthread_t threads[WORKPOOL_MAX_WORKERS];
+    worker_t contexts[WORKPOOL_MAX_WORKERS];
+
+    assert(pool.workers > 0);
+
+    for (uint32_t w=0; w<pool.workers; w++) {
+        deque_t* deque = &pool.deques[w];
+        deque->items = malloc((count/pool.workers + 1)*sizeof(uint32_t));
+        assert(deque->items != NULL);
+        deque->head = 0;
+        deque->tail = 0;
+        deque->remaining = 0;
+        pthread_mutex_init(&deque->lock, NULL);
+    }
+    order_t* order = malloc(count*sizeof(order_t));
+    assert(order != NULL);
+    for (uint32_t i=0; i<count; i++) {
+        order[i].cost = images[i].cost;
+        order[i].index = i;
+    }
+    if (sorted) {
+        qsort(order, count, sizeof(order_t), &cost_descending);
+    }
+    for (uint32_t i=0; i<count; i++) {
+        uint32_t w = sorted ? i % pool.workers : (uint64_t)i*pool.workers/count;
+        deque_t* deque = &pool.deques[w];
+        deque->items[deque->tail++] = order[i].index;
+        deque->remaining += order[i].cost;
+    }
+    free(order);
+
+    double begin = seconds_now();
+    for (uint32_t w=0; w<pool.workers; w++) {
+        contexts[w].pool = &pool;
+        contexts[w].id = w;
+        int error = pthread_create(&threads[w], NULL, &worker, &contexts[w]);
+        assert(error == 0);
+    }
+    for (uint32_t w=0; w<pool.workers; w++) {
+        pthread_join(threads[w], NULL);
+    }
+
+    workpool_stats_t stats = {
+        .images = count,
+        .pixels = 0,
+        .makespan = seconds_now() - begin,
+        .steals = 0,
+        .workers = pool.workers
+    };
+    for (uint32_t w=0; w<pool.workers; w++) {
+        stats.pixels += pool.pixels[w];
+        stats.steals += pool.steals[w];
+        stats.busy[w] = pool.busy[w];
+        pthread_mutex_destroy(&pool.deques[w].lock);
+        free(pool.deques[w].items);
+    }
+
+    return stats;
+}
+
+
+void workpool_print_stats(const char* name, workpool_stats_t stats) {
+    printf("%s: %u images, %.3f MPix in %.3f ms makespan, %.3f MPix/s, %u steals\n",
+            name, stats.images, stats.pixels/1e6, stats.makespan*1000,
+            stats.makespan > 0 ? stats.pixels/1e6/stats.makespan : 0, stats.steals);
+    for (uint32_t w=0; w<stats.workers; w++) {
+        printf("Worker %2u busy: %10.3f ms, %5.1f%%\n", w, stats.busy[w]*1000,
+                stats.makespan > 0 ? 100*stats.busy[w]/stats.makespan : 0);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __WORKPOOL_H__
+#define __WORKPOOL_H__
+
+#include <stdint.h>
+
+#define WORKPOOL_MAX_STRLEN (255)
+
+/* Maximum number of worker threads. */
+#define WORKPOOL_MAX_WORKERS (64)
+
+/* Image of a scanned directory. */
+typedef struct {
+    char filename[WORKPOOL_MAX_STRLEN];
+    uint32_t width;
+    uint32_t height;
+    uint64_t cost;          /* Estimated cost, output pixels from the header dimensions. */
+} dir_image_t;
+
+typedef struct {
+    uint32_t images;
+    uint64_t pixels;        /* Output pixels produced. */
+    double makespan;        /* Seconds until the last worker finished. */
+    double busy[WORKPOOL_MAX_WORKERS];
+    uint32_t steals;
+    uint32_t workers;
+} workpool_stats_t;
+
+uint32_t workpool_scan(const char* directory, float sx, float sy, dir_image_t** images);
+
+workpool_stats_t workpool_run(const dir_image_t* images, uint32_t count, float sx, float sy,
+        uint32_t workers, int sorted, int steal, char save_format, const char* output_prefix);
+
+void workpool_print_stats(const char* name, workpool_stats_t stats);
+
+#endif
@@ -0,0 +1,397 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "software_model/bilinear_scaling.h"
+#include "software_model/cache.h"
+#include "software_model/daemon.h"
+#include "software_model/split.h"
+#include "software_model/utils.h"
+
+#define MAX_STRLEN          (255)   /* Maximum string length, used for static memory allocation. */
+#define STRIP_CHECK_WIDTH   (16)    /* Strip width used for checking the strip mode, small so the image is split. */
+#define BAND_CHECK_COUNT    (3)     /* Number of row bands used for checking the multi-lane split. */
+#define CHANNEL_CHECK_COUNT (3)     /* Number of interleaved channels used for checking the multi-channel mode. */
+#define HYBRID_CHECK_COUNT  (3)     /* Number of hybrid splits checked, besides all rows on either engine. */
+#define SPLIT_CHECK_COUNT   (3)     /* Number of worker processes used for checking the process split. */
+#define SPLIT_CHECK_NAME    "split_check"
+#define DAEMON_CHECK_NAME   "daemon_check"
+#define CACHE_CHECK_NAME    "cache_check"
+#define CACHE_CHECK_LIMIT   (256ull << 20)
+#define IMAGE_BUDGET        (16u << 20)
+#define INPUT_RGB_NAME      "input_rgb"
+#define RESULT_RGB_NAME     "result_sw_rgb"
+
+/* Host checks of the software model, every mode of it must give the same
+ * output as bilinear_scaling_sw(). Runs the job records of the named file,
+ * or of stdin, in the format of the batch mode of the main application:
+ *
+ *   <input filename> <output format> <ul_x> <ul_y> <dr_x> <dr_y> <sx> <sy>
+ *
+ * Consecutive records are also checked as a panning viewport and as frames
+ * of a video. Scratch files are made in the working directory. Records with
+ * the bin output format also save the multi-channel testbench input and its
+ * reference there. Returns the number of failed jobs. */
+
+/* Host stand-in for the accelerator in hybrid processing. The band is scaled
+ * by the software model once the CPU waits for it, as if it ran meanwhile. */
+typedef struct {
+    image_t input;
+    image_t output;
+    float sx;
+    float sy;
+    uint16_t phase_y;
+    uint32_t channels;
+} standin_band_t;
+
+void standin_start(image_t input, image_t output, float sx, float sy, uint16_t phase_y, void* context) {
+    standin_band_t* band = (standin_band_t*) context;
+    band->input = input;
+    band->output = output;
+    band->sx = sx;
+    band->sy = sy;
+    band->phase_y = phase_y;
+}
+
+void standin_wait(void* context) {
+    standin_band_t* band = (standin_band_t*) context;
+    bilinear_scaling_sw_band(band->input, band->output, band->sx, band->sy, band->phase_y, band->channels);
+}
+
+
+/* Prints the outcome of a check, returns 1 if it failed. */
+unsigned report(const char* name, unsigned errors) {
+    printf("%s output %s\n", name, (errors == 0) ? "matches." : "differs!");
+    return errors != 0;
+}
+
+
+/* Interleaves the segment with its inverse, odd channels are inverted. */
+image_t interleave(image_t segment) {
+    image_t segment_inv = invert_image(segment);
+    image_t interleaved = image_alloc(segment.height, segment.width*CHANNEL_CHECK_COUNT);
+
+    for (unsigned v = 0; v < segment.height; v++) {
+        for (unsigned u = 0; u < segment.width; u++) {
+            for (unsigned c = 0; c < CHANNEL_CHECK_COUNT; c++) {
+                interleaved.data[v][u*CHANNEL_CHECK_COUNT + c] = (c % 2) ? segment_inv.data[v][u] : segment.data[v][u];
+            }
+        }
+    }
+
+    image_free(segment_inv);
+    return interleaved;
+}
+
+
+/* Interleaved channels must each scale the same as a single channel image. */
+unsigned check_channels(image_t segment, float sx, float sy, image_t expected) {
+    image_t segment_inv = invert_image(segment);
+    image_t expected_inv = bilinear_scaling_sw(segment_inv, sx, sy);
+    image_t input_rgb = interleave(segment);
+    image_t output_rgb = bilinear_scaling_sw_channels(input_rgb, sx, sy, CHANNEL_CHECK_COUNT);
+    unsigned errors = 0;
+
+    for (unsigned v = 0; v < expected.height; v++) {
+        for (unsigned u = 0; u < expected.width; u++) {
+            for (unsigned c = 0; c < CHANNEL_CHECK_COUNT; c++) {
+                image_t channel = (c % 2) ? expected_inv : expected;
+                errors += output_rgb.data[v][u*CHANNEL_CHECK_COUNT + c] != channel.data[v][u];
+            }
+        }
+    }
+
+    image_free(segment_inv);
+    image_free(expected_inv);
+    image_free(input_rgb);
+    image_free(output_rgb);
+    return errors;
+}
+
+
+/* Hybrid processing must match wherever the rows are split between the
+ * engines, the multi-channel image is split in half. */
+unsigned check_hybrid(image_t segment, float sx, float sy, image_t expected) {
+    standin_band_t standin;
+    band_engine_t standin_engine = { &standin_start, &standin_wait, &standin };
+    unsigned errors = 0;
+
+    standin.channels = 1;
+    for (unsigned k = 0; k <= HYBRID_CHECK_COUNT; k++) {
+        image_t output = bilinear_scaling_hybrid(segment, sx, sy, 1, k*expected.height/HYBRID_CHECK_COUNT, standin_engine);
+        errors += !image_equal(expected, output);
+        image_free(output);
+    }
+
+    image_t input_rgb = interleave(segment);
+    image_t expected_rgb = bilinear_scaling_sw_channels(input_rgb, sx, sy, CHANNEL_CHECK_COUNT);
+    standin.channels = CHANNEL_CHECK_COUNT;
+    image_t output = bilinear_scaling_hybrid(input_rgb, sx, sy, CHANNEL_CHECK_COUNT,
+            bilinear_scaling_split_rows(expected_rgb.height, 1, 1), standin_engine);
+    errors += !image_equal(expected_rgb, output);
+
+    image_free(input_rgb);
+    image_free(expected_rgb);
+    image_free(output);
+    return errors;
+}
+
+
+/* The table driven CRC-32 must match the bitwise one the accelerator CRC
+ * register mirrors. */
+unsigned check_crc(image_t output) {
+    uint32_t crc = 0;
+    for (unsigned v = 0; v < output.height; v++) {
+        crc = crc32_update_bitwise(crc, output.data[v], output.width);
+    }
+    return crc != image_crc32(0, output);
+}
+
+
+/* Worker processes writing their bands into the same file must give the
+ * same output as well. */
+unsigned check_split(image_t segment, float sx, float sy, image_t expected) {
+    save_to_bin(SPLIT_CHECK_NAME"_in.bin", segment);
+    unsigned errors = split_image(SPLIT_CHECK_NAME"_in.bin", SPLIT_CHECK_NAME"_out.bin", sx, sy, SPLIT_CHECK_COUNT) != 0;
+    if (errors == 0) {
+        image_t output = bin2image(SPLIT_CHECK_NAME"_out.bin");
+        errors = !image_equal(expected, output);
+        image_free(output);
+    }
+    remove(SPLIT_CHECK_NAME"_in.bin");
+    remove(SPLIT_CHECK_NAME"_out.bin");
+    return errors;
+}
+
+
+/* Stores the expected output of the segment in an empty cache and looks it
+ * up again, with factors off by half a fixed point step, which must give
+ * the same codes and so the same entry. A key whose check hash differs, as
+ * if the first hash of another segment collided, must miss. Returns the number of failed
+ * lookups. */
+unsigned check_cache(image_t segment, float sx, float sy, image_t expected) {
+    cache_t cache;
+    image_t output;
+    unsigned errors = 0;
+
+    if (cache_init(&cache, CACHE_CHECK_NAME, CACHE_CHECK_LIMIT) != 0) {
+        return 1;
+    }
+    cache_clear(&cache);
+
+    cache_key_t key = cache_key(segment, sx, sy);
+    if (cache_lookup(&cache, key, &output)) {
+        cache_release(output);
+        errors++;
+    }
+    cache_store(&cache, key, expected);
+
+    cache_key_t forged = key;
+    forged.check ^= 1;
+    if (cache_lookup(&cache, forged, &output)) {
+        cache_release(output);
+        errors++;
+    }
+
+    /* Empty outputs aren't stored. */
+    float half_step = 0.5f/(1 << BILINEAR_SCALING_SF_NFRAC);
+    float sx_code = from_fixed_point(to_fixed_point(sx, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC), BILINEAR_SCALING_SF_NFRAC);
+    float sy_code = from_fixed_point(to_fixed_point(sy, BILINEAR_SCALING_SF_NINT, BILINEAR_SCALING_SF_NFRAC), BILINEAR_SCALING_SF_NFRAC);
+    key = cache_key(segment, sx_code + half_step, sy_code + half_step);
+    if (cache_lookup(&cache, key, &output)) {
+        errors += !image_equal(expected, output);
+        cache_release(output);
+    }
+    else {
+        errors += expected.height*expected.width != 0;
+    }
+
+    cache_clear(&cache);
+    rmdir(CACHE_CHECK_NAME);
+
+    return errors;
+}
+
+
+/* Scales the job through a daemon of its own, once with the segment handed
+ * over in shared memory and twice naming the image, the second time the
+ * image is resident. Returns the number of outputs differing from the
+ * expected one. */
+unsigned check_daemon(const char* image_filename, image_t segment, unsigned ul_x, unsigned ul_y,
+        unsigned dr_x, unsigned dr_y, float sx, float sy, image_t expected) {
+    daemon_request_t request = { .input_filename = "", .ul_x = 0, .ul_y = 0,
+        .dr_x = segment.width - 1, .dr_y = segment.height - 1, .sx = sx, .sy = sy, .stop = 0 };
+    daemon_reply_t reply;
+    daemon_stats_t stats;
+    image_t output;
+    unsigned errors = 0;
+
+    int listener = daemon_listen(DAEMON_CHECK_NAME".sock");
+    if (listener < 0) {
+        return 1;
+    }
+    fflush(stdout);
+    pid_t daemon = fork();
+    if (daemon == 0) {
+        _exit(daemon_serve(listener, IMAGE_BUDGET, &stats) == 0 ? 0 : 1);
+    }
+    close(listener);
+    if (daemon < 0) {
+        return 1;
+    }
+
+    for (unsigned k = 0; k < 3; k++) {
+        if (k > 0) {
+            snprintf(request.input_filename, DAEMON_MAX_STRLEN, "%s", image_filename);
+            request.ul_x = ul_x;
+            request.ul_y = ul_y;
+            request.dr_x = dr_x;
+            request.dr_y = dr_y;
+        }
+        if (daemon_scale(DAEMON_CHECK_NAME".sock", &request, segment, &output, &reply) == DAEMON_OK) {
+            errors += !image_equal(expected, output);
+            daemon_release(output);
+        }
+        else {
+            errors++;
+        }
+    }
+
+    int status;
+    errors += daemon_stop(DAEMON_CHECK_NAME".sock") != DAEMON_OK;
+    errors += waitpid(daemon, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+
+    return errors;
+}
+
+
+int main(int argc, char* argv[]) {
+    char input_filename[MAX_STRLEN];
+    char image_filename[MAX_STRLEN] = "";
+    char save_format;
+    unsigned ul_x, ul_y, dr_x, dr_y;
+    float sx, sy;
+    unsigned num = 0, failed = 0;
+    image_t image_in = { .data = NULL, .height = 0, .width = 0 };
+
+    /* Previous job for checking incremental panning. */
+    pan_t pan;
+    bilinear_scaling_pan_init(&pan);
+
+    /* Segments of consecutive jobs as frames, for checking dirty tile rescaling. */
+    frames_t frames;
+    bilinear_scaling_frames_init(&frames);
+
+    FILE* jobs = (argc > 1) ? fopen(argv[1], "r") : stdin;
+    if (jobs == NULL) {
+        printf("Can't open job file %s.\n", argv[1]);
+        return 1;
+    }
+
+    for (;;) {
+        int fields = fscanf(jobs, "%254s %c %u %u %u %u %f %f",
+                input_filename, &save_format, &ul_x, &ul_y, &dr_x, &dr_y, &sx, &sy);
+        if (fields == EOF) {
+            break;
+        }
+        if (fields != 8) {
+            printf("Invalid job record.\n");
+            failed++;
+            break;
+        }
+        if (access(input_filename, R_OK) != 0) {
+            printf("Can't read image %s.\n", input_filename);
+            failed++;
+            continue;
+        }
+
+        /* Images are only loaded again once the filename changes. */
+        if (strcmp(image_filename, input_filename) != 0) {
+            if (image_in.data) image_free(image_in);
+            image_in = bin2image(input_filename);
+            sprintf(image_filename, "%s", input_filename);
+        }
+
+        /* Segment as extracted by the main application, rows from ul_x and columns from ul_y. */
+        unsigned seg_width = dr_x - ul_x + 1;
+        unsigned seg_height = dr_y - ul_y + 1;
+        if (!(ul_x < dr_x && ul_y < dr_y && ul_x + seg_height <= image_in.height &&
+              ul_y + seg_width <= image_in.width && sx > 0 && sy > 0)) {
+            printf("Job %u: %s segment out of the image.\n", num + 1, input_filename);
+            failed++;
+            continue;
+        }
+
+        image_t input_segment = extract_segment(image_in, ul_x, ul_y, seg_height, seg_width);
+        image_t expected = bilinear_scaling_sw(input_segment, sx, sy);
+        unsigned job_errors = 0;
+
+        printf("Job %u: %s %ux%u -> %ux%u\n", num + 1, input_filename, seg_width, seg_height,
+                (unsigned)expected.width, (unsigned)expected.height);
+
+        /* Strip mode must give the same output as scaling the whole image. */
+        image_t output = bilinear_scaling_sw_strips(input_segment, sx, sy, STRIP_CHECK_WIDTH);
+        job_errors += report("Strip mode", !image_equal(expected, output));
+        image_free(output);
+
+        /* Splitting rows across lanes must give the same output as well. */
+        output = bilinear_scaling_sw_bands(input_segment, sx, sy, BAND_CHECK_COUNT);
+        job_errors += report("Row band", !image_equal(expected, output));
+        image_free(output);
+
+        /* Rows skipped in row tag mode must not be needed. */
+        output = bilinear_scaling_sw_rows(input_segment, sx, sy);
+        job_errors += report("Row skipping", !image_equal(expected, output));
+        image_free(output);
+
+        job_errors += report("Multi-channel", check_channels(input_segment, sx, sy, expected));
+        if (save_format == 'b') {
+            image_t input_rgb = interleave(input_segment);
+            image_t output_rgb = bilinear_scaling_sw_channels(input_rgb, sx, sy, CHANNEL_CHECK_COUNT);
+            save_to_bin(INPUT_RGB_NAME".bin", input_rgb);
+            save_to_bin(RESULT_RGB_NAME".bin", output_rgb);
+            printf("Images %s and %s saved.\n", INPUT_RGB_NAME".bin", RESULT_RGB_NAME".bin");
+            image_free(input_rgb);
+            image_free(output_rgb);
+        }
+        job_errors += report("Hybrid split", check_hybrid(input_segment, sx, sy, expected));
+        job_errors += report("CRC-32", check_crc(expected));
+        job_errors += report("Process split", check_split(input_segment, sx, sy, expected));
+
+        /* Jobs panning over the same image reuse the output of the previous one. */
+        uint64_t pan_reused = pan.reused;
+        output = bilinear_scaling_pan(&pan, image_filename, image_in, ul_x, ul_y, seg_height, seg_width, sx, sy);
+        pan_reused = pan.reused - pan_reused;
+        uint64_t pan_pixels = (uint64_t)output.height*output.width;
+        job_errors += report("Panning", !image_equal(expected, output));
+        printf("Panning reused %.1f%% of the output.\n", pan_pixels ? 100.0*pan_reused/pan_pixels : 0.0);
+        image_free(output);
+
+        /* The output belongs to frames. */
+        output = bilinear_scaling_frame(&frames, input_segment, sx, sy);
+        uint64_t frame_pixels = (uint64_t)output.height*output.width;
+        job_errors += report("Frame sequence", !image_equal(expected, output));
+        printf("Frame sequence recomputed %.1f%% of the output.\n", frame_pixels ? 100.0*frames.recomputed/frame_pixels : 0.0);
+
+        job_errors += report("Result cache", check_cache(input_segment, sx, sy, expected));
+        job_errors += report("Daemon", check_daemon(image_filename, input_segment, ul_x, ul_y, dr_x, dr_y, sx, sy, expected));
+
+        failed += job_errors != 0;
+        num++;
+
+        image_free(expected);
+        free(input_segment.data);     /* Input segment is a shallow copy. */
+    }
+
+    if (jobs != stdin) fclose(jobs);
+    bilinear_scaling_pan_free(&pan);
+    bilinear_scaling_frames_free(&frames);
+    if (image_in.data) image_free(image_in);
+
+    printf("%u jobs checked, %u failed.\n", num, failed);
+    return failed;
+}